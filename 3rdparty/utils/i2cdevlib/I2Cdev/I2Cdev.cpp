@@ -92,6 +92,92 @@ THE SOFTWARE.
 I2Cdev::I2Cdev() {
 }
 
+/* register cache */
+struct I2CdevCache {
+    bool used;
+    uint8_t devAddr;
+    uint8_t values[256];
+    uint32_t valid[256/32]; // bit set: values[reg] is the register value
+    uint32_t volatileRegs[256/32];
+};
+static I2CdevCache caches[I2CDEV_CACHE_DEVICES];
+uint32_t I2Cdev::cacheHits = 0;
+uint32_t I2Cdev::cacheMisses = 0;
+
+static I2CdevCache* getCache(uint8_t devAddr) {
+    for (int i = 0; i < I2CDEV_CACHE_DEVICES; ++i) {
+        if (caches[i].used && caches[i].devAddr == devAddr) return &caches[i];
+    }
+    return NULL;
+}
+
+static inline bool isBitSet(const uint32_t* bits, uint8_t reg) {
+    return (bits[reg / 32] >> (reg % 32)) & 1;
+}
+
+/** store written values (write-through) or invalidate them if !success */
+static void cacheStore(uint8_t devAddr, uint8_t regAddr, int length, const uint8_t* data,
+        bool success) {
+    I2CdevCache* cache = getCache(devAddr);
+    if (!cache) return;
+    for (int i = 0; i < length && regAddr + i < 256; ++i) {
+        uint8_t reg = regAddr + i;
+        if (success && !isBitSet(cache->volatileRegs, reg)) {
+            cache->values[reg] = data[i];
+            cache->valid[reg / 32] |= 1u << (reg % 32);
+        } else {
+            cache->valid[reg / 32] &= ~(1u << (reg % 32));
+        }
+    }
+}
+
+/** read a register for a read-modify-write: from the cache if possible
+ * @return Status of read operation (true = success) */
+static bool readByteCached(uint8_t devAddr, uint8_t regAddr, uint8_t *data) {
+    I2CdevCache* cache = getCache(devAddr);
+    if (cache && isBitSet(cache->valid, regAddr)) {
+        *data = cache->values[regAddr];
+        ++I2Cdev::cacheHits;
+        return true;
+    }
+    if (I2Cdev::readByte(devAddr, regAddr, data) <= 0) return false;
+    if (cache) {
+        ++I2Cdev::cacheMisses;
+        cacheStore(devAddr, regAddr, 1, data, true);
+    }
+    return true;
+}
+
+bool I2Cdev::enableCache(uint8_t devAddr) {
+    if (getCache(devAddr)) return true;
+    for (int i = 0; i < I2CDEV_CACHE_DEVICES; ++i) {
+        if (!caches[i].used) {
+            memset(&caches[i], 0, sizeof(caches[i]));
+            caches[i].devAddr = devAddr;
+            caches[i].used = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void I2Cdev::disableCache(uint8_t devAddr) {
+    I2CdevCache* cache = getCache(devAddr);
+    if (cache) cache->used = false;
+}
+
+void I2Cdev::setCacheVolatile(uint8_t devAddr, uint8_t regAddr) {
+    I2CdevCache* cache = getCache(devAddr);
+    if (!cache) return;
+    cache->volatileRegs[regAddr / 32] |= 1u << (regAddr % 32);
+    cache->valid[regAddr / 32] &= ~(1u << (regAddr % 32));
+}
+
+void I2Cdev::invalidateCache(uint8_t devAddr) {
+    I2CdevCache* cache = getCache(devAddr);
+    if (cache) memset(cache->valid, 0, sizeof(cache->valid));
+}
+
 /** Read a single bit from an 8-bit device register.
  * @param devAddr I2C slave device address
  * @param regAddr Register regAddr to read from
@@ -303,11 +389,8 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
         }
 
     #elif (I2CDEV_IMPLEMENTATION == I2CDEV_CUSTOM)
-        if(i2cWrite(devAddr, (char*)&regAddr, 1) != 1) {
-        	count = -1;
-        } else {
-        	count = i2cRead(devAddr, (char*)data, length);
-        }
+        count = i2cWriteRead(devAddr, (char*)&regAddr, 1, (char*)data, length);
+        if(count == 0) count = -1; //register write failed
     #endif
 
     // check for timeout
@@ -462,11 +545,9 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
             count = -1; // error
         }
 	#elif (I2CDEV_IMPLEMENTATION == I2CDEV_CUSTOM)
-        if(i2cWrite(devAddr, (char*)&regAddr, 1) != 1) {
-        	count = -1;
-        } else {
+        {
             uint16_t intermediate[(uint8_t)length];
-            count = i2cRead(devAddr, (char *)intermediate, length * 2);
+            count = i2cWriteRead(devAddr, (char*)&regAddr, 1, (char *)intermediate, length * 2);
             if (count == length * 2) {
                 count = length; // success
                 for (uint8_t i = 0; i < length; i++) {
@@ -498,7 +579,7 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
  */
 bool I2Cdev::writeBit(uint8_t devAddr, uint8_t regAddr, uint8_t bitNum, uint8_t data) {
     uint8_t b;
-    readByte(devAddr, regAddr, &b);
+    readByteCached(devAddr, regAddr, &b);
     b = (data != 0) ? (b | (1 << bitNum)) : (b & ~(1 << bitNum));
     return writeByte(devAddr, regAddr, b);
 }
@@ -534,7 +615,7 @@ bool I2Cdev::writeBits(uint8_t devAddr, uint8_t regAddr, uint8_t bitStart, uint8
     // 10100011 original & ~mask
     // 10101011 masked | value
     uint8_t b;
-    if (readByte(devAddr, regAddr, &b) != 0) {
+    if (readByteCached(devAddr, regAddr, &b)) {
         uint8_t mask = ((1 << length) - 1) << (bitStart - length + 1);
         data <<= (bitStart - length + 1); // shift data into correct position
         data &= mask; // zero all non-important bits in data
@@ -653,6 +734,7 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
         	buf_tmp[i+1] = data[i];
         }
         status = i2cWrite(devAddr, (char*)buf_tmp, length+1) == length+1 ? 0 : -1;
+        cacheStore(devAddr, regAddr, length, buf_tmp+1, status == 0);
     #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
@@ -719,7 +801,9 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
         	buf_tmp[i*2+1] = (uint8_t)(data[i] >> 8);
         	buf_tmp[i*2+1+1] = (uint8_t)data[i];
         }
-        status = i2cWrite(devAddr, (char*)buf_tmp, length*2+1) == length*2+1 ? 0 : 0;
+        bool written = i2cWrite(devAddr, (char*)buf_tmp, length*2+1) == length*2+1;
+        status = 0; // errors are not reported (as before)
+        cacheStore(devAddr, regAddr, length*2, buf_tmp+1, written);
     #endif
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
@@ -62,8 +62,12 @@ using std::max;
  * - readWords
  * - writeBytes
  * - writeWords
+ * and a register cache was added (see enableCache())
  */
 
+/** max number of devices with a register cache */
+#define I2CDEV_CACHE_DEVICES 4
+
 
 // -----------------------------------------------------------------------------
 // I2C interface implementation setting
@@ -128,6 +132,25 @@ class I2Cdev {
         static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
         static bool writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
+        /* optional write-through register cache per device: writeBit() &
+         * writeBits() then take the register value from the cache instead
+         * of reading it first (one bus transaction instead of two). reads
+         * always go to the device.
+         * registers the device changes itself (status, self-clearing bits)
+         * must be set volatile, and the cache must be invalidated after a
+         * device reset. */
+
+        /** @return false if there is no free cache (I2CDEV_CACHE_DEVICES) */
+        static bool enableCache(uint8_t devAddr);
+        static void disableCache(uint8_t devAddr);
+        /** never cache a register */
+        static void setCacheVolatile(uint8_t devAddr, uint8_t regAddr);
+        /** forget all cached values of a device */
+        static void invalidateCache(uint8_t devAddr);
+
+        static uint32_t cacheHits; /** register reads saved */
+        static uint32_t cacheMisses;
+
         static uint16_t readTimeout;
 };
 
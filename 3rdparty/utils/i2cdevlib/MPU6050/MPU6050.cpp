@@ -2358,6 +2358,7 @@ void MPU6050::resetSensors() {
  */
 void MPU6050::reset() {
     I2Cdev::writeBit(devAddr, MPU6050_RA_PWR_MGMT_1, MPU6050_PWR1_DEVICE_RESET_BIT, true);
+    I2Cdev::invalidateCache(devAddr); // all registers are set to the defaults
 }
 /** Get sleep mode status.
  * Setting the SLEEP bit in the register puts the device into very low power
@@ -39,6 +39,17 @@ THE SOFTWARE.
 
 #include "../I2Cdev/I2Cdev.h"
 
+// the MotionApps 2.0 members change the class layout, so they must be declared
+// in every translation unit. the implementation is in
+// MPU6050_6Axis_MotionApps20.h, which must be included in only one .cpp
+// (drivers/i2c/mpu-6050_dmp.cpp)
+#ifndef MPU6050_INCLUDE_DMP_MOTIONAPPS41
+#define MPU6050_INCLUDE_DMP_MOTIONAPPS20
+#endif
+#ifdef MPU6050_INCLUDE_DMP_MOTIONAPPS20
+#include "helper_3dmath.h"
+#endif
+
 #define PROGMEM /* empty */
 #define pgm_read_byte(x) (*(x))
 #define pgm_read_word(x) (*(x))
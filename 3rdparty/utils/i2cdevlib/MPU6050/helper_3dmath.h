@@ -32,6 +32,8 @@ THE SOFTWARE.
 #ifndef _HELPER_3DMATH_H_
 #define _HELPER_3DMATH_H_
 
+#include <math.h>
+
 class Quaternion {
     public:
         float w;
@@ -19,6 +19,7 @@
 
 #include <kernel/init.h>
 #include <kernel/mem.h>
+#include <kernel/timer.h>
 
 
 void initArch() {
@@ -33,6 +34,7 @@ void initArch() {
 		addMemoryRegion(&region);
 	}
 	initBoard();
+	initCycleCounter();
 
 	/* from now on printk should work */
 	printATAG();
@@ -10,7 +10,10 @@ src += $(THIS_DIR)gpio.c
 src += $(THIS_DIR)gpio.S
 src += $(THIS_DIR)serial.c
 src += $(THIS_DIR)pwm.c
+src += $(THIS_DIR)dma.c
 src += $(THIS_DIR)i2c.c
+src += $(THIS_DIR)spi.c
+src += $(THIS_DIR)esc.c
 src += $(THIS_DIR)audio.c
 src += $(THIS_DIR)interrupt.c
 src += $(THIS_DIR)timer.c
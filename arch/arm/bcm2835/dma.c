@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "dma.h"
+
+#include <kernel/registers.h>
+#include <kernel/mem.h>
+#include <kernel/mmu.h>
+#include <kernel/utils.h>
+#include <kernel/printk.h>
+
+#define channelReg(channel, reg) (BCM2835_DMA_BASE + (channel)*0x100 + (reg))
+
+static ulong dma_memory_next = 0, dma_memory_end = 0;
+
+
+void initDMAMemory() {
+	const mem_region* region = getPhysicalRegion(BCM2835_DMA_MEMORY_SIZE,
+			PAGE_SIZE, mem_region_type_dma);
+	if(!region) {
+		printk_w("Warning: no memory for DMA\n");
+		return;
+	}
+	dma_memory_next = region->start;
+	dma_memory_end = region->start + region->size;
+}
+
+void* dmaAlloc(uint size) {
+	ulong start = align_ptr(dma_memory_next, 32);
+	if(start + size > dma_memory_end) return NULL;
+	dma_memory_next = start + size;
+	return (void*)start;
+}
+
+void dmaStart(int channel, struct DMAControlBlock* control_block) {
+	regWrite32(BCM2835_DMA_ENABLE, regRead32(BCM2835_DMA_ENABLE) | BIT(channel));
+	dmaStop(channel);
+	regWrite32(channelReg(channel, BCM2835_DMA_CONBLK_AD), dmaBusAddress(control_block));
+	regWrite32(channelReg(channel, BCM2835_DMA_CS), BCM2835_DMA_CS_ACTIVE
+			| BCM2835_DMA_CS_PRIORITY(8) | BCM2835_DMA_CS_PANIC_PRIORITY(8)
+			| BCM2835_DMA_CS_WAIT_FOR_OUTSTANDING_WRITES);
+}
+
+void dmaStop(int channel) {
+	//pause & wait for the current AXI writes (ABORT would load the next block)
+	regWrite32(channelReg(channel, BCM2835_DMA_CS), 0);
+	for(int i=0; i<10000 && (regRead32(channelReg(channel, BCM2835_DMA_CS))
+			& BCM2835_DMA_CS_WAITING_FOR_WRITES); ++i);
+	regWrite32(channelReg(channel, BCM2835_DMA_CS), BCM2835_DMA_CS_RESET);
+	regWrite32(channelReg(channel, BCM2835_DMA_CS), BCM2835_DMA_CS_INT | BCM2835_DMA_CS_END);
+	regWrite32(channelReg(channel, BCM2835_DMA_DEBUG), 0x7); //clear error flags
+}
+
+bool dmaIsActive(int channel) {
+	return (regRead32(channelReg(channel, BCM2835_DMA_CS)) & BCM2835_DMA_CS_ACTIVE) != 0;
+}
+
+uint32 dmaRemainingBytes(int channel) {
+	return regRead32(channelReg(channel, BCM2835_DMA_TXFR_LEN));
+}
+
+struct DMAControlBlock* dmaCurrentControlBlock(int channel) {
+	uint32 addr = regRead32(channelReg(channel, BCM2835_DMA_CONBLK_AD));
+	if(addr == 0) return NULL;
+	return (struct DMAControlBlock*)(addr & ~BCM2835_BUS_SDRAM_UNCACHED);
+}
+
+bool dmaCheckError(int channel) {
+	if(!(regRead32(channelReg(channel, BCM2835_DMA_CS)) & BCM2835_DMA_CS_ERROR))
+		return false;
+	regWrite32(channelReg(channel, BCM2835_DMA_DEBUG), 0x7);
+	return true;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef BCM2835_DMA_HEADER_H_
+#define BCM2835_DMA_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+#include <kernel/types.h>
+
+
+#define BCM2835_DMA_BASE          (BCM2835_PERI_BASE+0x7000)
+#define BCM2835_DMA_ENABLE        (BCM2835_DMA_BASE+0xFF0)
+/* channel registers: channel n at BCM2835_DMA_BASE + n*0x100 (n in [0, 14]) */
+#define BCM2835_DMA_CS            0x00
+#define BCM2835_DMA_CONBLK_AD     0x04
+#define BCM2835_DMA_TI            0x08
+#define BCM2835_DMA_SOURCE_AD     0x0C
+#define BCM2835_DMA_DEST_AD       0x10
+#define BCM2835_DMA_TXFR_LEN      0x14
+#define BCM2835_DMA_NEXTCONBK     0x1C
+#define BCM2835_DMA_DEBUG         0x20
+
+/* CS bits */
+#define BCM2835_DMA_CS_ACTIVE     BIT(0)
+#define BCM2835_DMA_CS_END        BIT(1)
+#define BCM2835_DMA_CS_INT        BIT(2)
+#define BCM2835_DMA_CS_WAITING_FOR_WRITES BIT(6)
+#define BCM2835_DMA_CS_ERROR      BIT(8)
+#define BCM2835_DMA_CS_PRIORITY(x)       (((x)&0xf)<<16)
+#define BCM2835_DMA_CS_PANIC_PRIORITY(x) (((x)&0xf)<<20)
+#define BCM2835_DMA_CS_WAIT_FOR_OUTSTANDING_WRITES BIT(28)
+#define BCM2835_DMA_CS_RESET      BIT(31)
+
+/* TI bits (transfer information, in the control block) */
+#define BCM2835_DMA_TI_INTEN      BIT(0)
+#define BCM2835_DMA_TI_WAIT_RESP  BIT(3)
+#define BCM2835_DMA_TI_DEST_INC   BIT(4)
+#define BCM2835_DMA_TI_DEST_DREQ  BIT(6)
+#define BCM2835_DMA_TI_SRC_INC    BIT(8)
+#define BCM2835_DMA_TI_SRC_DREQ   BIT(10)
+#define BCM2835_DMA_TI_PERMAP(x)  (((x)&0x1f)<<16)
+#define BCM2835_DMA_TI_NO_WIDE_BURSTS BIT(26)
+
+/* DREQ peripheral numbers (PERMAP) */
+#define BCM2835_DMA_DREQ_PCM_TX   2
+#define BCM2835_DMA_DREQ_PWM      5
+
+/* channels the VideoCore firmware leaves to the ARM are 0, 2, 4, 5, 8-14 */
+#define BCM2835_DMA_CHANNEL_ESC   5 /* motor output */
+
+/* bus addresses as seen by the DMA controller */
+#define BCM2835_BUS_PERI_BASE     0x7E000000
+#define BCM2835_BUS_SDRAM_UNCACHED 0xC0000000
+
+/* size of the uncached memory for DMA control blocks & data */
+#define BCM2835_DMA_MEMORY_SIZE   (64*1024)
+
+/** control block: must be 32 byte aligned */
+struct DMAControlBlock {
+	uint32 ti;
+	uint32 source_ad;
+	uint32 dest_ad;
+	uint32 txfr_len;
+	uint32 stride;
+	uint32 nextconbk; /** bus address, 0 to stop */
+	uint32 reserved[2];
+} __attribute__((aligned(32)));
+
+
+/** reserve the uncached memory region. call before the MMU is set up */
+void initDMAMemory();
+
+/**
+ * allocate uncached memory (never freed)
+ * @param size in bytes (the start is 32 byte aligned)
+ * @return NULL if out of memory
+ */
+void* dmaAlloc(uint size);
+
+/** bus address of DMA memory (dmaAlloc) or a peripheral register */
+static inline uint32 dmaBusAddress(const volatile void* ptr) {
+	uint32 addr = (uint32)ptr;
+	if(addr >= BCM2835_PERI_BASE && addr <= BCM2835_PERI_END)
+		return addr - BCM2835_PERI_BASE + BCM2835_BUS_PERI_BASE;
+	return addr | BCM2835_BUS_SDRAM_UNCACHED;
+}
+
+/** reset a channel & start it with the given control block */
+void dmaStart(int channel, struct DMAControlBlock* control_block);
+
+/** stop & reset a channel */
+void dmaStop(int channel);
+
+/** @return true if the channel still processes control blocks */
+bool dmaIsActive(int channel);
+
+/** @return bytes left in the current control block */
+uint32 dmaRemainingBytes(int channel);
+
+/** @return address of the control block the channel currently processes */
+struct DMAControlBlock* dmaCurrentControlBlock(int channel);
+
+/** @return true if the channel stopped because of an error (and clear it) */
+bool dmaCheckError(int channel);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BCM2835_DMA_HEADER_H_ */
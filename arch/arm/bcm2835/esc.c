@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "esc.h"
+#include "dma.h"
+#include "pwm.h"
+
+#include <kernel/esc.h>
+#include <kernel/dshot.h>
+#include <kernel/gpio.h>
+#include <kernel/interrupt.h>
+#include <kernel/registers.h>
+
+#define DMA_CHANNEL BCM2835_DMA_CHANNEL_ESC
+
+/* pulses: set, (wait, clear) per channel, wait until the end of the period
+ * (fill). DShot: (set, wait, clear 0 bits, wait, clear, wait) per bit, the
+ * last wait is the fill */
+#define PULSE_CHAIN_LENGTH (2+2*ESC_MAX_CHANNELS)
+#define DSHOT_CHAIN_LENGTH (6*DSHOT_FRAME_BITS)
+#define CHAIN_LENGTH DSHOT_CHAIN_LENGTH /* the longer one */
+
+/* gpio masks: pulses: set, clear per channel. DShot: all, 0 bits per bit */
+#define NUM_MASKS (1+DSHOT_FRAME_BITS)
+
+/* control blocks & their data, in uncached memory */
+struct ESCChain {
+	struct DMAControlBlock cb[CHAIN_LENGTH];
+	uint32 masks[NUM_MASKS];
+	int fill; /* index of the last control block: wait until the period ends */
+};
+
+enum Backend {
+	Backend_None = 0,
+	Backend_PWM,
+	Backend_DMA
+};
+
+static enum Backend backend = Backend_None;
+static int esc_mode;
+static int num_channels;
+static int pins[ESC_MAX_CHANNELS];
+static int pwm_channels[ESC_MAX_CHANNELS]; /* hardware PWM backend */
+static uint32 step_ns; /* pulse resolution */
+static uint32 period_steps;
+static uint32 current_steps[ESC_MAX_CHANNELS];
+static bool dshot; /* DShot frames instead of pulses (DMA backend) */
+static uint16 current_frames[ESC_MAX_CHANNELS];
+static uint32 gap_steps; /* min low time before a restart */
+
+/* DMA backend */
+static struct ESCChain* chains[2];
+static int active_chain; /* the chain the DMA plays (or switches to) */
+static bool switch_pending; /* the DMA did not yet enter the active chain */
+static struct DMAControlBlock* prime; /* fills the fifo to the threshold */
+static uint32* dummy_word; /* source for the pacing writes */
+
+static struct ESCOutputStatistics statistics;
+
+static void buildChain(struct ESCChain* chain);
+static void startDMA(struct ESCChain* chain);
+static int applySteps(const uint32* steps);
+static int applyChain();
+
+
+/* PWM channel of a pin & its function, -1 if none */
+static int pwmChannel(int pin, int* function) {
+	switch(pin) {
+	case 12: *function = 0b100; return 0; //ALT0
+	case 13: *function = 0b100; return 1;
+	case 18: *function = 0b010; return 0; //ALT5
+	case 19: *function = 0b010; return 1;
+	}
+	return -1;
+}
+
+static int init(const int* gpio_pins, int num, int mode,
+		uint32 period_ns, uint32 resolution_ns, bool use_dshot) {
+	if(num < 1 || num > ESC_MAX_CHANNELS || resolution_ns < 2*ESC_PWM_CLOCK_NS
+			|| (mode != ESC_MODE_CONTINUOUS && mode != ESC_MODE_SYNCHRONIZED))
+		return -E_INVALID_PARAM;
+	escOutputStop();
+	backend = Backend_None;
+
+	/* hardware PWM if possible */
+	bool use_pwm = !use_dshot && mode == ESC_MODE_CONTINUOUS && num <= 2;
+	int used_channels = 0;
+	for(int i=0; i<num && use_pwm; ++i) {
+		int function;
+		int channel = pwmChannel(gpio_pins[i], &function);
+		if(channel < 0 || (used_channels & (1<<channel))) use_pwm = false;
+		else used_channels |= 1<<channel;
+	}
+	for(int i=0; i<num; ++i) {
+		if(!use_pwm && (gpio_pins[i] < 0 || gpio_pins[i] >= 32))
+			return -E_INVALID_PARAM;
+	}
+
+	if(!use_pwm && !chains[0]) {
+		chains[0] = dmaAlloc(sizeof(struct ESCChain));
+		chains[1] = dmaAlloc(sizeof(struct ESCChain));
+		prime = dmaAlloc(sizeof(struct DMAControlBlock));
+		dummy_word = dmaAlloc(sizeof(uint32));
+		if(!chains[1] || !prime || !dummy_word) {
+			chains[0] = NULL;
+			return -E_OUT_OF_MEMORY;
+		}
+	}
+
+	esc_mode = mode;
+	num_channels = num;
+	dshot = use_dshot;
+	gap_steps = dshot ? DSHOT_FRAME_GAP_BITS*DSHOT_BIT_UNITS : 0;
+	uint32 step_clocks = (resolution_ns + ESC_PWM_CLOCK_NS/2) / ESC_PWM_CLOCK_NS;
+	step_ns = step_clocks * ESC_PWM_CLOCK_NS;
+	for(int i=0; i<num; ++i) {
+		pins[i] = gpio_pins[i];
+		current_steps[i] = 0;
+		current_frames[i] = DSHOT_VALUE_STOP;
+	}
+
+	initPWM(ESC_PWM_CLOCK_SOURCE, 0);
+	setPWMClockDivisor(ESC_PWM_CLOCK_DIVISOR, 0, true);
+
+	if(use_pwm) {
+		backend = Backend_PWM;
+		setPWMMarkSpaceMode(used_channels);
+		for(int i=0; i<num; ++i) {
+			int function;
+			pwm_channels[i] = pwmChannel(pins[i], &function);
+			setPWMData(pwm_channels[i], 0);
+			setGpioFunction(pins[i], function);
+		}
+		setPWMChannels(used_channels);
+	} else {
+		backend = Backend_DMA;
+		for(int i=0; i<num; ++i) {
+			setGpio(pins[i], 0);
+			setGpioFunction(pins[i], 0b001); //output
+		}
+		/* the PWM only paces the DMA: its output is not on a pin */
+		setPWMRange(step_clocks, 1);
+		clearPWMFifo();
+		enablePWMDMA(ESC_FIFO_THRESHOLD);
+		setPWMChannels(1);
+
+		*dummy_word = 0;
+		prime->ti = BCM2835_DMA_TI_PERMAP(BCM2835_DMA_DREQ_PWM)
+			| BCM2835_DMA_TI_DEST_DREQ | BCM2835_DMA_TI_NO_WIDE_BURSTS
+			| BCM2835_DMA_TI_WAIT_RESP;
+		prime->source_ad = dmaBusAddress(dummy_word);
+		prime->dest_ad = dmaBusAddress((void*)PWM_FIFO);
+		prime->txfr_len = 4*ESC_FIFO_THRESHOLD;
+		prime->stride = 0;
+	}
+
+	int ret = escOutputSetPeriod(period_ns);
+	if(ret != SUCCESS) backend = Backend_None;
+	return ret;
+}
+
+int initESCOutput(const int* gpio_pins, int num, int mode,
+		uint32 period_ns, uint32 resolution_ns) {
+	return init(gpio_pins, num, mode, period_ns, resolution_ns, false);
+}
+
+int initESCOutputDShot(const int* gpio_pins, int num, int mode,
+		uint32 period_ns, uint32 bit_rate_kbit) {
+	if(bit_rate_kbit == 0) return -E_INVALID_PARAM;
+	/* the step is rounded to the PWM clock: DShot300 & 600 are 4% faster,
+	 * DShot150 2% slower (the ESCs accept this) */
+	uint32 unit_ns = 1000000 / (bit_rate_kbit*DSHOT_BIT_UNITS);
+	return init(gpio_pins, num, mode, period_ns, unit_ns, true);
+}
+
+int escOutputSetPeriod(uint32 period_ns) {
+	if(backend == Backend_None) return -E_NOT_INIT;
+	uint32 steps = period_ns / step_ns;
+	uint32 min_steps = dshot ? DSHOT_FRAME_BITS*DSHOT_BIT_UNITS + gap_steps : 2;
+	if(steps < min_steps) return -E_INVALID_PARAM;
+
+	disableInterrupts();
+	period_steps = steps;
+	if(backend == Backend_PWM)
+		setPWMRange(period_steps*(step_ns/ESC_PWM_CLOCK_NS), 3);
+	if(dshot) applyChain();
+	else applySteps(current_steps);
+	enableInterrupts();
+	return SUCCESS;
+}
+
+uint32 escOutputPeriod() {
+	return period_steps*step_ns;
+}
+
+int escOutputUpdate(const uint32* pulse_ns) {
+	if(backend == Backend_None) return -E_NOT_INIT;
+	if(dshot) return -E_UNSUPPORTED;
+	uint32 steps[ESC_MAX_CHANNELS];
+	for(int i=0; i<num_channels; ++i)
+		steps[i] = (pulse_ns[i] + step_ns/2) / step_ns;
+
+	disableInterrupts();
+	++statistics.updates;
+	int ret = applySteps(steps);
+	enableInterrupts();
+	return ret;
+}
+
+int escOutputUpdateDShot(const uint16* frames) {
+	if(backend == Backend_None) return -E_NOT_INIT;
+	if(!dshot) return -E_UNSUPPORTED;
+
+	disableInterrupts();
+	++statistics.updates;
+	for(int i=0; i<num_channels; ++i)
+		current_frames[i] = frames[i];
+	int ret = applyChain();
+	enableInterrupts();
+	return ret;
+}
+
+/* call with disabled interrupts */
+static int applySteps(const uint32* steps) {
+	for(int i=0; i<num_channels; ++i)
+		current_steps[i] = steps[i] < period_steps ? steps[i] : period_steps-1;
+
+	if(backend == Backend_PWM) {
+		for(int i=0; i<num_channels; ++i) {
+			setPWMData(pwm_channels[i],
+					current_steps[i]*(step_ns/ESC_PWM_CLOCK_NS));
+		}
+		return SUCCESS;
+	}
+	return applyChain();
+}
+
+/* DMA backend: play the current pulses or frames. call with disabled
+ * interrupts */
+static int applyChain() {
+	if(!dmaIsActive(DMA_CHANNEL)) {
+		if(dmaCheckError(DMA_CHANNEL)) ++statistics.errors;
+		active_chain = 0;
+		switch_pending = false;
+		buildChain(chains[0]);
+		clearPWMFifo();
+		startDMA(chains[0]);
+		return SUCCESS;
+	}
+
+	/*
+	 * the DMA loops over the active chain. build the other one & link it
+	 * from the end of the active chain. the DMA may already have loaded that
+	 * last control block, so the switch can take another period. until the
+	 * DMA is in the new chain, the old chain must not be changed: the pulses
+	 * are stored & the next update applies them.
+	 */
+	struct DMAControlBlock* current = dmaCurrentControlBlock(DMA_CHANNEL);
+	struct ESCChain* chain = chains[active_chain];
+	bool in_active_chain = current >= chain->cb && current < chain->cb + CHAIN_LENGTH;
+	if(switch_pending) {
+		if(!in_active_chain) {
+			++statistics.deferred;
+			return SUCCESS;
+		}
+		switch_pending = false;
+	}
+	int next = 1 - active_chain;
+
+	if(esc_mode == ESC_MODE_SYNCHRONIZED) {
+		/* all pins are low during the last wait: restart there, unless it is
+		 * about to end (then the DMA would set the pins before the abort).
+		 * DShot: the ESC needs a gap to detect the next frame */
+		uint32 remaining = dmaRemainingBytes(DMA_CHANNEL) / 4;
+		if(current == chain->cb + chain->fill && remaining > 2
+				&& chain->cb[chain->fill].txfr_len/4 - remaining >= gap_steps) {
+			dmaStop(DMA_CHANNEL);
+			buildChain(chains[next]);
+			clearPWMFifo();
+			startDMA(chains[next]);
+			active_chain = next;
+			++statistics.immediate;
+			return SUCCESS;
+		}
+		++statistics.busy;
+	}
+
+	buildChain(chains[next]);
+	chain->cb[chain->fill].nextconbk = dmaBusAddress(chains[next]->cb);
+	active_chain = next;
+	switch_pending = true;
+	return SUCCESS;
+}
+
+static void setGpioBlock(struct DMAControlBlock* cb, const uint32* mask,
+		uint32 reg) {
+	cb->ti = BCM2835_DMA_TI_NO_WIDE_BURSTS | BCM2835_DMA_TI_WAIT_RESP;
+	cb->source_ad = dmaBusAddress(mask);
+	cb->dest_ad = dmaBusAddress((void*)reg);
+	cb->txfr_len = 4;
+	cb->stride = 0;
+}
+
+static void setWaitBlock(struct DMAControlBlock* cb, uint32 steps) {
+	*cb = *prime;
+	cb->txfr_len = 4*steps;
+}
+
+/* link the n control blocks: the last one loops back to the start */
+static void linkChain(struct ESCChain* chain, int n) {
+	struct DMAControlBlock* cb = chain->cb;
+	for(int i=0; i<n-1; ++i)
+		cb[i].nextconbk = dmaBusAddress(cb + i+1);
+	cb[n-1].nextconbk = dmaBusAddress(cb); //repeat
+	chain->fill = n-1;
+}
+
+static void buildPulseChain(struct ESCChain* chain, const uint32* steps) {
+	/* channels sorted by pulse width */
+	int order[ESC_MAX_CHANNELS];
+	uint32* set_mask = chain->masks;
+	uint32* clear_mask = chain->masks + 1;
+	*set_mask = 0;
+	for(int i=0; i<num_channels; ++i) {
+		if(steps[i] > 0) *set_mask |= 1<<pins[i];
+		int k = i;
+		for(; k > 0 && steps[order[k-1]] > steps[i]; --k)
+			order[k] = order[k-1];
+		order[k] = i;
+	}
+
+	struct DMAControlBlock* cb = chain->cb;
+	int n = 0;
+	setGpioBlock(cb + n++, set_mask, BCM2835_GPIO_GPSET0);
+	uint32 t = 0;
+	int num_clear = 0;
+	for(int i=0; i<num_channels; ) {
+		uint32 s = steps[order[i]];
+		uint32 mask = 0;
+		for(; i<num_channels && steps[order[i]] == s; ++i)
+			mask |= 1<<pins[order[i]];
+		if(s == 0) continue; //not set
+		setWaitBlock(cb + n++, s-t);
+		t = s;
+		clear_mask[num_clear] = mask;
+		setGpioBlock(cb + n++, clear_mask + num_clear, BCM2835_GPIO_GPCLR0);
+		++num_clear;
+	}
+	setWaitBlock(cb + n++, period_steps-t); //t < period_steps
+	linkChain(chain, n);
+}
+
+static void buildDShotChain(struct ESCChain* chain, const uint16* frames) {
+	uint32* all_mask = chain->masks;
+	uint32* zero_mask = chain->masks + 1;
+	*all_mask = 0;
+	for(int i=0; i<num_channels; ++i)
+		*all_mask |= 1<<pins[i];
+
+	/* all pins go high at the start of a bit, the ones sending a 0 go low
+	 * after DSHOT_ZERO_HIGH_UNITS, the others after DSHOT_ONE_HIGH_UNITS */
+	dshotZeroMasks(zero_mask, frames, pins, num_channels);
+	struct DMAControlBlock* cb = chain->cb;
+	int n = 0;
+	for(int bit=0; bit<DSHOT_FRAME_BITS; ++bit) {
+		setGpioBlock(cb + n++, all_mask, BCM2835_GPIO_GPSET0);
+		setWaitBlock(cb + n++, DSHOT_ZERO_HIGH_UNITS);
+		setGpioBlock(cb + n++, zero_mask + bit, BCM2835_GPIO_GPCLR0);
+		setWaitBlock(cb + n++, DSHOT_ONE_HIGH_UNITS-DSHOT_ZERO_HIGH_UNITS);
+		setGpioBlock(cb + n++, all_mask, BCM2835_GPIO_GPCLR0);
+		setWaitBlock(cb + n++, DSHOT_BIT_UNITS-DSHOT_ONE_HIGH_UNITS);
+	}
+	/* the low time of the last bit lasts until the period ends */
+	uint32 frame_steps = DSHOT_FRAME_BITS*DSHOT_BIT_UNITS;
+	setWaitBlock(cb + n-1, period_steps-frame_steps + DSHOT_BIT_UNITS-DSHOT_ONE_HIGH_UNITS);
+	linkChain(chain, n);
+}
+
+static void buildChain(struct ESCChain* chain) {
+	if(dshot) buildDShotChain(chain, current_frames);
+	else buildPulseChain(chain, current_steps);
+}
+
+static void startDMA(struct ESCChain* chain) {
+	prime->nextconbk = dmaBusAddress(chain->cb);
+	dmaStart(DMA_CHANNEL, prime);
+}
+
+void escOutputStop() {
+	if(backend == Backend_DMA) {
+		dmaStop(DMA_CHANNEL);
+		uint32 mask = 0;
+		for(int i=0; i<num_channels; ++i)
+			mask |= 1<<pins[i];
+		regWrite32(BCM2835_GPIO_GPCLR0, mask);
+	} else if(backend == Backend_PWM) {
+		for(int i=0; i<num_channels; ++i)
+			setPWMData(pwm_channels[i], 0);
+	}
+	for(int i=0; i<num_channels; ++i) {
+		current_steps[i] = 0;
+		current_frames[i] = DSHOT_VALUE_STOP;
+	}
+}
+
+void escOutputGetStatistics(struct ESCOutputStatistics* s) {
+	*s = statistics;
+}
+
+void escOutputResetStatistics() {
+	memset(&statistics, 0, sizeof(statistics));
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef BCM2835_ESC_HEADER_H_
+#define BCM2835_ESC_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+#include "gpio.h"
+
+/*
+ * ESC output backends:
+ * - hardware PWM (mark-space mode) if there are at most 2 channels on PWM
+ *   pins (gpio 12 or 18: PWM0, 13 or 19: PWM1) in continuous mode.
+ * - otherwise DMA: a chain of control blocks sets all pins, then clears them
+ *   in the order of their pulse widths. the waits between the edges are
+ *   writes to the PWM fifo, paced by its DREQ (one word per step), so that
+ *   the timing does not depend on the CPU. gpio 0-31 can be used.
+ *   DShot uses the same with 6 control blocks per bit (1/8 bit steps), so
+ *   DShot600 is at the limit of the DMA speed.
+ * both use the PWM controller, so audio output is not available.
+ */
+
+#define BCM2835_GPIO_GPSET0       (BCM2835_GPIO_BASE+0x1C)
+#define BCM2835_GPIO_GPCLR0       (BCM2835_GPIO_BASE+0x28)
+
+#define ESC_PWM_CLOCK_SOURCE      6 /* PLLD, 500 MHz */
+#define ESC_PWM_CLOCK_DIVISOR     25 /* -> 20 MHz */
+#define ESC_PWM_CLOCK_NS          50 /* one PWM clock cycle [ns] */
+
+/* the DMA keeps the PWM fifo filled up to this many words */
+#define ESC_FIFO_THRESHOLD        7
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BCM2835_ESC_HEADER_H_ */
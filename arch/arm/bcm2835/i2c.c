@@ -17,23 +17,84 @@
 #include <kernel/registers.h>
 #include <kernel/i2c.h>
 #include <kernel/gpio.h>
+#include <kernel/interrupt.h>
 
-static inline int initTransfer(bool read, int addr, int len);
+/* the deadline of a transaction is DEADLINE_FACTOR times the nominal
+ * transfer time plus DEADLINE_OFFSET (start/stop conditions, IRQ latency) */
+#define DEADLINE_FACTOR 2
+#define DEADLINE_OFFSET 200 //in usec
 
-#define OPERATION_TIMEOUT 50000 //in usec
+#define RECOVERY_HALF_PERIOD 5 //in usec (100 kHz)
+#define RECOVERY_CLOCKS 9
 
-#define readI2CReg(reg) regRead32(BCM2835_I2C1_BASE + (reg))
-#define writeI2CReg(reg, val) regWrite32(BCM2835_I2C1_BASE + (reg), (val))
+#define readI2CReg(bus, reg) regRead32((bus)->base + (reg))
+#define writeI2CReg(bus, reg, val) regWrite32((bus)->base + (reg), (val))
+
+#define I2C_QUEUE_SIZE 16
+#define I2C_NUM_ADDRESSES 128
+
+/* state of a BSC controller */
+struct I2CBus {
+	uint32 base;
+	int sda_pin, scl_pin; /* gpio's, ALT0 */
+	uint32 freq_khz; /* 0 if not initialized */
+
+	/* queued transactions (w/o the active one): ring buffer */
+	struct I2CTransaction* queue[I2C_QUEUE_SIZE];
+	int queue_head, queue_count;
+
+	struct I2CTransaction* current;
+	int current_pos; /* bytes transferred */
+	uint32 current_control; /* value of the C register */
+
+	/* transactions & buffers for i2cWriteAsync() */
+	struct {
+		struct I2CTransaction transaction;
+		char buffer[I2C_ASYNC_MAX_LEN];
+	} async_writes[I2C_QUEUE_SIZE];
+
+	struct I2CStatistics statistics;
+	struct I2CDeviceStatistics device_statistics[I2C_NUM_ADDRESSES];
+
+	/* bus recovery: step of the sequence or -1 */
+	int recovery_step;
+	Timestamp recovery_next_step;
+};
+
+static struct I2CBus buses[I2C_NUM_BUSES] = {
+	{ .base = BCM2835_I2C0_BASE, .sda_pin = 0, .scl_pin = 1, .recovery_step = -1 },
+	{ .base = BCM2835_I2C1_BASE, .sda_pin = 2, .scl_pin = 3, .recovery_step = -1 },
+};
+
+/* bus of each slave address for the functions w/o bus argument:
+ * bus + 1, 0 for the default bus */
+static uint8 address_bus[I2C_NUM_ADDRESSES];
+
+static struct I2CBus* getBus(int bus);
+static struct I2CBus* addressBus(int addr);
+static int submit(struct I2CBus* bus, struct I2CTransaction* transaction, int async);
+static void startNext(struct I2CBus* bus);
+static void process(struct I2CBus* bus);
+static void poll(struct I2CBus* bus);
+static int waitFor(struct I2CBus* bus, struct I2CTransaction* transaction);
+static void startRecovery(struct I2CBus* bus);
+static void processRecovery(struct I2CBus* bus);
 
 
 void initI2C() {
+	initI2CBus(I2C_DEFAULT_BUS, 400); //default is 100kHz
+}
+
+int initI2CBus(int bus_nr, uint32 freq_khz) {
+	struct I2CBus* bus = getBus(bus_nr);
+	if(!bus || freq_khz == 0) return -E_INVALID_PARAM;
+
 	/* set up gpio */
-	setGpioFunction(2, 0b100); //SDA1
-	setGpioFunction(3, 0b100); //SCL1
+	setGpioFunction(bus->sda_pin, 0b100); //SDA
+	setGpioFunction(bus->scl_pin, 0b100); //SCL
 
 	/* init i2c */
-	uint32 i2c_freq = 400; //[kHz], default is 100kHz
-	uint32 divider = 250000 / i2c_freq; //core_clk is nominally 250 MHz
+	uint32 divider = 250000 / freq_khz; //core_clk is nominally 250 MHz
 								//(data sheet seems to be wrong)
 	/*
 	 * Per the datasheet, the register is always interpreted as an even
@@ -42,101 +103,416 @@ void initI2C() {
 	 */
 	if (divider & 1)
 		divider++;
-	writeI2CReg(BCM2835_I2C_DIV, divider);
-	writeI2CReg(BCM2835_I2C_C, 0);
+	disableInterrupts();
+	bus->freq_khz = freq_khz;
+	writeI2CReg(bus, BCM2835_I2C_DIV, divider);
+	writeI2CReg(bus, BCM2835_I2C_C, 0);
+	enableInterrupts();
+
+	enableI2CIRQ(); //shared by all controllers
+	return SUCCESS;
+}
+
+int i2cSetBus(int addr, int bus_nr) {
+	if(addr < 0 || addr >= I2C_NUM_ADDRESSES || !getBus(bus_nr))
+		return -E_INVALID_PARAM;
+	address_bus[addr] = bus_nr + 1;
+	return SUCCESS;
+}
+
+static struct I2CBus* getBus(int bus) {
+	if(bus < 0 || bus >= I2C_NUM_BUSES) return NULL;
+	return &buses[bus];
 }
 
+static struct I2CBus* addressBus(int addr) {
+	int bus = address_bus[addr & 0x7f];
+	return &buses[bus ? bus - 1 : I2C_DEFAULT_BUS];
+}
+
+/*
+ * transfers are atomic: there is only one controller per bus, and the flight
+ * controller accesses the bus from the timer IRQ. so the queues must only be
+ * changed with disabled interrupts.
+ */
 int i2cRead(int addr, char* buf, int len) {
-	if(initTransfer(true, addr, len)) return 0;
-	
-	timeout_init(timeout, OPERATION_TIMEOUT);
-
-	for(int i=0; i<len; ++i) {
-		uint32 val = readI2CReg(BCM2835_I2C_S);
-		if (!(val & BCM2835_I2C_S_RXD)) {
-			//check & reset errors
-			writeI2CReg(BCM2835_I2C_S, val);
-			if (val & (BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR)) {
-				return i;
-			}
+	return i2cBusRead(addressBus(addr) - buses, addr, buf, len);
+}
 
-			//wait until FIFO non-empty
-			while(!(readI2CReg(BCM2835_I2C_S) & BCM2835_I2C_S_RXD) && !timed_out(timeout));
-			if(timed_out(timeout)) {
-				printk_w("Warning: I2C read from address 0x%x timed out\n", addr);
-				return -1;
-			}
-		}
-		buf[i] = readI2CReg(BCM2835_I2C_FIFO);
+int i2cWrite(int addr, char* buf, int len) {
+	return i2cBusWrite(addressBus(addr) - buses, addr, buf, len);
+}
+
+int i2cWriteRead(int addr, char* write_buf, int write_len, char* read_buf, int read_len) {
+	return i2cBusWriteRead(addressBus(addr) - buses, addr, write_buf, write_len,
+			read_buf, read_len);
+}
+
+int i2cWriteAsync(int addr, char* buf, int len) {
+	return i2cBusWriteAsync(addressBus(addr) - buses, addr, buf, len);
+}
+
+int i2cBusRead(int bus, int addr, char* buf, int len) {
+	struct I2CTransaction transaction;
+	transaction.bus = bus;
+	transaction.addr = addr;
+	transaction.buf = buf;
+	transaction.len = len;
+	transaction.read = 1;
+	transaction.write_len = 0;
+	transaction.callback = NULL;
+	return waitFor(getBus(bus), &transaction);
+}
+
+int i2cBusWrite(int bus, int addr, char* buf, int len) {
+	struct I2CTransaction transaction;
+	transaction.bus = bus;
+	transaction.addr = addr;
+	transaction.buf = buf;
+	transaction.len = len;
+	transaction.read = 0;
+	transaction.write_len = 0;
+	transaction.callback = NULL;
+	return waitFor(getBus(bus), &transaction);
+}
+
+int i2cBusWriteRead(int bus, int addr, char* write_buf, int write_len,
+		char* read_buf, int read_len) {
+	if(write_len <= 0 || write_len > I2C_MAX_WRITE_READ_LEN) return 0;
+	struct I2CTransaction transaction;
+	transaction.bus = bus;
+	transaction.addr = addr;
+	transaction.buf = read_buf;
+	transaction.len = read_len;
+	transaction.read = 1;
+	transaction.write_buf = write_buf;
+	transaction.write_len = write_len;
+	transaction.callback = NULL;
+	return waitFor(getBus(bus), &transaction);
+}
+
+static int waitFor(struct I2CBus* bus, struct I2CTransaction* transaction) {
+	if(!bus || submit(bus, transaction, 0) != SUCCESS) return 0;
+	Timestamp start = getTimestamp();
+	while(transaction->pending) {
+		disableInterrupts();
+		poll(bus);
+		enableInterrupts();
 	}
-	
-	//wait until finished
-	while(!(readI2CReg(BCM2835_I2C_S) & BCM2835_I2C_S_DONE) && !timed_out(timeout));
-	if(timed_out(timeout)) {
-		printk_w("Warning: I2C read from address 0x%x timed out\n", addr);
-		return -1;
+	bus->statistics.wait_time_us += getTimestamp() - start;
+	return transaction->result;
+}
+
+int i2cBusWriteAsync(int bus_nr, int addr, char* buf, int len) {
+	if(len > I2C_ASYNC_MAX_LEN) return i2cBusWrite(bus_nr, addr, buf, len);
+	struct I2CBus* bus = getBus(bus_nr);
+	if(!bus) return 0;
+
+	int ret = 0, have_slot = 0;
+	disableInterrupts();
+	for(int i=0; i<I2C_QUEUE_SIZE; ++i) {
+		struct I2CTransaction* transaction = &bus->async_writes[i].transaction;
+		if(transaction->pending) continue;
+		have_slot = 1;
+		memcpy(bus->async_writes[i].buffer, buf, len);
+		transaction->bus = bus_nr;
+		transaction->addr = addr;
+		transaction->buf = bus->async_writes[i].buffer;
+		transaction->len = len;
+		transaction->read = 0;
+		transaction->write_len = 0;
+		transaction->callback = NULL;
+		//a rejection is counted by submit() (queue full or during a recovery)
+		if(submit(bus, transaction, 1) == SUCCESS) ret = len;
+		break;
 	}
-	writeI2CReg(BCM2835_I2C_S, BCM2835_I2C_S_DONE);
-	writeI2CReg(BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
-	return len;
+	if(!have_slot) ++bus->statistics.queue_full;
+	enableInterrupts();
+	return ret;
 }
 
-int i2cWrite(int addr, char* buf, int len) {
-	if(initTransfer(false, addr, len)) return 0;
-	
-	timeout_init(timeout, OPERATION_TIMEOUT);
-	
-	for(int i=0; i<len; ++i) {
-		uint32 val = readI2CReg(BCM2835_I2C_S);
-		if (!(val & BCM2835_I2C_S_TXD)) {
-			//check & reset errors
-			writeI2CReg(BCM2835_I2C_S, val);
-			if (val & (BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR)) {
-				return i;
-			}
-			
-			//wait until FIFO non-full
-			while(!(readI2CReg(BCM2835_I2C_S) & BCM2835_I2C_S_TXD) && !timed_out(timeout));
-			if(timed_out(timeout)) {
-				printk_w("Warning: I2C write to address %i timed out\n", addr);
-				return -1;
-			}
+int i2cSubmit(struct I2CTransaction* transaction) {
+	struct I2CBus* bus = getBus(transaction->bus);
+	if(!bus) return -E_INVALID_PARAM;
+	return submit(bus, transaction, 1);
+}
+
+static int submit(struct I2CBus* bus, struct I2CTransaction* transaction, int async) {
+	if(transaction->len <= 0 || transaction->len > 0xffff)
+		return -E_INVALID_PARAM;
+	if(transaction->read && transaction->write_len > I2C_MAX_WRITE_READ_LEN)
+		return -E_INVALID_PARAM;
+	if(bus->freq_khz == 0)
+		return -E_INVALID_PARAM; //not initialized
+	disableInterrupts();
+	if(bus->recovery_step != -1) {
+		/* fail immediately instead of waiting for the recovery */
+		processRecovery(bus);
+		if(bus->recovery_step != -1) {
+			++bus->statistics.rejected;
+			enableInterrupts();
+			return -E_BUSY;
 		}
-		writeI2CReg(BCM2835_I2C_FIFO, (uint32)buf[i]);
 	}
-	
-	//wait until finished
-	while(!(readI2CReg(BCM2835_I2C_S) & BCM2835_I2C_S_DONE) && !timed_out(timeout));
-	if(timed_out(timeout)) {
-		printk_w("Warning: I2C write to address %i timed out\n", addr);
-		return -1;
+	if(bus->queue_count >= I2C_QUEUE_SIZE) {
+		++bus->statistics.queue_full;
+		enableInterrupts();
+		return -E_BUFFER_FULL;
+	}
+	transaction->pending = 1;
+	transaction->async = async;
+	transaction->result = 0;
+	bus->queue[(bus->queue_head + bus->queue_count) % I2C_QUEUE_SIZE] = transaction;
+	++bus->queue_count;
+	if(!bus->current) startNext(bus);
+	else process(bus); //also checks for a timeout
+	enableInterrupts();
+	return SUCCESS;
+}
+
+/* call with disabled interrupts */
+static void poll(struct I2CBus* bus) {
+	if(bus->recovery_step != -1) processRecovery(bus);
+	else process(bus);
+}
+
+void i2cPoll() {
+	disableInterrupts();
+	for(int i=0; i<I2C_NUM_BUSES; ++i) {
+		if(buses[i].freq_khz) poll(&buses[i]);
 	}
-	writeI2CReg(BCM2835_I2C_S, BCM2835_I2C_S_DONE);
-	writeI2CReg(BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
-	return len;
+	enableInterrupts();
 }
 
-int initTransfer(bool read, int addr, int len) {
-	writeI2CReg(BCM2835_I2C_S, BCM2835_I2C_S_DONE | BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR);
-	writeI2CReg(BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
+void archHandleI2CIRQ() {
+	/* the IRQ is shared: check all controllers */
+	for(int i=0; i<I2C_NUM_BUSES; ++i) {
+		if(buses[i].freq_khz) process(&buses[i]);
+	}
+}
 
-	uint32 c = 0;
-	if (read)
-		c = BCM2835_I2C_C_READ;
+int i2cGetStatistics(int bus_nr, struct I2CStatistics* stats) {
+	struct I2CBus* bus = getBus(bus_nr);
+	if(!bus) return -E_INVALID_PARAM;
+	disableInterrupts();
+	*stats = bus->statistics;
+	enableInterrupts();
+	return SUCCESS;
+}
 
-	c |= BCM2835_I2C_C_ST | BCM2835_I2C_C_I2CEN;
+int i2cGetDeviceStatistics(int bus_nr, int addr, struct I2CDeviceStatistics* stats) {
+	struct I2CBus* bus = getBus(bus_nr);
+	if(!bus || addr < 0 || addr >= I2C_NUM_ADDRESSES) return -E_INVALID_PARAM;
+	disableInterrupts();
+	*stats = bus->device_statistics[addr];
+	enableInterrupts();
+	return SUCCESS;
+}
 
-	writeI2CReg(BCM2835_I2C_A, addr);
-	writeI2CReg(BCM2835_I2C_DLEN, len);
-	writeI2CReg(BCM2835_I2C_C, c);
+void i2cResetStatistics() {
+	disableInterrupts();
+	for(int i=0; i<I2C_NUM_BUSES; ++i) {
+		memset(&buses[i].statistics, 0, sizeof(buses[i].statistics));
+		memset(buses[i].device_statistics, 0, sizeof(buses[i].device_statistics));
+	}
+	enableInterrupts();
+}
 
-	uint32 val = readI2CReg(BCM2835_I2C_S);
-	//check & reset errors
+
+/* transfer as much as the FIFO allows */
+static inline void transferFIFO(struct I2CBus* bus) {
+	struct I2CTransaction* current = bus->current;
+	if(current->read) {
+		while(bus->current_pos < current->len
+				&& (readI2CReg(bus, BCM2835_I2C_S) & BCM2835_I2C_S_RXD))
+			current->buf[bus->current_pos++] = readI2CReg(bus, BCM2835_I2C_FIFO);
+	} else {
+		while(bus->current_pos < current->len
+				&& (readI2CReg(bus, BCM2835_I2C_S) & BCM2835_I2C_S_TXD))
+			writeI2CReg(bus, BCM2835_I2C_FIFO, (uint32)current->buf[bus->current_pos++]);
+		if(bus->current_pos == current->len && (bus->current_control & BCM2835_I2C_C_INTT)) {
+			//all data is in the FIFO: TXW would keep the IRQ asserted
+			bus->current_control &= ~BCM2835_I2C_C_INTT;
+			writeI2CReg(bus, BCM2835_I2C_C, bus->current_control);
+		}
+	}
+}
+
+/* nominal duration of a transaction [us]: 9 clocks per byte, incl. address */
+static inline uint32 transferTime(const struct I2CBus* bus,
+		const struct I2CTransaction* transaction) {
+	uint32 bytes = transaction->len + 1;
+	if(transaction->read && transaction->write_len > 0)
+		bytes += transaction->write_len + 1;
+	return bytes * 9 * 1000 / bus->freq_khz;
+}
+
+/**
+ * complete the active transaction & start the next one
+ * @param result bytes transferred or <0 on timeout
+ * @param recover start a bus recovery (the bus might be stuck)
+ */
+static void finish(struct I2CBus* bus, int result, int recover) {
+	writeI2CReg(bus, BCM2835_I2C_S, BCM2835_I2C_S_DONE | BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR);
+	writeI2CReg(bus, BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
+
+	struct I2CTransaction* transaction = bus->current;
+	struct I2CStatistics* statistics = &bus->statistics;
+	bus->current = NULL;
+	uint32 duration = getTimestamp() - transaction->start_time;
+	++statistics->transactions;
+	statistics->bus_time_us += duration;
+	if(transaction->async) {
+		++statistics->async_transactions;
+		statistics->async_bus_time_us += duration;
+	}
+	struct I2CDeviceStatistics* device = &bus->device_statistics[transaction->addr & 0x7f];
+	++device->transactions;
+	device->latency_sum_us += duration;
+	if(duration > device->latency_max_us) device->latency_max_us = duration;
+	if(result < 0) {
+		++statistics->timeouts;
+		++device->timeouts;
+	} else if(result != transaction->len) {
+		++statistics->errors;
+		++device->errors;
+	}
+	transaction->result = result;
+	transaction->pending = 0;
+	if(transaction->callback) transaction->callback(transaction);
+
+	if(recover) startRecovery(bus);
+	else startNext(bus);
+}
+
+/* start the next transaction in the queue (if the controller is idle) */
+static void startNext(struct I2CBus* bus) {
+	while(!bus->current && bus->queue_count > 0) {
+		struct I2CTransaction* current = bus->queue[bus->queue_head];
+		bus->current = current;
+		bus->queue_head = (bus->queue_head + 1) % I2C_QUEUE_SIZE;
+		--bus->queue_count;
+		bus->current_pos = 0;
+		current->start_time = getTimestamp();
+		current->deadline = current->start_time
+			+ DEADLINE_FACTOR * transferTime(bus, current) + DEADLINE_OFFSET;
+
+		writeI2CReg(bus, BCM2835_I2C_S, BCM2835_I2C_S_DONE | BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR);
+		writeI2CReg(bus, BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
+		writeI2CReg(bus, BCM2835_I2C_A, current->addr);
+		bus->current_control = BCM2835_I2C_C_I2CEN | BCM2835_I2C_C_INTD;
+		if(current->read) {
+			if(current->write_len > 0) {
+				/* repeated start: start the write & while it is active set up
+				 * the read. the controller then sends a repeated start instead
+				 * of a STOP when the write is done */
+				writeI2CReg(bus, BCM2835_I2C_DLEN, current->write_len);
+				for(int i=0; i<current->write_len; ++i)
+					writeI2CReg(bus, BCM2835_I2C_FIFO, (uint32)current->write_buf[i]);
+				writeI2CReg(bus, BCM2835_I2C_C, BCM2835_I2C_C_I2CEN | BCM2835_I2C_C_ST);
+				//wait for the start condition (some us)
+				timeout_init(start_timeout, 100);
+				while(!(readI2CReg(bus, BCM2835_I2C_S) & (BCM2835_I2C_S_TA | BCM2835_I2C_S_DONE))
+						&& !timed_out(start_timeout));
+			}
+			writeI2CReg(bus, BCM2835_I2C_DLEN, current->len);
+			bus->current_control |= BCM2835_I2C_C_READ | BCM2835_I2C_C_INTR;
+			writeI2CReg(bus, BCM2835_I2C_C, bus->current_control | BCM2835_I2C_C_ST);
+		} else {
+			writeI2CReg(bus, BCM2835_I2C_DLEN, current->len);
+			//fill the FIFO before the start, short writes need no further IRQ
+			bus->current_control |= BCM2835_I2C_C_INTT;
+			transferFIFO(bus);
+			writeI2CReg(bus, BCM2835_I2C_C, bus->current_control | BCM2835_I2C_C_ST);
+		}
+		uint32 val = readI2CReg(bus, BCM2835_I2C_S);
+		if(val & (BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR))
+			finish(bus, 0, (val & BCM2835_I2C_S_CLKT) != 0); //starts the next one
+	}
+}
+
+/* state machine: called from the IRQ handler or when polling */
+static void process(struct I2CBus* bus) {
+	if(!bus->current) return;
+
+	uint32 val = readI2CReg(bus, BCM2835_I2C_S);
 	if(val & (BCM2835_I2C_S_CLKT | BCM2835_I2C_S_ERR)) {
-		writeI2CReg(BCM2835_I2C_S, val | BCM2835_I2C_S_DONE);
-		writeI2CReg(BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
-		return -1;
+		//abort immediately. a clock stretch timeout can mean a stuck slave
+		finish(bus, bus->current->read ? bus->current_pos : 0,
+				(val & BCM2835_I2C_S_CLKT) != 0);
+		return;
+	}
+	transferFIFO(bus);
+	if(val & BCM2835_I2C_S_DONE) {
+		transferFIFO(bus); //remaining bytes
+		finish(bus, bus->current_pos, 0);
+		return;
 	}
-	return 0;
+	if(time_after(getTimestamp(), bus->current->deadline)) {
+		//no printk: this can be in the control loop
+		finish(bus, -1, 1);
+	}
+}
+
+
+/*
+ * bus recovery (eg. a slave holds SDA low after an aborted transfer): up to 9
+ * clock pulses on SCL until SDA is released, then a STOP condition. the pins
+ * are used as GPIO's (open drain: output low or input). it is started when the
+ * transaction is aborted & run by the next processRecovery() call (next
+ * submission or i2cPoll(), eg. once per control tick). that call does all the
+ * steps & waits the half periods in between (at most 2*9+5 half periods:
+ * 115us), one step per call would take a poll period per step.
+ * transactions are rejected while it is pending.
+ */
+static void startRecovery(struct I2CBus* bus) {
+	writeI2CReg(bus, BCM2835_I2C_C, 0);
+	setGpioFunction(bus->sda_pin, 0); //input: released
+	setGpio(bus->scl_pin, 0);
+	setGpioFunction(bus->scl_pin, 0);
+	bus->recovery_step = 0;
+	bus->recovery_next_step = getTimestamp() + RECOVERY_HALF_PERIOD;
 }
 
+static void processRecovery(struct I2CBus* bus) {
+	int sda = bus->sda_pin, scl = bus->scl_pin;
+	while(bus->recovery_step != -1) {
+		while(!time_after_eq(getTimestamp(), bus->recovery_next_step)); //<= half period
+		int step = bus->recovery_step++;
+		if(step < 2*RECOVERY_CLOCKS) {
+			if(step & 1) {
+				setGpioFunction(scl, 0); //SCL high
+			} else {
+				if(step > 0 && getGpio(sda))
+					bus->recovery_step = 2*RECOVERY_CLOCKS; //SDA released: STOP
+				else
+					setGpioFunction(scl, 1); //SCL low
+			}
+		} else {
+			switch(step - 2*RECOVERY_CLOCKS) {
+			case 0: //SCL low, then SDA low
+				setGpioFunction(scl, 1);
+				break;
+			case 1:
+				setGpio(sda, 0);
+				setGpioFunction(sda, 1);
+				break;
+			case 2: //SCL high, then SDA high: STOP
+				setGpioFunction(scl, 0);
+				break;
+			case 3:
+				setGpioFunction(sda, 0);
+				break;
+			default: //done
+				setGpioFunction(sda, 0b100);
+				setGpioFunction(scl, 0b100);
+				writeI2CReg(bus, BCM2835_I2C_C, BCM2835_I2C_C_CLEAR);
+				++bus->statistics.recoveries;
+				bus->recovery_step = -1;
+				startNext(bus);
+				return;
+			}
+		}
+		bus->recovery_next_step = getTimestamp() + RECOVERY_HALF_PERIOD;
+	}
+}
@@ -31,9 +31,15 @@ extern "C" {
 #define BCM2835_I2C_DEL		0x18
 #define BCM2835_I2C_CLKT	0x1c
 
+/* BSC master 0: gpio 0 & 1 (P1 header on rev 1 boards, ID EEPROM pins on
+ * the 40 pin header) */
+#define BCM2835_I2C0_BASE   (BCM2835_PERI_BASE+0x00205000)
 /* the BSC master 1 is connected to the gpio pins of the Raspberry pi */
 #define BCM2835_I2C1_BASE   (BCM2835_PERI_BASE+0x00804000)
 
+#define I2C_NUM_BUSES 2 /* BSC0 & BSC1 */
+#define I2C_DEFAULT_BUS 1
+
 #define BCM2835_I2C_C_READ	BIT(0)
 #define BCM2835_I2C_C_CLEAR	BIT(4) /* bits 4 and 5 both clear */
 #define BCM2835_I2C_C_ST	BIT(7)
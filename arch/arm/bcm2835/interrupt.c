@@ -52,11 +52,29 @@ void archHandleGpioIRQ() {
 	}
 }
 
+/* the gpio interrupt is the FIQ: it preempts the IRQ handlers (eg. a control
+ * loop in the timer IRQ), so the edges are timestamped without their delay.
+ * a FIQ source must not be enabled as IRQ at the same time */
 void enableGpioIRQ() {
-	regWrite32(ARM_IRQ_ENABLE2, 1<<ARM_I2_GPIO_ANY);
+	regWrite32(ARM_IRQ_DISABLE2, 1<<ARM_I2_GPIO_ANY);
+	regWrite32(ARM_FIQ_CONTROL, ARM_FIQ_ENABLE | ARM_IRQ_NR_GPIO_ANY);
+	__enableFIQ();
 }
 void disableGpioIRQ() {
-	regWrite32(ARM_IRQ_DISABLE2, 1<<ARM_I2_GPIO_ANY);
+	regWrite32(ARM_FIQ_CONTROL, 0);
+}
+
+void enableI2CIRQ() {
+	regWrite32(ARM_IRQ_ENABLE2, 1<<ARM_I2_I2C);
+}
+void disableI2CIRQ() {
+	regWrite32(ARM_IRQ_DISABLE2, 1<<ARM_I2_I2C);
+}
+void enableSPIIRQ() {
+	regWrite32(ARM_IRQ_ENABLE2, 1<<ARM_I2_SPI);
+}
+void disableSPIIRQ() {
+	regWrite32(ARM_IRQ_DISABLE2, 1<<ARM_I2_SPI);
 }
 
 
@@ -29,8 +29,12 @@ extern "C" {
 #define ARM_I0_BELL0             2 /* Doorbell 0 */
 #define ARM_I0_BELL1             3 /* Doorbell 1 */
 #define ARM_I2_GPIO_ANY          20 /* any of the gpio's */
+#define ARM_I2_I2C               21 /* all BSC controllers */
+#define ARM_I2_SPI               22
 
 #define ARM_IRQ_PEND1            (ARMCTRL_IC_BASE+0x4)  /* All bank1 IRQ bits */
+#define ARM_FIQ_CONTROL          (ARMCTRL_IC_BASE+0xc)  /* FIQ source: bits 0-6 */
+#define ARM_FIQ_ENABLE           (1<<7)
 #define ARM_IRQ_PEND2            (ARMCTRL_IC_BASE+0x8)  /* All bank2 IRQ bits */
 
 #define ARM_IRQ_ENABLE0          (ARMCTRL_IC_BASE+0x18) /* basic IRQ's */
@@ -48,6 +52,9 @@ extern "C" {
 /* interrupt numbers */
 #define ARM_IRQ_NR_TIMER		64
 #define ARM_IRQ_NR_GPIO_ANY		52
+#define ARM_IRQ_NR_I2C			(ARM_IRQ0_BASE+15) /* IRQ 53 is also in the basic
+                                                      pending register, bit 15 */
+#define ARM_IRQ_NR_SPI			(ARM_IRQ0_BASE+16) /* IRQ 54, basic bit 16 */
 
 #ifndef __ASSEMBLY__
 
@@ -55,6 +62,10 @@ void enableTimerIRQ();
 void disableTimerIRQ();
 void enableGpioIRQ();
 void disableGpioIRQ();
+void enableI2CIRQ();
+void disableI2CIRQ();
+void enableSPIIRQ();
+void disableSPIIRQ();
 /* for other devices: see manual page 113 */
 
 #endif /* __ASSEMBLY__ */
@@ -14,6 +14,7 @@
 
 #include "mem.h"
 #include "common.h"
+#include "dma.h"
 
 #include <kernel/mem.h>
 
@@ -24,6 +25,8 @@ void initDeviceMemRegions() {
 	region.start = BCM2835_PERI_BASE;
 	region.size = BCM2835_PERI_END-BCM2835_PERI_BASE;
 	addMemoryRegion(&region);
+
+	initDMAMemory();
 }
 
 
@@ -105,5 +105,23 @@ void setPWMChannels(int channels) {
 	if(channels & (1<<1)) regRMW32(PWM_CTL, PWM_CTL_PWEN1, 1);
 }
 
+void setPWMMarkSpaceMode(int channels) {
+	uint32 ctl_reg = regRead32(PWM_CTL);
+	if(channels & (1<<0)) {
+		setBit(ctl_reg, PWM_CTL_MSEN0);
+		clearBit(ctl_reg, PWM_CTL_USEF0);
+	}
+	if(channels & (1<<1)) {
+		setBit(ctl_reg, PWM_CTL_MSEN1);
+		clearBit(ctl_reg, PWM_CTL_USEF1);
+	}
+	regWrite32(PWM_CTL, ctl_reg);
+}
+
+void enablePWMDMA(int threshold) {
+	regWrite32(PWM_DMAC, BIT(PWM_DMAC_ENAB) | (threshold << 8) /* panic */
+			| threshold /* DREQ */);
+}
+
 
 
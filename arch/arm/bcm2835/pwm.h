@@ -28,9 +28,12 @@ extern "C" {
 #define PWM_BASE                  (BCM2835_PERI_BASE+0x0020C000)
 #define PWM_CTL                   (PWM_BASE+0x0)
 #define PWM_STA                   (PWM_BASE+0x4)
+#define PWM_DMAC                  (PWM_BASE+0x8)
 #define PWM_RNG0                  (PWM_BASE+0x10)
+#define PWM_DAT0                  (PWM_BASE+0x14)
 #define PWM_FIFO                  (PWM_BASE+0x18)
 #define PWM_RNG1                  (PWM_BASE+0x20)
+#define PWM_DAT1                  (PWM_BASE+0x24)
 
 /* PWM bits */
 #define PWM_CTL_PWEN0             0 /* set bit: enable channel */
@@ -55,6 +58,8 @@ extern "C" {
 #define PWM_STA_FULL0             0
 #define PWM_STA_RERR1             3
 
+#define PWM_DMAC_ENAB             31 /* set bit: enable DMA requests */
+
 
 /* PWM clock
  * these addresses are taken from wiringPi, I cannot find these in the manual :(
@@ -112,6 +117,23 @@ uint32 getPWMRange(int channel);
  */
 void setPWMChannels(int channels);
 
+/*
+ * use channels in mark-space mode with the data registers instead of the
+ * fifo: the output is high for 'data' cycles, then low for the rest of the
+ * range (see setPWMData). call after initPWM()
+ * channels: LSB: channel 0, ... (max 2 channels)
+ */
+void setPWMMarkSpaceMode(int channels);
+
+/*
+ * enable DMA requests from the fifo: DREQ is active while the fifo holds less
+ * than 'threshold' words. eg. used to pace DMA transfers with the PWM clock
+ */
+void enablePWMDMA(int threshold);
+
+/* set the data register of a channel (mark-space mode) */
+static inline void setPWMData(int channel, uint32 value);
+
 static inline void clearPWMFifo();
 
 
@@ -135,6 +157,10 @@ static inline void PWMWriteToFifo(uint32 value) {
 	regWrite32(PWM_FIFO, value);
 }
 
+static inline void setPWMData(int channel, uint32 value) {
+	regWrite32(channel == 0 ? PWM_DAT0 : PWM_DAT1, value);
+}
+
 
 #ifdef __cplusplus
 }
@@ -88,6 +88,10 @@ bool uartAvailable() {
 	return regRead32Bit(AUX_MU_LSR_REG, 0);
 }
 
+bool uartWriteReady() {
+	return regRead32Bit(AUX_MU_LSR_REG, 5);
+}
+
 
 
 
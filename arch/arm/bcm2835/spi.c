@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "spi.h"
+
+#include <kernel/registers.h>
+#include <kernel/spi.h>
+#include <kernel/gpio.h>
+#include <kernel/interrupt.h>
+#include <kernel/timer.h>
+
+#define readSPIReg(reg) regRead32(BCM2835_SPI0_BASE + (reg))
+#define writeSPIReg(reg, val) regWrite32(BCM2835_SPI0_BASE + (reg), (val))
+
+#define CORE_CLOCK 250000000 //[Hz] nominal
+
+#define SPI_QUEUE_SIZE 8
+
+/* queued transactions (w/o the active one): ring buffer */
+static struct SPITransaction* queue[SPI_QUEUE_SIZE];
+static int queue_head = 0, queue_count = 0;
+
+static struct SPITransaction* current = NULL;
+static int current_tx_pos, current_rx_pos; /* bytes written to/read from the FIFO */
+static Timestamp current_start;
+
+static struct SPIStatistics statistics;
+
+static int submit(struct SPITransaction* transaction, int async);
+static void startNext();
+static void process();
+
+
+void initSPI() {
+	for(int pin = 7; pin <= 11; ++pin)
+		setGpioFunction(pin, 0b100); //ALT0: CE1, CE0, MISO, MOSI, SCLK
+	writeSPIReg(BCM2835_SPI_CS, BCM2835_SPI_CS_CLEAR_TX | BCM2835_SPI_CS_CLEAR_RX);
+	enableSPIIRQ();
+}
+
+/*
+ * the flight controller accesses the bus from the timer IRQ. so the queue
+ * must only be changed with disabled interrupts.
+ */
+int spiTransfer(struct SPITransaction* transaction) {
+	transaction->callback = NULL;
+	int ret = submit(transaction, 0);
+	if(ret != SUCCESS) return ret;
+	Timestamp start = getTimestamp();
+	while(transaction->pending)
+		spiPoll();
+	statistics.wait_time_us += getTimestamp() - start;
+	return transaction->result;
+}
+
+int spiSubmit(struct SPITransaction* transaction) {
+	return submit(transaction, 1);
+}
+
+static int submit(struct SPITransaction* transaction, int async) {
+	if(transaction->len <= 0 || transaction->len > 0xffff
+			|| transaction->cs < 0 || transaction->cs > 1
+			|| transaction->mode < 0 || transaction->mode > 3
+			|| transaction->clock_hz == 0)
+		return -E_INVALID_PARAM;
+	disableInterrupts();
+	if(queue_count >= SPI_QUEUE_SIZE) {
+		++statistics.queue_full;
+		enableInterrupts();
+		return -E_BUFFER_FULL;
+	}
+	transaction->pending = 1;
+	transaction->async = async;
+	transaction->result = 0;
+	queue[(queue_head + queue_count) % SPI_QUEUE_SIZE] = transaction;
+	++queue_count;
+	if(!current) startNext();
+	else process();
+	enableInterrupts();
+	return SUCCESS;
+}
+
+void spiPoll() {
+	disableInterrupts();
+	process();
+	enableInterrupts();
+}
+
+void archHandleSPIIRQ() {
+	process();
+}
+
+void spiGetStatistics(struct SPIStatistics* stats) {
+	disableInterrupts();
+	*stats = statistics;
+	enableInterrupts();
+}
+
+void spiResetStatistics() {
+	disableInterrupts();
+	memset(&statistics, 0, sizeof(statistics));
+	enableInterrupts();
+}
+
+
+/* even divider for the highest clock <= clock_hz (0 means 65536) */
+static inline uint32 clockDivider(uint32 clock_hz) {
+	uint32 divider = (CORE_CLOCK + clock_hz - 1) / clock_hz;
+	if(divider & 1) ++divider;
+	if(divider < 2) divider = 2;
+	if(divider >= 65536) divider = 0;
+	return divider;
+}
+
+/*
+ * transfer as much as the FIFO allows. at most BCM2835_SPI_FIFO_SIZE bytes
+ * are in flight, so the RX FIFO cannot overflow.
+ */
+static inline void transferFIFO() {
+	while(current_rx_pos < current_tx_pos
+			&& (readSPIReg(BCM2835_SPI_CS) & BCM2835_SPI_CS_RXD)) {
+		char c = (char)readSPIReg(BCM2835_SPI_FIFO);
+		int pos = current_rx_pos++ - current->rx_skip;
+		if(pos >= 0 && current->rx) current->rx[pos] = c;
+	}
+	while(current_tx_pos < current->len
+			&& current_tx_pos - current_rx_pos < BCM2835_SPI_FIFO_SIZE
+			&& (readSPIReg(BCM2835_SPI_CS) & BCM2835_SPI_CS_TXD)) {
+		char c = current_tx_pos < current->tx_len ? current->tx[current_tx_pos] : 0;
+		writeSPIReg(BCM2835_SPI_FIFO, (uint32)(uchar)c);
+		++current_tx_pos;
+	}
+}
+
+static void finish(int result) {
+	writeSPIReg(BCM2835_SPI_CS, BCM2835_SPI_CS_CLEAR_TX | BCM2835_SPI_CS_CLEAR_RX);
+
+	struct SPITransaction* transaction = current;
+	current = NULL;
+	++statistics.transfers;
+	statistics.bus_time_us += getTimestamp() - current_start;
+	if(result < 0) ++statistics.errors;
+	else statistics.bytes += result;
+	if(transaction->async) ++statistics.async_transfers;
+	transaction->result = result;
+	transaction->pending = 0;
+	if(transaction->callback) transaction->callback(transaction);
+
+	startNext();
+}
+
+/* start the next transaction in the queue (if the controller is idle) */
+static void startNext() {
+	if(current || queue_count == 0) return;
+	current = queue[queue_head];
+	queue_head = (queue_head + 1) % SPI_QUEUE_SIZE;
+	--queue_count;
+	current_tx_pos = current_rx_pos = 0;
+	current_start = getTimestamp();
+
+	writeSPIReg(BCM2835_SPI_CLK, clockDivider(current->clock_hz));
+	uint32 cs = current->cs
+		| (current->mode & 1 ? BCM2835_SPI_CS_CPHA : 0)
+		| (current->mode & 2 ? BCM2835_SPI_CS_CPOL : 0);
+	writeSPIReg(BCM2835_SPI_CS, cs | BCM2835_SPI_CS_CLEAR_TX | BCM2835_SPI_CS_CLEAR_RX);
+	//fill the FIFO before the IRQ's are enabled, short transfers need one IRQ
+	writeSPIReg(BCM2835_SPI_CS, cs | BCM2835_SPI_CS_TA);
+	transferFIFO();
+	writeSPIReg(BCM2835_SPI_CS, cs | BCM2835_SPI_CS_TA
+			| BCM2835_SPI_CS_INTR | BCM2835_SPI_CS_INTD);
+}
+
+/* state machine: called from the IRQ handler or when polling */
+static void process() {
+	if(!current) return;
+
+	transferFIFO();
+	if(current_rx_pos == current->len
+			&& (readSPIReg(BCM2835_SPI_CS) & BCM2835_SPI_CS_DONE))
+		finish(current_rx_pos);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef BCM2835_SPI_HEADER_H_
+#define BCM2835_SPI_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "common.h"
+
+
+/* SPI0: gpio 7-11 (CE1, CE0, MISO, MOSI, SCLK) */
+#define BCM2835_SPI0_BASE	(BCM2835_PERI_BASE+0x00204000)
+
+#define BCM2835_SPI_CS		0x0
+#define BCM2835_SPI_FIFO	0x4
+#define BCM2835_SPI_CLK		0x8
+#define BCM2835_SPI_DLEN	0xc
+#define BCM2835_SPI_LTOH	0x10
+#define BCM2835_SPI_DC		0x14
+
+#define BCM2835_SPI_CS_CS_MASK	0x3
+#define BCM2835_SPI_CS_CPHA	BIT(2)
+#define BCM2835_SPI_CS_CPOL	BIT(3)
+#define BCM2835_SPI_CS_CLEAR_TX	BIT(4)
+#define BCM2835_SPI_CS_CLEAR_RX	BIT(5)
+#define BCM2835_SPI_CS_CSPOL	BIT(6)
+#define BCM2835_SPI_CS_TA	BIT(7)
+#define BCM2835_SPI_CS_DMAEN	BIT(8)
+#define BCM2835_SPI_CS_INTD	BIT(9)
+#define BCM2835_SPI_CS_INTR	BIT(10)
+#define BCM2835_SPI_CS_ADCS	BIT(11)
+#define BCM2835_SPI_CS_DONE	BIT(16)
+#define BCM2835_SPI_CS_RXD	BIT(17)
+#define BCM2835_SPI_CS_TXD	BIT(18)
+#define BCM2835_SPI_CS_RXR	BIT(19)
+#define BCM2835_SPI_CS_RXF	BIT(20)
+
+#define BCM2835_SPI_FIFO_SIZE	16 /* [bytes] when not using DMA */
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* BCM2835_SPI_HEADER_H_ */
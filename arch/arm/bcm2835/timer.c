@@ -18,9 +18,15 @@
 
 
 void setNextTimerIRQ(uint ms) {
-	uint pre_divide = 250-1; //system clock runs with 250 MHz
+	setTimerIRQPeriodMicro(ms*1000);
+}
+
+void setTimerIRQPeriodMicro(uint usec) {
+	uint pre_divide = 250-1; //system clock runs with 250 MHz -> 1 MHz
 	//FIXME: system clock can dynamically change
 	regWrite32(ARM_TIMER_PRE_DIVIDE, pre_divide); //max 10 bits wide
 
-	regWrite32(ARM_TIMER_LOAD, ms*1000);
+	//the IRQ fires when the counter reaches 0, then it is reloaded with LOAD
+	//-> the period is LOAD+1 ticks. writing LOAD restarts the counter
+	regWrite32(ARM_TIMER_LOAD, usec-1);
 }
@@ -44,6 +44,13 @@ extern "C" {
  */
 void setNextTimerIRQ(uint ms);
 
+/**
+ * set the period of the (periodic) ARM timer interrupt. the counter is
+ * restarted immediately, so the next IRQ is in usec microseconds.
+ * @param usec period in microseconds, >0
+ */
+void setTimerIRQPeriodMicro(uint usec);
+
 #ifdef __cplusplus
 }
 #endif
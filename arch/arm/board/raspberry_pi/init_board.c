@@ -16,6 +16,7 @@
 #include <kernel/led.h>
 #include <kernel/serial.h>
 #include <kernel/i2c.h>
+#include <kernel/spi.h>
 #include <kernel/utils.h>
 
 static void uartPrintkOutput(char c) {
@@ -31,6 +32,7 @@ void initBoard() {
 	addPrintkOutput(&uartPrintkOutput);
 	
 	initI2C();
+	initSPI();
 }
 
 
@@ -11,6 +11,7 @@ src += $(THIS_DIR)atag.c
 src += $(THIS_DIR)interrupt.S
 src += $(THIS_DIR)interrupt.c
 src += $(THIS_DIR)mmu.c
+src += $(THIS_DIR)timer.c
 
 MODULES_LOC += bcm2835/
 
@@ -55,6 +55,14 @@ void __disableInterrupts() {
 	::: "r1");
 }
 
+void __enableFIQ() {
+	__asm__ volatile(
+	"mrs r1, cpsr;"
+	"bic r1, r1, #0x40;"    // enable FIQ
+	"msr cpsr_c, r1;"
+	::: "r1");
+}
+
 uint inInterrupt() {
 	return in_interrupt;
 }
@@ -77,6 +85,16 @@ void irqHandler(int irq_number) {
 
 		handleGpioIRQ();
 
+		break;
+	case ARM_IRQ_NR_I2C:
+
+		archHandleI2CIRQ();
+
+		break;
+	case ARM_IRQ_NR_SPI:
+
+		archHandleSPIIRQ();
+
 		break;
 	default:
 		printk_w("Got an unknown interrupt! (%i)\n", irq_number);
@@ -85,3 +103,15 @@ void irqHandler(int irq_number) {
 
 	--in_interrupt;
 }
+
+/*
+ * fast interrupt handler: the gpio IRQ (see enableGpioIRQ()). it can preempt
+ * irqHandler(). in_interrupt is restored before returning, so this does not
+ * disturb an increment that it interrupted.
+ * interrupts: IRQ & FIQ disabled
+ */
+void fiqHandler() {
+	++in_interrupt;
+	handleGpioIRQ();
+	--in_interrupt;
+}
@@ -21,6 +21,8 @@ extern "C" {
 
 
 #define ARCH_HAS_INTERRUPT
+/* the gpio IRQ is a FIQ: it preempts the other IRQ handlers */
+#define ARCH_HAS_GPIO_FIQ
 
 #ifndef __ASSEMBLY__
 #include <kernel/types.h>
@@ -31,8 +33,13 @@ extern "C" {
  */
 void archInitInterrupts();
 
+/* enable the FIQ in general (it is never disabled again) */
+void __enableFIQ();
+
 void archHandleTimerIRQ();
 void archHandleGpioIRQ();
+void archHandleI2CIRQ(); /* bcm2835/i2c.c */
+void archHandleSPIIRQ(); /* bcm2835/spi.c */
 
 uint getTimerIRQCounter();
 void resetTimerIRQCounter();
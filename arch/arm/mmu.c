@@ -48,6 +48,11 @@ static void initRegionsPageTableEntries(const mem_region* regions, int count,
 				page_flags = (0x1<<1)  /*| (1<<3) C */ | (1<<2) /* B */ 
 					| (3<<4) /* AP */ |  (1<<10) /* S */;
 				break;
+			case mem_region_type_dma:
+				/* strongly ordered: DMA sees CPU writes immediately */
+				page_flags = (0x1<<1) /* | (1<<3) C | (1<<2) B */
+					| (3<<4) /* AP */;
+				break;
 		}
 		for(uint k=start_page; k<end_page; ++k) {
 			uint32 phys_addr = k;
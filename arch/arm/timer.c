@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <kernel/timer.h>
+
+static uint32 cycle_counter_frequency = 0;
+
+void initCycleCounter() {
+	/* performance monitor control register (PMNC): enable the counters (E)
+	 * & reset the cycle counter (C). the divider (D) is off: count every cycle */
+	uint32 pmnc = (1<<0) | (1<<2);
+	__asm__ volatile("mcr p15, 0, %0, c15, c12, 0" :: "r"(pmnc));
+
+	/* calibrate */
+	const uint calibration_time = 10000; //[us]
+	Timestamp start = getTimestamp();
+	while(getTimestamp() == start); //wait for the next tick
+	start = getTimestamp();
+	uint32 start_cycles = getCycleCount();
+	while(getTimestamp() - start < calibration_time);
+	uint32 cycles = getCycleCount() - start_cycles;
+	cycle_counter_frequency = cycles * (1000000 / calibration_time);
+}
+
+uint32 getCycleCounterFrequency() {
+	return cycle_counter_frequency;
+}
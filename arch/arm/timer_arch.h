@@ -53,6 +53,25 @@ static inline Timestamp getMillis() {
 	return getTimestamp()/1000;
 }
 
+
+#define ARCH_HAS_CYCLE_COUNTER
+
+/**
+ * enable the ARM11 cycle counter (CCNT) & measure its frequency against the
+ * system timer (takes 10ms). called from initArch()
+ */
+void initCycleCounter();
+
+/** current value of the CPU cycle counter (wraps after a few seconds) */
+static inline uint32 getCycleCount() {
+	uint32 cycles;
+	__asm__ volatile("mrc p15, 0, %0, c15, c12, 1" : "=r"(cycles));
+	return cycles;
+}
+
+/** frequency of the cycle counter in Hz (CPU clock) */
+uint32 getCycleCounterFrequency();
+
 #ifdef __cplusplus
 }
 #endif
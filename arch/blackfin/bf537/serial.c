@@ -75,6 +75,10 @@ bool uartAvailable() {
 	return regRead16Bit(BF537_UART0_LSR, BF537_LSR_DR);
 }
 
+bool uartWriteReady() {
+	return regRead16Bit(BF537_UART0_LSR, BF537_LSR_THRE);
+}
+
 
 
 
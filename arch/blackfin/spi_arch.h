@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef SPI_ARCH_HEADER_H_
+#define SPI_ARCH_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//#include <spi_board.h>
+
+
+#ifdef BOARD_HAS_SPI
+# define ARCH_HAS_SPI
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPI_ARCH_HEADER_H_ */
+
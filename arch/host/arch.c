@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <arch.h>
+
+#include <kernel/printk.h>
+
+#include <stdio.h>
+
+extern char* g_host_stack_start; /* mem.c */
+
+static void printkStdout(char c) {
+	putchar(c);
+}
+
+void initArch() {
+	char stack_start;
+	g_host_stack_start = &stack_start;
+
+	addPrintkOutput(printkStdout);
+
+	/* from now on printk should work */
+}
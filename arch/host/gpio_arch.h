@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef GPIO_ARCH_HEADER_H_
+#define GPIO_ARCH_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* no GPIO's, but the kernel keeps per-pin IRQ counters */
+//#define ARCH_HAS_GPIO
+
+#define GPIO_COUNT 32
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* GPIO_ARCH_HEADER_H_ */
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef INTERRUPT_ARCH_HEADER_H_
+#define INTERRUPT_ARCH_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the simulation is single threaded: there are no IRQ's */
+//#define ARCH_HAS_INTERRUPT
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* INTERRUPT_ARCH_HEADER_H_ */
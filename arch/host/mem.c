@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * memory statistics of the host process (the kernel memory management is not
+ * used on the host: allocations go to the C library)
+ */
+
+#include <kernel/mem.h>
+#include <kernel/malloc.h>
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+char* g_host_stack_start = NULL;
+
+size_t kfreeMallocSpace() {
+	struct mallinfo2 info = mallinfo2();
+	return info.fordblks;
+}
+
+size_t ktotalMallocSpace() {
+	struct mallinfo2 info = mallinfo2();
+	return info.arena + info.hblkhd;
+}
+
+int getMaxStackSize() {
+	struct rlimit limit;
+	if(getrlimit(RLIMIT_STACK, &limit) || limit.rlim_cur == RLIM_INFINITY
+			|| limit.rlim_cur > INT_MAX)
+		return MAX_STACK_SIZE;
+	return (int)limit.rlim_cur;
+}
+
+int getCurrentStackSize() {
+	int dummy;
+	char* stack_current = (char*)&dummy;
+	if(!g_host_stack_start) return 0;
+	return (int)(g_host_stack_start - stack_current);
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef ARCH_MEM_HEADER_H_
+#define ARCH_MEM_HEADER_H_
+
+#include <kernel/utils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define initDeviceMemRegions() NOP
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ARCH_MEM_HEADER_H_ */
+
+
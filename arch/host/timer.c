@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <kernel/timer.h>
+
+#include <time.h>
+
+Timestamp g_virtual_timestamp = 0;
+
+void __udelay(uint usec) {
+	advanceVirtualTime(usec);
+}
+
+uint32 getCycleCount() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint32)((uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec);
+}
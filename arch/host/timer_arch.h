@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef ARCH_TIMER_HEADER_H_
+#define ARCH_TIMER_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARCH_HAS_TIMER
+
+#include <kernel/types.h>
+
+typedef uint32 Timestamp;
+typedef int32 TimestampSigned;
+
+/*
+ * the host uses a virtual clock: time only advances with udelay() and
+ * advanceVirtualTime(). this makes a simulation deterministic and lets it run
+ * as fast as the CPU allows (a busy wait on getTimestamp() never returns!).
+ */
+
+void __udelay(uint usec);
+
+/** advances the virtual clock by usec */
+#define udelay(usec) __udelay(usec)
+
+extern Timestamp g_virtual_timestamp;
+
+/** current timestamp in microseconds */
+static inline Timestamp getTimestamp() {
+	return g_virtual_timestamp;
+}
+
+/** current timestamp in milliseconds */
+static inline Timestamp getMillis() {
+	return getTimestamp()/1000;
+}
+
+/** advance the virtual clock (never goes backwards) */
+static inline void advanceVirtualTime(uint usec) {
+	g_virtual_timestamp += usec;
+}
+
+
+#define ARCH_HAS_CYCLE_COUNTER
+
+/* the cycle counter measures real (host) time, so the profiler shows the
+ * actual execution times on the host */
+
+#define initCycleCounter() do {} while(0)
+
+/** host monotonic clock in nanoseconds (wraps after ~4 seconds) */
+uint32 getCycleCount();
+
+/** frequency of the cycle counter in Hz */
+#define getCycleCounterFrequency() 1000000000u
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ARCH_TIMER_HEADER_H_ */
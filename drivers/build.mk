@@ -7,6 +7,7 @@ MODULES_LOC :=
 
 #src += $(THIS_DIR)mmu.c
 MODULES_LOC += i2c/
+MODULES_LOC += spi/
 MODULES_LOC += ppm/
 
 
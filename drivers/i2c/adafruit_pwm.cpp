@@ -51,8 +51,7 @@ bool I2CAdafruitPWM::setPWMFreq(int freq) {
 int I2CAdafruitPWM::getPWMFreq() {
 	char buffer[1];
 	buffer[0] = PRESCALE;
-	if(write(buffer, 1) != 1) return 0;
-	if(read(buffer, 1) != 1) return 0;
+	if(writeRead(buffer, 1, buffer, 1) != 1) return 0;
 	int prescale = (uchar)buffer[0];
 	return 25e6/4096 / (prescale+1);
 }
@@ -67,11 +66,27 @@ bool I2CAdafruitPWM::setPWM(int channel, uint16 on_time, uint16 off_time) {
 	return write(buffer, 5) == 5;
 }
 
+bool I2CAdafruitPWM::setPWMMulti(int first_channel, const uint16* duty_times,
+		int num_channels) {
+	ASSERT(first_channel >= 0 && num_channels > 0 && first_channel+num_channels <= 16);
+
+	char buffer[1+4*16];
+	buffer[0] = LED0_ON_L + 4*first_channel;
+	for(int i=0; i<num_channels; ++i) {
+		uint16 off_time = std::min((uint16)4095, duty_times[i]);
+		buffer[1+4*i] = 0;
+		buffer[2+4*i] = 0;
+		buffer[3+4*i] = (char)(off_time & 0xff);
+		buffer[4+4*i] = (char)(off_time >> 8);
+	}
+	int len = 1+4*num_channels;
+	return write(buffer, len) == len;
+}
+
 uint16 I2CAdafruitPWM::getPWMDuty(int channel) {
 	char buffer[2];
 	buffer[0] = LED0_OFF_L + 4*channel;
-	if(write(buffer, 1) != 1) return 0;
-	if(read(buffer, 2) != 2) return 0;
+	if(writeRead(buffer, 1, buffer, 2) != 2) return 0;
 	return (uint16)buffer[0] | ((uint16)(buffer[1]&0xf)<<8);
 }
 
@@ -89,6 +89,16 @@ public:
 		return setPWM(channel, 0, std::min((uint16)4095, duty_time));
 	}
 	
+	/**
+	 * change the duty cycle of consecutive channels with a single transaction
+	 * (needs auto increment, which is enabled by reset()). on-time is 0.
+	 * @param first_channel [0,15]
+	 * @param duty_times 12bit values (clamped to 4095), one per channel
+	 * @param num_channels first_channel+num_channels must be <= 16
+	 * @return true on success
+	 */
+	bool setPWMMulti(int first_channel, const uint16* duty_times, int num_channels);
+	
 	/**
 	 * get 'off time' (if 'on time' is 0 then this is the pulse length)
 	 */
@@ -9,6 +9,7 @@ src += $(THIS_DIR)adafruit_pwm.cpp
 src += $(THIS_DIR)bmp180_barometer.cpp
 src += $(THIS_DIR)hmc5883l_compass.cpp
 src += $(THIS_DIR)mpu-6050_accel_gyro.cpp
+src += $(THIS_DIR)mpu-6050_dmp.cpp
 #MODULES_LOC += aux/
 
 
@@ -16,5 +16,12 @@
 #include <kernel/utils.h>
 
 I2CHMC5883L::I2CHMC5883L(int addr)
-	: HMC5883L((uint8_t)addr) {
+	: HMC5883L((uint8_t)addr), m_addr((uint8_t)addr) {
+}
+
+bool I2CHMC5883L::enableRegisterCache() {
+	if(!I2Cdev::enableCache(m_addr)) return false;
+	I2Cdev::setCacheVolatile(m_addr, HMC5883L_RA_MODE);
+	I2Cdev::setCacheVolatile(m_addr, HMC5883L_RA_STATUS);
+	return true;
 }
@@ -41,7 +41,15 @@ public:
 	
 	I2CHMC5883L(int addr=0b0011110);
 
+	/**
+	 * cache the configuration registers (see I2Cdev::enableCache()). the
+	 * mode register is excluded: the device changes it in single mode.
+	 * @return true on success
+	 */
+	bool enableRegisterCache();
+
 private:
+	uint8_t m_addr;
 };
 
 
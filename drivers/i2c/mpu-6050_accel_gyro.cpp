@@ -16,5 +16,81 @@
 #include <kernel/utils.h>
 
 I2CMPU6050::I2CMPU6050(int addr) 
-	: MPU6050((uint8_t)addr) {
+	: MPU6050((uint8_t)addr), m_addr((uint8_t)addr) {
+}
+
+bool I2CMPU6050::getMotion(Motion& motion) {
+	uint8_t buffer[14];
+	if(I2Cdev::readBytes(m_addr, MPU6050_RA_ACCEL_XOUT_H, sizeof(buffer), buffer)
+			!= (int8_t)sizeof(buffer))
+		return false;
+	int16_t values[7];
+	for(int i=0; i<7; ++i)
+		values[i] = (((int16_t)buffer[2*i]) << 8) | buffer[2*i+1];
+	for(int i=0; i<3; ++i) {
+		motion.accel[i] = values[i];
+		motion.gyro[i] = values[4+i];
+	}
+	motion.temperature = values[3];
+	return true;
+}
+
+void I2CMPU6050::setMotionFIFO(bool enabled) {
+	setFIFOEnabled(false);
+	setAccelFIFOEnabled(enabled);
+	setXGyroFIFOEnabled(enabled);
+	setYGyroFIFOEnabled(enabled);
+	setZGyroFIFOEnabled(enabled);
+	resetFIFO();
+	setFIFOEnabled(enabled);
+}
+
+int I2CMPU6050::readFIFOCount() {
+	uint8_t buffer[2];
+	if(I2Cdev::readBytes(m_addr, MPU6050_RA_FIFO_COUNTH, 2, buffer) != 2)
+		return -E_IO;
+	return (((int)buffer[0]) << 8) | buffer[1];
+}
+
+int I2CMPU6050::readFIFOMotion(Motion* motion, int num_samples) {
+	if(num_samples <= 0 || num_samples > fifo_max_burst) return -E_INVALID_PARAM;
+	uint8_t buffer[fifo_max_burst * fifo_sample_size];
+	int ret = readFIFO(buffer, num_samples * fifo_sample_size);
+	if(ret < 0) return ret;
+	const uint8_t* data = buffer;
+	for(int k=0; k<num_samples; ++k) {
+		for(int i=0; i<3; ++i) {
+			motion[k].accel[i] = (((int16_t)data[2*i]) << 8) | data[2*i+1];
+			motion[k].gyro[i] = (((int16_t)data[6+2*i]) << 8) | data[6+2*i+1];
+		}
+		motion[k].temperature = 0;
+		data += fifo_sample_size;
+	}
+	return num_samples;
+}
+
+int I2CMPU6050::readFIFO(uint8_t* data, int length) {
+	if(length <= 0 || length > 255) return -E_INVALID_PARAM;
+	if(I2Cdev::readBytes(m_addr, MPU6050_RA_FIFO_R_W, (uint8_t)length, data) != length)
+		return -E_IO;
+	return length;
+}
+
+bool I2CMPU6050::enableRegisterCache() {
+	if(!I2Cdev::enableCache(m_addr)) return false;
+	static const uint8_t volatile_registers[] = {
+		MPU6050_RA_I2C_SLV4_CTRL, //enable bit is cleared after the transfer
+		MPU6050_RA_I2C_MST_STATUS,
+		MPU6050_RA_DMP_INT_STATUS,
+		MPU6050_RA_INT_STATUS,
+		MPU6050_RA_SIGNAL_PATH_RESET, //self-clearing reset bits
+		MPU6050_RA_USER_CTRL,
+		MPU6050_RA_PWR_MGMT_1,
+		MPU6050_RA_MEM_START_ADDR, //auto-increment
+		MPU6050_RA_MEM_R_W,
+		MPU6050_RA_FIFO_R_W,
+	};
+	for(uint8_t reg : volatile_registers)
+		I2Cdev::setCacheVolatile(m_addr, reg);
+	return true;
 }
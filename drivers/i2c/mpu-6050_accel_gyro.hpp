@@ -43,7 +43,60 @@ public:
 	 */
 	I2CMPU6050(int addr=0x68);
 	
+	static const char* deviceName() { return "MPU-6050"; }
+	
+	/** raw data registers (same values as getMotion6() & getTemperature()) */
+	struct Motion {
+		int16_t accel[3];
+		int16_t temperature; /** [deg C] = temperature/340 + 36.53 */
+		int16_t gyro[3];
+	};
+	
+	/**
+	 * read accel, temperature & gyro with a single burst read of all 14 data
+	 * registers, so that all values are from the same sample
+	 * @return true on success
+	 */
+	bool getMotion(Motion& motion);
+	
+	
+	/* FIFO: accel & gyro samples (no temperature) at the sample rate */
+	
+	static constexpr int fifo_size = 1024; /** [bytes] */
+	static constexpr int fifo_sample_size = 12; /** [bytes] */
+	/** max number of samples per readFIFOMotion() (limited by the I2Cdev length) */
+	static constexpr int fifo_max_burst = 255 / fifo_sample_size;
+	
+	/** enable/disable writing accel & gyro samples to the FIFO. resets the FIFO */
+	void setMotionFIFO(bool enabled);
+	
+	/** @return number of bytes in the FIFO or <0 on error */
+	int readFIFOCount();
+	
+	/**
+	 * read samples from the FIFO with a single burst read (temperature is set to 0)
+	 * @param num_samples in [1, fifo_max_burst]. they must be in the FIFO
+	 * @return num_samples or <0 on error
+	 */
+	int readFIFOMotion(Motion* motion, int num_samples);
+	
+	/**
+	 * read raw bytes from the FIFO with a single burst read
+	 * @param length in [1, 255]. they must be in the FIFO
+	 * @return length or <0 on error
+	 */
+	int readFIFO(uint8_t* data, int length);
+	
+	/**
+	 * cache the configuration registers (see I2Cdev::enableCache()), so that
+	 * setters need no register read. status, data & self-clearing
+	 * registers are excluded.
+	 * @return true on success
+	 */
+	bool enableRegisterCache();
+	
 private:
+	uint8_t m_addr;
 };
 
 
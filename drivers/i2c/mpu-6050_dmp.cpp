@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * MotionApps 2.0 DMP firmware & the dmp*() methods of the MPU6050 class.
+ * MPU6050_6Axis_MotionApps20.h contains non-inline definitions, so it must be
+ * included exactly once.
+ */
+
+#include <kernel/timer.h> /* delay() */
+#include <3rdparty/utils/i2cdevlib/MPU6050/MPU6050_6Axis_MotionApps20.h>
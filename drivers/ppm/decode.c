@@ -15,29 +15,62 @@
 #include "decode.h"
 
 #include <kernel/interrupt.h>
-
-PPMSignal g_ppm_signals[MAX_PPM_CHANNELS];
+#include <kernel/utils.h>
 
 static volatile int registered_gpio_pin;
-static volatile int current_ppm_channel;
+static volatile int current_ppm_channel; //-1: wait for the sync pulse
 static volatile uint sync_pulse_length; //in microseconds
+static volatile int frame_channels;
 static volatile Timestamp last_pulse_start;
 
+/* the frame being decoded & the last complete one. published_frame is written
+ * by the IRQ handler only, while sequence is odd */
+static PPMFrame decoded_frame;
+static PPMFrame published_frame;
+static volatile uint32 sequence = 0;
+
 
 /** callback to handle IRQ's from GPIOs */
 void PPMGpioIRQPinHandler(int pin, int value);
 
 
 
-int setupPPMDecoder(int gpio_pin, uint min_sync_pulse_length) {
+int setupPPMDecoder(int gpio_pin, uint min_sync_pulse_length, int num_channels) {
+	if(num_channels < 1 || num_channels > MAX_PPM_CHANNELS)
+		return -E_INVALID_PARAM;
 	//initialize
 	sync_pulse_length = min_sync_pulse_length;
+	frame_channels = num_channels;
 	current_ppm_channel = -1;
+	decoded_frame.frame_counter = 0;
 	
 	registered_gpio_pin = gpio_pin;
 	return registerGpioIrqEventHandler(PPMGpioIRQPinHandler);
 }
 
+bool getPPMFrame(PPMFrame* frame) {
+	uint32 seq;
+	do {
+		seq = sequence;
+		COMPILER_BARRIER();
+		*frame = published_frame;
+		COMPILER_BARRIER();
+	} while((seq & 1) || seq != sequence);
+	return seq != 0;
+}
+
+/* called from the IRQ handler */
+static void publishFrame() {
+	decoded_frame.num_channels = current_ppm_channel;
+	++decoded_frame.frame_counter;
+	++sequence;
+	COMPILER_BARRIER();
+	published_frame = decoded_frame;
+	COMPILER_BARRIER();
+	++sequence;
+	current_ppm_channel = -1;
+}
+
 
 void PPMGpioIRQPinHandler(int pin, int value) {
 	if(pin != registered_gpio_pin) return;
@@ -47,11 +80,13 @@ void PPMGpioIRQPinHandler(int pin, int value) {
 	} else { //pulse end
 		Timestamp cur_time = g_irq_gpio_low_last_timestamp[pin];
 		if(cur_time - last_pulse_start > sync_pulse_length) {
+			//less channels than expected: the frame ends here
+			if(current_ppm_channel > 0) publishFrame();
 			current_ppm_channel = 0;
-		} else if(current_ppm_channel >= 0 && current_ppm_channel < MAX_PPM_CHANNELS) {
-			g_ppm_signals[current_ppm_channel].pulse_start = last_pulse_start;
-			g_ppm_signals[current_ppm_channel].pulse_stop = cur_time;
-			++current_ppm_channel;
+		} else if(current_ppm_channel >= 0) {
+			decoded_frame.pulse_length[current_ppm_channel] = cur_time - last_pulse_start;
+			decoded_frame.timestamp = cur_time;
+			if(++current_ppm_channel == frame_channels) publishFrame();
 		}
 	}
 }
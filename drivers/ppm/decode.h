@@ -27,15 +27,15 @@
 extern "C" {
 #endif
 
-typedef struct _PPMSignal {
-	Timestamp pulse_start;
-	Timestamp pulse_stop; //pulse length in ms = (stop - start)/1000
-} PPMSignal;
-
-
 #define MAX_PPM_CHANNELS 8
 
-extern PPMSignal g_ppm_signals[MAX_PPM_CHANNELS];
+/** a complete frame: the pulses after a sync pulse */
+typedef struct _PPMFrame {
+	uint32 frame_counter; /** number of frames since the setup (first is 1) */
+	Timestamp timestamp; /** end of the last pulse */
+	int num_channels;
+	uint32 pulse_length[MAX_PPM_CHANNELS]; /** in microseconds */
+} PPMFrame;
 
 
 /**
@@ -45,9 +45,22 @@ extern PPMSignal g_ppm_signals[MAX_PPM_CHANNELS];
  * FIXME: does not check if it is already registered & there is no unregister!
  * @param min_sync_pulse_length_ms minimum length of the sync pulse in microseconds
  *        (4000 or 5000 is a good value)
+ * @param num_channels the frame is published after this many pulses (the
+ *        following ones are ignored), or at the next sync pulse if the
+ *        signal has less channels (the frame then has less num_channels).
+ *        [1, MAX_PPM_CHANNELS]
  * @return 0 on success
  */
-int setupPPMDecoder(int gpio_pin, uint min_sync_pulse_length);
+int setupPPMDecoder(int gpio_pin, uint min_sync_pulse_length, int num_channels);
+
+/**
+ * get the last complete frame. this does not disable interrupts: the frame
+ * is published with a sequence counter by the IRQ handler & the copy is
+ * retried if a new frame arrived meanwhile, so all pulses are from the same
+ * frame.
+ * @return false if there was no frame yet
+ */
+bool getPPMFrame(PPMFrame* frame);
 
 
 #ifdef __cplusplus
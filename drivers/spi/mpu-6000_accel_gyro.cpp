@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "mpu-6000_accel_gyro.hpp"
+#include <kernel/utils.h>
+#include <kernel/timer.h>
+
+SPIMPU6000::SPIMPU6000(FuncSPITransfer func_transfer, int cs, uint32 fast_clock_hz)
+	: m_device(func_transfer, cs, 3, 1000000, fast_clock_hz) {
+}
+
+bool SPIMPU6000::initialize() {
+	if(!m_device.writeRegister(MPU6000_RA_PWR_MGMT_1, MPU6000_PWR1_DEVICE_RESET))
+		return false;
+	delay(100);
+	m_device.writeRegister(MPU6000_RA_SIGNAL_PATH_RESET, 0x07); //gyro, accel & temp
+	delay(100);
+	m_device.writeRegister(MPU6000_RA_PWR_MGMT_1, MPU6000_PWR1_CLOCK_PLL_XGYRO);
+	//the I2C interface would respond to other traffic on the SPI pins
+	return m_device.writeRegister(MPU6000_RA_USER_CTRL, MPU6000_USERCTRL_I2C_IF_DIS);
+}
+
+bool SPIMPU6000::testConnection() {
+	uint8_t who_am_i;
+	if(!m_device.readRegister(MPU6000_RA_WHO_AM_I, who_am_i)) return false;
+	return who_am_i == 0x68 /* MPU-6000 */ || who_am_i == 0x70 /* MPU-6500 */
+		|| who_am_i == 0x71 /* MPU-9250 */ || who_am_i == 0x73 /* MPU-9255 */;
+}
+
+bool SPIMPU6000::getMotion(Motion& motion) {
+	uint8_t buffer[14];
+	if(m_device.readRegisters(MPU6000_RA_ACCEL_XOUT_H, buffer, sizeof(buffer), true)
+			!= (int)sizeof(buffer))
+		return false;
+	int16_t values[7];
+	for(int i=0; i<7; ++i)
+		values[i] = (((int16_t)buffer[2*i]) << 8) | buffer[2*i+1];
+	for(int i=0; i<3; ++i) {
+		motion.accel[i] = values[i];
+		motion.gyro[i] = values[4+i];
+	}
+	motion.temperature = values[3];
+	return true;
+}
+
+void SPIMPU6000::setMotionFIFO(bool enabled) {
+	writeBits(MPU6000_RA_USER_CTRL, MPU6000_USERCTRL_FIFO_EN, 0);
+	m_device.writeRegister(MPU6000_RA_FIFO_EN, enabled ? MPU6000_FIFO_EN_ACCEL_GYRO : 0);
+	resetFIFO();
+	if(enabled) writeBits(MPU6000_RA_USER_CTRL, MPU6000_USERCTRL_FIFO_EN, 0xff);
+}
+
+void SPIMPU6000::resetFIFO() {
+	writeBits(MPU6000_RA_USER_CTRL, MPU6000_USERCTRL_FIFO_RESET, 0xff);
+}
+
+int SPIMPU6000::readFIFOCount() {
+	uint8_t buffer[2];
+	if(m_device.readRegisters(MPU6000_RA_FIFO_COUNTH, buffer, 2, true) != 2)
+		return -E_IO;
+	return (((int)buffer[0]) << 8) | buffer[1];
+}
+
+int SPIMPU6000::readFIFOMotion(Motion* motion, int num_samples) {
+	if(num_samples <= 0 || num_samples > fifo_max_burst) return -E_INVALID_PARAM;
+	uint8_t buffer[fifo_max_burst * fifo_sample_size];
+	int length = num_samples * fifo_sample_size;
+	if(m_device.readRegisters(MPU6000_RA_FIFO_R_W, buffer, length, true) != length)
+		return -E_IO;
+	const uint8_t* data = buffer;
+	for(int k=0; k<num_samples; ++k) {
+		for(int i=0; i<3; ++i) {
+			motion[k].accel[i] = (((int16_t)data[2*i]) << 8) | data[2*i+1];
+			motion[k].gyro[i] = (((int16_t)data[6+2*i]) << 8) | data[6+2*i+1];
+		}
+		motion[k].temperature = 0;
+		data += fifo_sample_size;
+	}
+	return num_samples;
+}
+
+uint SPIMPU6000::setSampleRate(uint rate_hz) {
+	uint base_rate = rate_hz > 1000 ? 8000 : 1000;
+	uint divider = rate_hz > 0 ? base_rate / rate_hz : 1;
+	if(divider < 1) divider = 1;
+	if(divider > 256) divider = 256;
+	setDLPFMode(base_rate == 8000 ? 0 : 2);
+	setRate((uint8_t)(divider - 1));
+	return 1000000 / base_rate * divider;
+}
+
+void SPIMPU6000::setDLPFMode(uint8_t mode) {
+	writeBits(MPU6000_RA_CONFIG, 0x07, mode);
+}
+
+void SPIMPU6000::setRate(uint8_t rate) {
+	m_device.writeRegister(MPU6000_RA_SMPLRT_DIV, rate);
+}
+
+void SPIMPU6000::setFullScaleGyroRange(uint8_t range) {
+	writeBits(MPU6000_RA_GYRO_CONFIG, 0x18, range << 3);
+}
+
+uint8_t SPIMPU6000::getFullScaleGyroRange() {
+	uint8_t value = 0;
+	m_device.readRegister(MPU6000_RA_GYRO_CONFIG, value);
+	return (value >> 3) & 3;
+}
+
+void SPIMPU6000::setFullScaleAccelRange(uint8_t range) {
+	writeBits(MPU6000_RA_ACCEL_CONFIG, 0x18, range << 3);
+}
+
+uint8_t SPIMPU6000::getFullScaleAccelRange() {
+	uint8_t value = 0;
+	m_device.readRegister(MPU6000_RA_ACCEL_CONFIG, value);
+	return (value >> 3) & 3;
+}
+
+void SPIMPU6000::setIntDataReadyEnabled(bool enabled) {
+	m_device.writeRegister(MPU6000_RA_INT_ENABLE, enabled ? 0x01 : 0);
+}
+
+void SPIMPU6000::setInterruptMode(bool active_low) {
+	writeBits(MPU6000_RA_INT_PIN_CFG, MPU6000_INTCFG_INT_LEVEL, active_low ? 0xff : 0);
+}
+
+void SPIMPU6000::setInterruptDrive(bool open_drain) {
+	writeBits(MPU6000_RA_INT_PIN_CFG, MPU6000_INTCFG_INT_OPEN, open_drain ? 0xff : 0);
+}
+
+void SPIMPU6000::setInterruptLatch(bool latch) {
+	writeBits(MPU6000_RA_INT_PIN_CFG, MPU6000_INTCFG_LATCH_INT_EN, latch ? 0xff : 0);
+}
+
+void SPIMPU6000::writeBits(uint8_t reg, uint8_t mask, uint8_t value) {
+	uint8_t old_value;
+	if(!m_device.readRegister(reg, old_value)) return;
+	m_device.writeRegister(reg, (old_value & ~mask) | (value & mask));
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _MPU_6000_ACCEL_GYRO_HEADER_H_
+#define _MPU_6000_ACCEL_GYRO_HEADER_H_
+
+#include <kernel/spi.hpp>
+#include <kernel/types.h>
+
+#define MPU6000_RA_SMPLRT_DIV       0x19
+#define MPU6000_RA_CONFIG           0x1A
+#define MPU6000_RA_GYRO_CONFIG      0x1B
+#define MPU6000_RA_ACCEL_CONFIG     0x1C
+#define MPU6000_RA_FIFO_EN          0x23
+#define MPU6000_RA_INT_PIN_CFG      0x37
+#define MPU6000_RA_INT_ENABLE       0x38
+#define MPU6000_RA_INT_STATUS       0x3A
+#define MPU6000_RA_ACCEL_XOUT_H     0x3B
+#define MPU6000_RA_SIGNAL_PATH_RESET 0x68
+#define MPU6000_RA_USER_CTRL        0x6A
+#define MPU6000_RA_PWR_MGMT_1       0x6B
+#define MPU6000_RA_FIFO_COUNTH      0x72
+#define MPU6000_RA_FIFO_R_W         0x74
+#define MPU6000_RA_WHO_AM_I         0x75
+
+#define MPU6000_FIFO_EN_ACCEL_GYRO  0x78 /* XG, YG, ZG & accel */
+#define MPU6000_INTCFG_INT_LEVEL    0x80
+#define MPU6000_INTCFG_INT_OPEN     0x40
+#define MPU6000_INTCFG_LATCH_INT_EN 0x20
+#define MPU6000_USERCTRL_FIFO_EN    0x40
+#define MPU6000_USERCTRL_I2C_IF_DIS 0x10
+#define MPU6000_USERCTRL_FIFO_RESET 0x04
+#define MPU6000_PWR1_DEVICE_RESET   0x80
+#define MPU6000_PWR1_CLOCK_PLL_XGYRO 0x01
+
+/**
+ * driver for MPU-6000 class accelerometers & gyroscopes on SPI (MPU-6000,
+ * MPU-6500, MPU-9250: same register map for accel, gyro & FIFO).
+ * It has the same sampling interface as I2CMPU6050, so it can be used with
+ * MPUSampler & SensorMPU6050GyroAccel.
+ * configuration registers are accessed at 1 MHz, data & FIFO reads use the
+ * fast clock.
+ * 
+ * example usage:
+ 	SPIMPU6000 accelgyro(spiTransfer, 0);
+	if(!accelgyro.initialize() || !accelgyro.testConnection())
+		printk_e("Error: no connection to MPU6000 Accel/Gyro\n");
+	accelgyro.setSampleRate(8000);
+ */
+class SPIMPU6000 {
+public:
+	/** @param cs chip select line */
+	SPIMPU6000(FuncSPITransfer func_transfer, int cs, uint32 fast_clock_hz=10000000);
+	
+	static const char* deviceName() { return "MPU-6000"; }
+	
+	/** reset the device, wake it up & disable the I2C interface.
+	 * @return true on success */
+	bool initialize();
+	/** check the WHO_AM_I register */
+	bool testConnection();
+	
+	/** same as I2CMPU6050::Motion */
+	struct Motion {
+		int16_t accel[3];
+		int16_t temperature; /** [deg C] = temperature/340 + 36.53 */
+		int16_t gyro[3];
+	};
+	
+	/** read accel, temperature & gyro with a single burst read */
+	bool getMotion(Motion& motion);
+	
+	static constexpr int fifo_size = 1024; /** [bytes] */
+	static constexpr int fifo_sample_size = 12; /** [bytes] */
+	/** max number of samples per readFIFOMotion() (SPI has no length limit:
+	 *  this limits the buffer size. 5 ms at 8 kHz) */
+	static constexpr int fifo_max_burst = 40;
+	
+	/** enable/disable writing accel & gyro samples to the FIFO. resets the FIFO */
+	void setMotionFIFO(bool enabled);
+	void resetFIFO();
+	/** @return number of bytes in the FIFO or <0 on error */
+	int readFIFOCount();
+	/**
+	 * read samples from the FIFO with a single burst read (temperature is set to 0)
+	 * @param num_samples in [1, fifo_max_burst]. they must be in the FIFO
+	 * @return num_samples or <0 on error
+	 */
+	int readFIFOMotion(Motion* motion, int num_samples);
+	
+	/**
+	 * set the sample rate: above 1 kHz the gyro runs at 8 kHz w/o lowpass
+	 * filter (the accel has 1 kHz, its samples are repeated), otherwise at
+	 * 1 kHz with a 98 Hz lowpass.
+	 * @param rate_hz 8000/n or 1000/n
+	 * @return sample period [us]
+	 */
+	uint setSampleRate(uint rate_hz);
+	
+	/* configuration, like MPU6050 */
+	void setDLPFMode(uint8_t mode);
+	void setRate(uint8_t rate);
+	void setFullScaleGyroRange(uint8_t range);
+	uint8_t getFullScaleGyroRange();
+	void setFullScaleAccelRange(uint8_t range);
+	uint8_t getFullScaleAccelRange();
+	void setIntDataReadyEnabled(bool enabled);
+	void setInterruptMode(bool active_low);
+	void setInterruptDrive(bool open_drain);
+	void setInterruptLatch(bool latch);
+	
+private:
+	/** read-modify-write of the bits in mask */
+	void writeBits(uint8_t reg, uint8_t mask, uint8_t value);
+	
+	SPIDevice m_device;
+};
+
+
+#endif /* _MPU_6000_ACCEL_GYRO_HEADER_H_ */
@@ -7,6 +7,10 @@ MODULES_LOC :=
 
 src += $(THIS_DIR)command_line.cpp
 src += $(THIS_DIR)led_blinker.cpp
+src += $(THIS_DIR)rate_scheduler.cpp
+src += $(THIS_DIR)timer_tick.cpp
+src += $(THIS_DIR)profiler.cpp
+src += $(THIS_DIR)telemetry.cpp
 MODULES_LOC += wave/
 MODULES_LOC += flight_controller/
 
@@ -51,15 +51,15 @@ public:
 	const std::string command_name;
 	const std::string command_description;
 	
-protected:
-	/* call this when command finished executing */
-	void finishExecute();
-	
 	/**
-	 * convert a string to an integer
+	 * convert a string to an (unsigned) integer
 	 * @return true if success
 	 */
-	bool parseInt(const std::string& str, int& value);
+	static bool parseInt(const std::string& str, int& value);
+	
+protected:
+	/* call this when command finished executing */
+	void finishExecute();
 	
 	CommandLine& m_command_line;
 };
@@ -29,7 +29,7 @@ enum Filter1DConfig {
  * a templated class to filter 1D values.
  * @param C filter type: defines which algorithm is used to filter
  * @param history_length how many old values to keep (>0). set to 1 for exponential moving average
- * @param T type of the values
+ * @param T type of the values (float or a Fixed<> type)
  */
 template<Filter1DConfig C, int history_length=1, typename T=float>
 class Filter1D {
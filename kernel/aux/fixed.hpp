@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _FIXED_HEADER_HPP_
+#define _FIXED_HEADER_HPP_
+
+#include <kernel/types.h>
+
+#include <type_traits>
+
+/**
+ * signed fixed-point number in Q format: a 32 bit integer with frac_bits
+ * fractional bits. eg. Fixed<20> is Q11.20: range [-2048, 2048), resolution
+ * 9.5e-7.
+ *
+ * this is meant for targets without FPU (blackfin): it can be used as the
+ * type T of PID, Filter1D & SensorFusionMahonyAHRS instead of float.
+ * - multiplication & division use a 64 bit intermediate and round to nearest
+ * - there is no overflow detection: the caller must make sure the values fit.
+ *   only division saturates (also for a zero divisor, instead of trapping)
+ * - conversions from float are constexpr, so constants do not need the FPU.
+ *   conversions to float must be explicit
+ */
+template<int frac_bits>
+class Fixed {
+public:
+	static_assert(frac_bits > 0 && frac_bits < 31, "invalid number of fractional bits");
+
+	static constexpr int32 one = (int32)1 << frac_bits;
+
+	constexpr Fixed() : m_value(0) {}
+
+	template<typename U>
+	constexpr Fixed(U value, typename std::enable_if<std::is_integral<U>::value>::type* = 0)
+		: m_value((int32)value * one) {}
+
+	template<typename U>
+	constexpr Fixed(U value, typename std::enable_if<std::is_floating_point<U>::value>::type* = 0)
+		: m_value((int32)(value * one + (value < 0 ? -0.5 : 0.5))) {}
+
+	static constexpr Fixed fromRaw(int32 raw) { return Fixed(raw, RawTag()); }
+	constexpr int32 raw() const { return m_value; }
+
+	explicit constexpr operator float() const { return (float)m_value / one; }
+	explicit constexpr operator double() const { return (double)m_value / one; }
+	/** rounds towards -inf */
+	explicit constexpr operator int() const { return m_value >> frac_bits; }
+
+	Fixed& operator+=(Fixed b) { m_value += b.m_value; return *this; }
+	Fixed& operator-=(Fixed b) { m_value -= b.m_value; return *this; }
+	Fixed& operator*=(Fixed b) { m_value = mul(m_value, b.m_value); return *this; }
+	Fixed& operator/=(Fixed b) { m_value = div(m_value, b.m_value); return *this; }
+
+	friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.m_value); }
+	friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.m_value + b.m_value); }
+	friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.m_value - b.m_value); }
+	friend inline Fixed operator*(Fixed a, Fixed b) { return fromRaw(mul(a.m_value, b.m_value)); }
+	friend inline Fixed operator/(Fixed a, Fixed b) { return fromRaw(div(a.m_value, b.m_value)); }
+
+	friend constexpr bool operator==(Fixed a, Fixed b) { return a.m_value == b.m_value; }
+	friend constexpr bool operator!=(Fixed a, Fixed b) { return a.m_value != b.m_value; }
+	friend constexpr bool operator<(Fixed a, Fixed b) { return a.m_value < b.m_value; }
+	friend constexpr bool operator<=(Fixed a, Fixed b) { return a.m_value <= b.m_value; }
+	friend constexpr bool operator>(Fixed a, Fixed b) { return a.m_value > b.m_value; }
+	friend constexpr bool operator>=(Fixed a, Fixed b) { return a.m_value >= b.m_value; }
+
+	friend constexpr Fixed abs(Fixed a) { return a.m_value < 0 ? -a : a; }
+	friend constexpr Fixed fabs(Fixed a) { return abs(a); }
+
+	/** square root (0 for negative values) */
+	friend inline Fixed sqrt(Fixed a) {
+		if(a.m_value <= 0) return Fixed();
+		return fromRaw((int32)isqrt((uint64_t)a.m_value << frac_bits));
+	}
+
+private:
+	struct RawTag {};
+	constexpr Fixed(int32 raw, RawTag) : m_value(raw) {}
+
+	static inline int32 mul(int32 a, int32 b) {
+		return (int32)(((int64_t)a * b + (one >> 1)) >> frac_bits);
+	}
+	static inline int32 div(int32 a, int32 b) {
+		if(b == 0) {
+			if(a > 0) return max_raw;
+			if(a < 0) return min_raw;
+			return 0;
+		}
+		int64_t num = (int64_t)a * one;
+		//round to nearest: add half of the divisor with the sign of the result
+		num += ((a < 0) != (b < 0)) ? -(int64_t)(b < 0 ? -b : b) / 2
+			: (int64_t)(b < 0 ? -b : b) / 2;
+		int64_t q = num / b;
+		if(q > max_raw) return max_raw;
+		if(q < min_raw) return min_raw;
+		return (int32)q;
+	}
+	/** integer square root (bitwise, no multiplications) */
+	static inline uint32 isqrt(uint64_t x) {
+		uint64_t result = 0;
+		uint64_t bit = (uint64_t)1 << 62;
+		while(bit > x) bit >>= 2;
+		while(bit != 0) {
+			if(x >= result + bit) {
+				x -= result + bit;
+				result = (result >> 1) + bit;
+			} else {
+				result >>= 1;
+			}
+			bit >>= 2;
+		}
+		return (uint32)result;
+	}
+
+	static constexpr int32 max_raw = 0x7fffffff;
+	static constexpr int32 min_raw = -max_raw - 1;
+
+	int32 m_value;
+};
+
+/** default precision for the attitude estimation & the PID's: Q11.20 */
+typedef Fixed<20> Fixed20;
+
+#endif /* _FIXED_HEADER_HPP_ */
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "blackbox.hpp"
+#include <kernel/crc.h>
+#include <kernel/interrupt.h>
+#include <kernel/utils.h>
+
+const uint32 Blackbox::field_scales[num_fields] = {
+	1, /* timestamp [us] */
+	1000, 1000, 1000, /* gyro [mrad/s] */
+	1000, 1000, 1000, /* accel [mm/s^2] */
+	1000, 1000, 1000, /* mag */
+	10000, 10000, 10000, /* attitude [0.1 mrad] */
+	10000, 10000, 10000, 10000, /* setpoint, throttle */
+	10000, 10000, 10000, /* P */
+	10000, 10000, 10000, /* I */
+	10000, 10000, 10000, /* D */
+	10000, 10000, 10000, 10000, /* motors */
+};
+
+const char* const Blackbox::field_names[num_fields] = {
+	"time",
+	"gyro_x", "gyro_y", "gyro_z",
+	"accel_x", "accel_y", "accel_z",
+	"mag_x", "mag_y", "mag_z",
+	"roll", "pitch", "yaw",
+	"setpoint_roll", "setpoint_pitch", "setpoint_yaw", "throttle",
+	"p_roll", "p_pitch", "p_yaw",
+	"i_roll", "i_pitch", "i_yaw",
+	"d_roll", "d_pitch", "d_yaw",
+	"motor0", "motor1", "motor2", "motor3",
+};
+
+Blackbox::Blackbox(size_t buffer_size, size_t block_size)
+	: m_block_size(block_size) {
+	ASSERT(block_size >= sizeof(BlockHeader) + max_record_size);
+	ASSERT(block_size % sizeof(uint32) == 0); //header alignment
+	m_num_blocks = buffer_size / block_size;
+	ASSERT(m_num_blocks > 0);
+	m_buffer = new uint8[m_num_blocks * block_size];
+	clear();
+}
+
+Blackbox::~Blackbox() {
+	delete[] m_buffer;
+}
+
+void Blackbox::clear() {
+	disableInterrupts();
+	m_cur_block = 0;
+	m_num_used_blocks = 0;
+	m_next_sequence = 0;
+	m_num_records = 0;
+	m_num_dropped = 0;
+	m_num_bytes = 0;
+	startBlock();
+	enableInterrupts();
+}
+
+void Blackbox::startBlock() {
+	BlockHeader& header = block(m_cur_block);
+	header.sequence = m_next_sequence++;
+	header.num_records = 0;
+	header.length = 0;
+	if(m_num_used_blocks < m_num_blocks) ++m_num_used_blocks;
+	memset(m_previous, 0, sizeof(m_previous)); //next record is a key frame
+}
+
+uint8* Blackbox::writeVarint(uint8* buffer, int32 value) {
+	uint32 zigzag = ((uint32)value << 1) ^ (uint32)(value >> 31);
+	while(zigzag >= 0x80) {
+		*buffer++ = (uint8)(zigzag | 0x80);
+		zigzag >>= 7;
+	}
+	*buffer++ = (uint8)zigzag;
+	return buffer;
+}
+
+Timestamp Blackbox::blockTimestamp(const BlockHeader& header) const {
+	const uint8* data = (const uint8*)(&header + 1);
+	uint32 zigzag = 0;
+	int shift = 0;
+	do {
+		zigzag |= (uint32)(*data & 0x7f) << shift;
+		shift += 7;
+	} while(*data++ & 0x80);
+	return (Timestamp)((zigzag >> 1) ^ -(zigzag & 1));
+}
+
+int32 Blackbox::quantize(float value, uint32 scale) {
+	float scaled = value * (float)scale;
+	/* the conversion of NaN or a value out of range is undefined */
+	if(scaled != scaled) return nan_value;
+	if(scaled >= 2147483647.f) return 0x7fffffff; //the float is 2^31
+	if(scaled <= -2147483647.f) return -0x7fffffff;
+	return (int32)(scaled + (scaled >= 0.f ? 0.5f : -0.5f));
+}
+
+void Blackbox::record(const BlackboxRecord& record) {
+	if(!m_recording) {
+		++m_num_dropped;
+		return;
+	}
+
+	/* quantize */
+	int32 values[num_fields];
+	int idx = 0;
+	values[idx++] = (int32)record.timestamp;
+	auto add = [&values, &idx](float value) {
+		values[idx] = quantize(value, field_scales[idx]);
+		++idx;
+	};
+	for(int i=0; i<3; ++i) add(record.gyro[i]);
+	for(int i=0; i<3; ++i) add(record.accel[i]);
+	for(int i=0; i<3; ++i) add(record.mag[i]);
+	for(int i=0; i<3; ++i) add(record.attitude[i]);
+	for(int i=0; i<3; ++i) add(record.setpoint[i]);
+	add(record.throttle);
+	for(int i=0; i<3; ++i) add(record.pid_p[i]);
+	for(int i=0; i<3; ++i) add(record.pid_i[i]);
+	for(int i=0; i<3; ++i) add(record.pid_d[i]);
+	for(int i=0; i<4; ++i) add(record.motors[i]);
+
+	/* make sure there is enough space */
+	BlockHeader* header = &block(m_cur_block);
+	if(sizeof(BlockHeader) + header->length + max_record_size > m_block_size) {
+		if(++m_cur_block >= m_num_blocks) m_cur_block = 0;
+		startBlock();
+		header = &block(m_cur_block);
+	}
+
+	/* delta encode */
+	uint8* start = (uint8*)(header + 1) + header->length;
+	uint8* cur = start;
+	for(int i=0; i<num_fields; ++i) {
+		cur = writeVarint(cur, (int32)((uint32)values[i] - (uint32)m_previous[i]));
+		m_previous[i] = values[i];
+	}
+	header->length += cur - start;
+	++header->num_records;
+	++m_num_records;
+	m_num_bytes += cur - start;
+}
+
+void Blackbox::writeFrame(const FuncWrite& output, uint8 type,
+		const uint8* data, size_t length, const uint8* data2, size_t length2) {
+	size_t total_length = length + length2;
+	uint8 frame_header[5] = { 0xa5, 0x5a, type,
+		(uint8)(total_length & 0xff), (uint8)(total_length >> 8) };
+	uint16 crc = crc16(CRC16_INIT, frame_header + 2, 3);
+	crc = crc16(crc, data, length);
+	crc = crc16(crc, data2, length2);
+
+	for(size_t i=0; i<sizeof(frame_header); ++i) output(frame_header[i]);
+	for(size_t i=0; i<length; ++i) output(data[i]);
+	for(size_t i=0; i<length2; ++i) output(data2[i]);
+	output(crc & 0xff);
+	output(crc >> 8);
+}
+
+void Blackbox::dump(const FuncWrite& output, uint last_seconds) {
+	bool was_recording = m_recording;
+	m_recording = false;
+
+	/* header */
+	uint8 buffer[512];
+	size_t len = 0;
+	buffer[len++] = 1; //version
+	buffer[len++] = num_fields;
+	for(int i=0; i<num_fields; ++i) {
+		for(int k=0; k<4; ++k)
+			buffer[len++] = (uint8)(field_scales[i] >> (k*8));
+		const char* name = field_names[i];
+		do {
+			buffer[len++] = *name;
+		} while(*name++);
+	}
+	ASSERT(len <= sizeof(buffer));
+	writeFrame(output, 1, buffer, len);
+
+	/* blocks: oldest first */
+	size_t first_block = m_cur_block + m_num_blocks - (m_num_used_blocks - 1);
+	size_t num_skipped_blocks = 0;
+	if(last_seconds > 0 && block(m_cur_block).num_records > 0) {
+		//skip blocks when the next one starts before the requested range
+		Timestamp start = (Timestamp)m_previous[0] - last_seconds * 1000000;
+		while(num_skipped_blocks + 1 < m_num_used_blocks) {
+			const BlockHeader& next = block((first_block + num_skipped_blocks + 1)
+					% m_num_blocks);
+			if(next.num_records == 0 || time_after(blockTimestamp(next), start))
+				break;
+			++num_skipped_blocks;
+		}
+	}
+	for(size_t i=num_skipped_blocks; i<m_num_used_blocks; ++i) {
+		BlockHeader& header = block((first_block + i) % m_num_blocks);
+		if(header.num_records == 0) continue;
+		uint8 block_header[6];
+		for(int k=0; k<4; ++k)
+			block_header[k] = (uint8)(header.sequence >> (k*8));
+		block_header[4] = (uint8)(header.num_records & 0xff);
+		block_header[5] = (uint8)(header.num_records >> 8);
+		writeFrame(output, 2, block_header, sizeof(block_header),
+				(const uint8*)(&header + 1), header.length);
+	}
+
+	/* end */
+	len = 0;
+	for(int k=0; k<4; ++k)
+		buffer[len++] = (uint8)(m_num_records >> (k*8));
+	for(int k=0; k<4; ++k)
+		buffer[len++] = (uint8)(m_num_dropped >> (k*8));
+	writeFrame(output, 3, buffer, len);
+
+	m_recording = was_recording;
+}
+
+void Blackbox::printStatus(Output& output) {
+	disableInterrupts();
+	uint num_records = m_num_records;
+	uint num_dropped = m_num_dropped;
+	uint64_t num_bytes = m_num_bytes;
+	size_t num_used_blocks = m_num_used_blocks;
+	size_t first_block = m_cur_block + m_num_blocks - (num_used_blocks - 1);
+	uint32 num_overwritten_blocks = block(first_block % m_num_blocks).sequence;
+	enableInterrupts();
+	uint num_buffered_records = 0; //approximate if recording
+	for(size_t i=0; i<num_used_blocks; ++i)
+		num_buffered_records += block((first_block + i) % m_num_blocks).num_records;
+
+	output.printf("recording      : %s\n", m_recording ? "yes" : "no (paused)");
+	output.printf("buffer         : %u blocks of %u bytes, %u used, %u overwritten\n",
+			(uint)m_num_blocks, (uint)m_block_size, (uint)num_used_blocks,
+			num_overwritten_blocks);
+	output.printf("records        : %u in the buffer, %u total, %u dropped (paused)\n",
+			num_buffered_records, num_records, num_dropped);
+	if(num_records > 0) {
+		output.printf("record size    : %.1f bytes avg (%u bytes unpacked)\n",
+				(float)num_bytes / num_records, (uint)(sizeof(int32) * num_fields));
+	}
+}
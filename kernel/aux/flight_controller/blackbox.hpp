@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _FLIGHT_CONTROLLER_BLACKBOX_HEADER_HPP_
+#define _FLIGHT_CONTROLLER_BLACKBOX_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/timer.h>
+#include <kernel/io.hpp>
+#include <kernel/aux/vec3.hpp>
+
+/** one record of the blackbox: state of a single control loop iteration */
+struct BlackboxRecord {
+	Timestamp timestamp;
+	Math::Vec3f gyro; /** [rad/s] */
+	Math::Vec3f accel; /** [m/s^2] */
+	Math::Vec3f mag;
+	Math::Vec3f attitude; /** roll, pitch, yaw [rad] */
+	Math::Vec3f setpoint; /** roll, pitch, yaw [rad] */
+	float throttle;
+	Math::Vec3f pid_p, pid_i, pid_d; /** PID terms for roll, pitch, yaw */
+	float motors[4]; /** motor outputs [0,1] */
+};
+
+/**
+ * in-RAM flight recorder.
+ *
+ * records are quantized to integers (fixed scale per field), then delta
+ * encoded against the previous record and stored as zigzag varints. the
+ * buffer is a ring of fixed-size blocks. each block starts with a key frame
+ * (a record encoded against 0), so that the oldest block can be overwritten
+ * and every block can be decoded on its own.
+ *
+ * the buffer is allocated in the constructor, record() never allocates and
+ * takes only a few microseconds. record() may be called from IRQ context, all
+ * other methods must be called from the main loop.
+ *
+ * dump format (all values little endian):
+ *   frame: 0xa5 0x5a type:u8 length:u16 payload:length crc:u16
+ *   the CRC-16/CCITT covers type, length & payload.
+ *   - type 1 (header): version:u8 num_fields:u8, then for each field:
+ *     scale:u32 name:zero-terminated string. value = stored integer / scale
+ *   - type 2 (block): sequence:u32 num_records:u16 data
+ *   - type 3 (end): num_records:u32 num_dropped:u32
+ *   field 0 is the timestamp [us] (it wraps after ~71 minutes). values out
+ *   of the int32 range are saturated to +-(2^31-1), NaN is stored as -2^31
+ *   (nan_value).
+ *   decoder: tools/blackbox_decode.py
+ */
+class Blackbox {
+public:
+	/**
+	 * @param buffer_size size of the ring buffer in bytes
+	 * @param block_size size of a block in bytes (including the header)
+	 */
+	Blackbox(size_t buffer_size, size_t block_size=2048);
+	~Blackbox();
+
+	/** store a record. when the buffer is full, the oldest block is dropped */
+	void record(const BlackboxRecord& record);
+
+	/** pause/resume recording. records while paused are dropped */
+	void setRecording(bool recording) { m_recording = recording; }
+	bool recording() const { return m_recording; }
+
+	/** clear all recorded data */
+	void clear();
+
+	/**
+	 * write the recorded data as binary frames (oldest first). recording is
+	 * paused while dumping
+	 * @param last_seconds if >0, only the blocks with records of the last
+	 *                     last_seconds seconds are written (a full buffer
+	 *                     takes minutes to dump over the UART)
+	 */
+	void dump(const FuncWrite& output, uint last_seconds=0);
+
+	void printStatus(Output& output);
+
+	static constexpr int num_fields = 1 + 3*3 + 3 + 4 + 3*3 + 4;
+	/** stored integer of a NaN value */
+	static constexpr int32 nan_value = -0x7fffffff - 1;
+
+private:
+	struct BlockHeader {
+		uint32 sequence;
+		uint16 num_records;
+		uint16 length; /** used bytes after the header */
+	};
+
+	static constexpr int max_record_size = num_fields * 5; /** varint of 32 bit */
+	static const uint32 field_scales[num_fields];
+	static const char* const field_names[num_fields];
+
+	inline BlockHeader& block(size_t idx) {
+		return *(BlockHeader*)(m_buffer + idx * m_block_size);
+	}
+	inline void startBlock();
+	static inline uint8* writeVarint(uint8* buffer, int32 value);
+	/** timestamp of the first record (key frame) of a non-empty block */
+	inline Timestamp blockTimestamp(const BlockHeader& header) const;
+	/** round to an integer (saturated, NaN as nan_value) */
+	static inline int32 quantize(float value, uint32 scale);
+
+	void writeFrame(const FuncWrite& output, uint8 type, const uint8* data,
+			size_t length, const uint8* data2=NULL, size_t length2=0);
+
+	uint8* m_buffer;
+	size_t m_block_size;
+	size_t m_num_blocks;
+
+	size_t m_cur_block = 0; /** block that is currently written */
+	size_t m_num_used_blocks = 0; /** including the current block */
+	uint32 m_next_sequence = 0;
+	int32 m_previous[num_fields]; /** previous record of the current block */
+
+	volatile bool m_recording = true;
+	uint m_num_records = 0; /** total number of stored records */
+	uint m_num_dropped = 0; /** records dropped while paused */
+	uint64_t m_num_bytes = 0; /** total number of stored bytes */
+};
+
+#endif /* _FLIGHT_CONTROLLER_BLACKBOX_HEADER_HPP_ */
@@ -5,10 +5,14 @@ MODULES_LOC :=
 
 #add objects & subdirectories to build
 
+src += $(THIS_DIR)blackbox.cpp
 src += $(THIS_DIR)flight_controller.cpp
+src += $(THIS_DIR)fusion_benchmark.cpp
 src += $(THIS_DIR)main.cpp
+src += $(THIS_DIR)mixer.cpp
 src += $(THIS_DIR)motor_controller.cpp
 src += $(THIS_DIR)motor_command.cpp
+src += $(THIS_DIR)sensor_fusion_dmp.cpp
 src += $(THIS_DIR)sensor_fusion_mahony.cpp
 src += $(THIS_DIR)sensor_fusion_madgwick.cpp
 src += $(THIS_DIR)stabilize_command.cpp
@@ -36,6 +36,44 @@
  */
 //#define FLIGHT_CONTROLLER_INIT_MOTORS
 
+/** sensor fusion on the DMP of the MPU-6050 instead of Mahony on the CPU if
+ *  defined. Mahony still runs for comparison, when enabled with the command
+ *  `fusioncmp` (CPU time & attitude lag)
+ */
+//#define FLIGHT_CONTROLLER_DMP_FUSION
+
+/** MPU-6000 (or MPU-9250) on SPI0 CE0 instead of the MPU-6050 on I2C if
+ *  defined. gyro & accel are sampled at 8 kHz through the FIFO & read with
+ *  10 MHz bursts, which leaves the I2C bus to the other sensors & the motors
+ */
+//#define FLIGHT_CONTROLLER_SPI_IMU
+
+#if defined(FLIGHT_CONTROLLER_SPI_IMU) && defined(FLIGHT_CONTROLLER_DMP_FUSION)
+#error "FLIGHT_CONTROLLER_DMP_FUSION needs the MPU-6050 on I2C"
+#endif
+
+/** ESCs directly on gpio pins (MotorControllerESC: OneShot125, synchronized
+ *  with the control loop) instead of the Adafruit I2C PWM board if defined
+ */
+//#define FLIGHT_CONTROLLER_ESC_OUTPUT
+
+/** DShot300 ESCs on gpio pins (MotorControllerDShot, synchronized with the
+ *  control loop) instead of the Adafruit I2C PWM board if defined. the
+ *  throttle is sent digitally, so the min/max thrusts need no ESC calibration
+ */
+//#define FLIGHT_CONTROLLER_DSHOT_OUTPUT
+
+#if defined(FLIGHT_CONTROLLER_ESC_OUTPUT) && defined(FLIGHT_CONTROLLER_DSHOT_OUTPUT)
+#error "FLIGHT_CONTROLLER_ESC_OUTPUT & FLIGHT_CONTROLLER_DSHOT_OUTPUT use the same pins"
+#endif
+
+/** I2C bus of the motor PWM board. set it to 0 to use BSC0 (gpio 0 & 1), so
+ *  that motor updates do not wait for sensor reads on the default bus.
+ *  drivers that only know the slave address (I2Cdev) can be moved to another
+ *  bus with i2cSetBus()
+ */
+#define FLIGHT_CONTROLLER_MOTOR_I2C_BUS I2C_DEFAULT_BUS
+
 
 #endif /* _FLIGHT_CONTROLLER_COMMON_HEADER_HPP_ */
 
@@ -17,6 +17,7 @@
 
 #include <kernel/aux/command_line.hpp>
 #include <kernel/aux/led_blinker.hpp>
+#include <kernel/aux/rate_scheduler.hpp>
 #include <kernel/timer.h>
 
 #include "sensor.hpp"
@@ -24,9 +25,12 @@
 #include "input_control.hpp"
 #include "pid.hpp"
 #include "sensor_fusion.hpp"
+#include "blackbox.hpp"
 
 #include <kernel/aux/filter.hpp>
 
+#include <type_traits>
+
 
 enum FlightControllerPID {
 	FlightControllerPID_Roll=0,
@@ -45,13 +49,21 @@ struct FlightControllerConfig {
 	SensorBase<>* sensor_compass = NULL;
 	SensorBase<>* sensor_barometer = NULL;
 
-	MotorControllerPWMBase* motor_controller = NULL;
+	MotorControllerBase* motor_controller = NULL;
 
 	InputControlBase<>* input_control = NULL;
 	InputSwitch<>* input_switch_flying = NULL;
 	
 	CommandLine* command_line = NULL;
 	
+	/** raw byte output for binary data (no newline conversion), eg. blackbox
+	 *  dump. can be empty */
+	FuncWrite binary_output;
+	
+	/** non-blocking output for binary telemetry (must return <0 if it would
+	 *  block). can be empty */
+	FuncWrite telemetry_output;
+	
 	LedBlinker* led_blinker = NULL;
 
 	PID<>* pid[FlightControllerPID_Count];
@@ -61,15 +73,62 @@ struct FlightControllerConfig {
 
 	SensorFusionBase* sensor_fusion = NULL;
 	
+	/** rate of the control loop (gyro & accel readout, sensor fusion, PID's &
+	 *  motor output). compass & barometer are read at the rate given by
+	 *  SensorBase::minMeasurementDelayMicro() */
+	uint control_rate_hz = 1000;
+	
+	/** run the control path (control, compass & barometer) from the timer
+	 *  IRQ, so that the main loop (command line, LED) cannot delay it. if
+	 *  false or not supported, it is polled from the main loop */
+	bool control_tick_irq = true;
+	
+	/** called from the main loop whenever the control path has nothing to do,
+	 *  with the next release time of the control path. this is used by the
+	 *  simulation to advance the virtual clock (see sil/). run() returns when
+	 *  it returns false (the commands it added to command_line must not be
+	 *  used after that). can be empty */
+	std::function<bool (Timestamp next_release)> idle;
+	
+	/** RAM size for the flight recorder in bytes (0 to disable). the record
+	 *  size is typically around 35 bytes, one record per control loop.
+	 *  the dump is limited by the UART: about 11 kB/s at 115200 baud */
+	size_t blackbox_size = 0;
+	
+	/** called after each control loop iteration with the same record as
+	 *  the blackbox gets (but not quantized). the replay uses this to log the
+	 *  outputs (see sil/). can be empty */
+	std::function<void (const BlackboxRecord& record)> control_output;
+	
 	/** added to the attitude, if IMU sensor is not mounted completely planar
 	 *  with the surface. given in roll, pitch, yaw */
 	Math::Vec3f attitude_offset = Math::Vec3f(0.f);
 };
 
 
+/**
+ * sensor types of a FlightController (policy). the default is the
+ * runtime-polymorphic SensorBase<>
+ */
+template<class Gyro=SensorBase<>, class Accel=Gyro, class Compass=Gyro, class Baro=Gyro>
+struct FlightControllerSensors {
+	typedef Gyro gyro_type;
+	typedef Accel accel_type;
+	typedef Compass compass_type;
+	typedef Baro baro_type;
+};
+
 /**
  * flight controller with the main loop.
  * 
+ * the control path is driven by a RateScheduler with these rate groups (in
+ * order of priority):
+ * - control: gyro+accel, sensor fusion, input, PID's & motors (control_rate_hz)
+ * - compass & barometer: at the sensor's measurement rate
+ * after startup, these run in the timer IRQ (see control_tick_irq).
+ * the main loop runs the stats group (once per second), and the LED blinker &
+ * the command line as background tasks in the slack.
+ * 
  * contains:
  * - sensor readout
  * - attitude calculation
@@ -95,7 +154,19 @@ struct FlightControllerConfig {
  *   coordinates. formally:
  *   world A  --> air B
  *   v        --> Ryaw * Rpitch * Rroll * y
+ * 
+ * composition: the devices are always passed via FlightControllerConfig. the
+ * template arguments are the types the control path (control, compass &
+ * barometer rate groups) uses to call them: with the default base classes,
+ * every call is virtual (FlightController<>). if the concrete (final) device
+ * types are given, the calls are resolved at compile time & can be inlined.
+ * the config pointers must then point to objects of exactly these types.
+ * the commands always use the base classes.
+ * FlightController<> is instantiated in flight_controller.cpp, other
+ * compositions must include flight_controller_impl.hpp.
  */
+template<class Sensors=FlightControllerSensors<>, class Fusion=SensorFusionBase,
+	class Mixer=MotorControllerBase, class Input=InputControlBase<>>
 class FlightController {
 public:
 
@@ -105,7 +176,7 @@ public:
 	FlightController(FlightControllerConfig& config);
 	~FlightController();
 	
-	/** main loop */
+	/** main loop. only returns if FlightControllerConfig::idle says so */
 	void run();
 	
 private:
@@ -122,10 +193,11 @@ private:
 	
 	FlightControllerConfig& m_config;
 
-	//min delay timestamps for each sensor
+	/** latest sensor data */
 	template<typename T>
 	struct SensorData {
-		Timestamp next_readout;
+		Timestamp timestamp; /** time of last successful readout */
+		bool sample_time = false; /** timestamp is the sample time (FIFO) */
 		T sensor_data;
 	};
 	
@@ -134,12 +206,45 @@ private:
 	SensorData<Math::Vec3f> m_data_accel;
 	SensorData<Math::Vec3f> m_data_gyro;
 	
+	/** max number of queued gyro & accel samples (sensors with a FIFO) that are
+	 *  processed per control loop iteration. limits the execution time after
+	 *  an overrun */
+	static constexpr int max_sensor_batch = 32;
+	
+	/* devices with the types of the control path */
+	inline typename Sensors::gyro_type& gyro() {
+		return static_cast<typename Sensors::gyro_type&>(*m_config.sensor_gyro); }
+	inline typename Sensors::accel_type& accel() {
+		return static_cast<typename Sensors::accel_type&>(*m_config.sensor_accel); }
+	inline typename Sensors::compass_type& compass() {
+		return static_cast<typename Sensors::compass_type&>(*m_config.sensor_compass); }
+	inline typename Sensors::baro_type& baro() {
+		return static_cast<typename Sensors::baro_type&>(*m_config.sensor_barometer); }
+	inline Fusion& fusion() { return static_cast<Fusion&>(*m_config.sensor_fusion); }
+	inline Mixer& mixer() { return static_cast<Mixer&>(*m_config.motor_controller); }
+	inline Input& input() { return static_cast<Input&>(*m_config.input_control); }
+	
 	/**
 	 * read new sensor data
 	 * @return true if new data read
 	 */
-	template<typename T>
-	static bool updateSensor(SensorBase<>& sensor, SensorData<T>& sensor_data);
+	template<class Sensor, typename T>
+	static inline bool readSensor(Sensor& sensor, SensorData<T>& sensor_data);
+	
+	/**
+	 * set the motor outputs. the X mixing is done inline if the motor
+	 * controller type is known (see MotorControllerQuadX::mix())
+	 */
+	template<class M=Mixer>
+	static inline typename std::enable_if<std::is_base_of<MotorControllerQuadX, M>::value>::type
+	setThrust(M& mixer, float throttle, const Math::Vec3f& roll_pitch_yaw) {
+		MotorControllerQuadX::mix(mixer, mixer.mixer(), throttle, roll_pitch_yaw);
+	}
+	template<class M=Mixer>
+	static inline typename std::enable_if<!std::is_base_of<MotorControllerQuadX, M>::value>::type
+	setThrust(M& mixer, float throttle, const Math::Vec3f& roll_pitch_yaw) {
+		mixer.setThrust(throttle, roll_pitch_yaw);
+	}
 	
 	/**
 	 * initialize motors: this will block until the motors are initialized
@@ -148,16 +253,18 @@ private:
 };
 
 
-template<typename T>
-inline bool FlightController::updateSensor(SensorBase<>& sensor, SensorData<T>& sensor_data) {
-	Timestamp cur_timestamp = getTimestamp();
-	if(time_after(cur_timestamp, sensor_data.next_readout)) {
-		sensor_data.next_readout = cur_timestamp + sensor.minMeasurementDelayMicro();
-		return sensor.getMeasurement(sensor_data.sensor_data);
+template<class Sensors, class Fusion, class Mixer, class Input>
+template<class Sensor, typename T>
+inline bool FlightController<Sensors, Fusion, Mixer, Input>::readSensor(
+		Sensor& sensor, SensorData<T>& sensor_data) {
+	if(sensor.getMeasurement(sensor_data.sensor_data)) {
+		sensor_data.sample_time = sensor.getSampleTimestamp(sensor_data.timestamp);
+		if(!sensor_data.sample_time)
+			sensor_data.timestamp = getTimestamp();
+		return true;
 	}
 	return false;
 }
 
 #endif /* _FLIGHT_CONTROLLER_FLIGHT_CONTROLLER_HEADER_HPP_ */
 
-
@@ -0,0 +1,648 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _FLIGHT_CONTROLLER_FLIGHT_CONTROLLER_IMPL_HEADER_HPP_
+#define _FLIGHT_CONTROLLER_FLIGHT_CONTROLLER_IMPL_HEADER_HPP_
+
+/* implementation of FlightController. include this for compositions other
+ * than FlightController<> (see flight_controller.hpp) */
+
+#include "flight_controller.hpp"
+#include "motor_command.hpp"
+#include "stabilize_command.hpp"
+#include "blackbox.hpp"
+#include "fusion_benchmark.hpp"
+#include "common.hpp"
+#include <kernel/aux/vec3.hpp>
+#include <kernel/aux/delta_time.hpp>
+#include <kernel/aux/timer_tick.hpp>
+#include <kernel/aux/profiler.hpp>
+#include <kernel/aux/telemetry.hpp>
+#include <kernel/interrupt.h>
+#include <kernel/i2c.h>
+
+#include <algorithm>
+
+
+template<class Sensors, class Fusion, class Mixer, class Input>
+FlightController<Sensors, Fusion, Mixer, Input>::FlightController(FlightControllerConfig& config)
+	: m_config(config) {
+}
+
+template<class Sensors, class Fusion, class Mixer, class Input>
+FlightController<Sensors, Fusion, Mixer, Input>::~FlightController() {
+}
+
+template<class Sensors, class Fusion, class Mixer, class Input>
+void FlightController<Sensors, Fusion, Mixer, Input>::run() {
+	using namespace Math;
+	using namespace std;
+	
+	LedBlinker* led_blinker = m_config.led_blinker;
+	if(led_blinker) led_blinker->setLedState(true);
+	
+	m_state = State_init;
+	Timestamp init_delay_timestamp = getTimestamp() + 800 * 1000; //startup delay (time to settle)
+	m_config.sensor_fusion->enableFastConvergence(true);
+	
+	/* frequency counter */
+	uint hz_counter = 0, current_frequency = 0;
+	uint attitude_hz_counter = 0, current_attitude_frequency = 0;
+	uint seconds_counter = 0;
+
+	/* flight variables */
+	Vec3f input_roll_pitch_yaw(0.f);
+	float input_throttle=0.f, altitude_filtered;
+	Filter1D<Filter1D_EMA> altitude_filter(0.8);
+	float* input_data[InputControlValue_Count];
+	memset(input_data, 0, sizeof(float*)*InputControlValue_Count);
+	input_data[InputControlValue_Roll] = &input_roll_pitch_yaw.x;
+	input_data[InputControlValue_Pitch] = &input_roll_pitch_yaw.y;
+	input_data[InputControlValue_Yaw] = &input_roll_pitch_yaw.z;
+	input_data[InputControlValue_Throttle] = &input_throttle;
+	Vec3f attitude(0.f); //roll, pitch, yaw
+	Vec3f pid_roll_pitch_yaw_output;
+	Vec3f pid_p(0.f), pid_i(0.f), pid_d(0.f); //PID terms (for the blackbox)
+	DeltaTime delta_time_pid, delta_time_sensor_fusion;
+	Timestamp last_sample_time = 0; //of the last fused gyro sample
+	bool last_sample_time_valid = false;
+	bool landing_notice_printed = false;
+	
+	RateScheduler scheduler; //control path
+	RateScheduler foreground;
+	TimerTick timer_tick;
+	
+	/* profiling of the loop stages */
+	Profiler profiler;
+	const int profile_accel = profiler.addStage("accel");
+	const int profile_gyro = profiler.addStage("gyro");
+	const int profile_compass = profiler.addStage("compass");
+	const int profile_baro = profiler.addStage("baro");
+	const int profile_fusion = profiler.addStage("fusion");
+	const int profile_input = profiler.addStage("input");
+	const int profile_pid = profiler.addStage("pid");
+	const int profile_motors = profiler.addStage("motors");
+	const int profile_command_line = profiler.addStage("cmdline");
+	const int profile_led = profiler.addStage("led");
+	const int profile_blackbox = profiler.addStage("blackbox");
+	
+	/* flight recorder */
+	Blackbox* blackbox = NULL;
+	if(m_config.blackbox_size > 0)
+		blackbox = new Blackbox(m_config.blackbox_size);
+	
+	/* binary telemetry (rates are limited by the UART bandwidth) */
+	Telemetry* telemetry = NULL;
+	if(m_config.telemetry_output) {
+		telemetry = new Telemetry(m_config.telemetry_output);
+		int topic = telemetry->addTopic("attitude", 100);
+		telemetry->addValue(topic, "attitude", attitude);
+		topic = telemetry->addTopic("imu", 100);
+		telemetry->addValue(topic, "gyro", m_data_gyro.sensor_data);
+		telemetry->addValue(topic, "accel", m_data_accel.sensor_data);
+		topic = telemetry->addTopic("sensors", 20);
+		telemetry->addValue(topic, "compass", m_data_compass.sensor_data);
+		telemetry->addValue(topic, "altitude", m_data_baro.sensor_data);
+		telemetry->addValue(topic, "altitude-filtered", altitude_filtered);
+		topic = telemetry->addTopic("inputs", 20);
+		telemetry->addValue(topic, "roll-pitch-yaw", input_roll_pitch_yaw);
+		telemetry->addValue(topic, "throttle", input_throttle);
+		topic = telemetry->addTopic("pid", 20);
+		telemetry->addValue(topic, "pid-output", pid_roll_pitch_yaw_output);
+		telemetry->addValue(topic, "pid-p", pid_p);
+		telemetry->addValue(topic, "pid-i", pid_i);
+		telemetry->addValue(topic, "pid-d", pid_d);
+	}
+	
+	m_data_baro.sensor_data = 0.f;
+	m_data_compass.sensor_data = m_data_accel.sensor_data =
+		m_data_gyro.sensor_data = Vec3f(0.f);
+	
+	/* add more commands */
+	if(m_config.command_line) {
+		auto freq_cmd = [&current_frequency, &current_attitude_frequency](
+				const vector<string>& arguments, InputOutput& io) {
+			io.printf("Current loop frequency    : %i Hz\n", current_frequency);
+			io.printf("Current attitude frequency: %i Hz\n", current_attitude_frequency);
+		};
+		m_config.command_line->addTestCommand(freq_cmd, "freq", "print main loop update frequency");
+		auto sched_cmd = [&scheduler, &foreground, &timer_tick](
+				const vector<string>& arguments, InputOutput& io) {
+			io.printf("Control path (%s):\n", timer_tick.running() ?
+					"timer IRQ" : "main loop");
+			scheduler.printStatistics(io);
+			io.printf("\nForeground (main loop):\n");
+			foreground.printStatistics(io);
+			if(arguments.size() > 0 && arguments[0] == "reset") {
+				disableInterrupts();
+				scheduler.resetStatistics();
+				enableInterrupts();
+				foreground.resetStatistics();
+			}
+		};
+		m_config.command_line->addTestCommand(sched_cmd, "sched",
+			"print scheduler statistics of the rate groups ('reset' to reset them)");
+		auto tick_cmd = [&timer_tick](const vector<string>& arguments, InputOutput& io) {
+			timer_tick.printStatistics(io);
+			if(arguments.size() > 0 && arguments[0] == "reset")
+				timer_tick.resetStatistics();
+		};
+		m_config.command_line->addTestCommand(tick_cmd, "tick",
+			"print control tick jitter & ISR duration ('reset' to reset them)");
+		auto profile_cmd = [&profiler](const vector<string>& arguments, InputOutput& io) {
+			bool histograms = arguments.size() > 0 && arguments[0] == "hist";
+			profiler.printStatistics(io, histograms);
+			if(arguments.size() > 0 && arguments[0] == "reset")
+				profiler.resetStatistics();
+		};
+		m_config.command_line->addTestCommand(profile_cmd, "profile",
+			"print execution times of the loop stages ('hist' for histograms, "
+			"'reset' to reset them)");
+		auto benchfusion_cmd = [](const vector<string>& arguments, InputOutput& io) {
+			int duration = 20;
+			if(arguments.size() > 0 && !CommandBase::parseInt(arguments[0], duration)) {
+				io.printf("Error: invalid duration\n");
+				return;
+			}
+			FusionBenchmark benchmark((float)duration);
+			benchmark.addDefaultAlgorithms();
+			benchmark.run(io);
+		};
+		m_config.command_line->addTestCommand(benchfusion_cmd, "benchfusion",
+			"benchmark the sensor fusion algorithms on synthetic data, output as "
+			"JSON lines (argument: simulated seconds per run, default 20). "
+			"blocks the main loop, use only when landed");
+		auto benchmixer_cmd = [](const vector<string>& arguments, InputOutput& io) {
+			benchmarkMixers(io);
+		};
+		m_config.command_line->addTestCommand(benchmixer_cmd, "benchmixer",
+			"benchmark the motor mixer of each frame geometry with random inputs, "
+			"output as JSON lines");
+		if(blackbox) {
+			const FuncWrite& binary_output = m_config.binary_output;
+			auto blackbox_cmd = [blackbox, &binary_output](
+					const vector<string>& arguments, InputOutput& io) {
+				string arg = arguments.size() > 0 ? arguments[0] : "status";
+				if(arg == "dump") {
+					if(!binary_output) {
+						io.printf("Error: no binary output configured\n");
+						return;
+					}
+					int last_seconds = 0;
+					if(arguments.size() > 1 && (!CommandBase::parseInt(arguments[1],
+							last_seconds) || last_seconds < 0)) {
+						io.printf("Error: invalid number of seconds\n");
+						return;
+					}
+					blackbox->dump(binary_output, (uint)last_seconds);
+					io.printf("\n");
+				} else if(arg == "clear") {
+					blackbox->clear();
+				} else if(arg == "start" || arg == "stop") {
+					blackbox->setRecording(arg == "start");
+				} else if(arg == "status") {
+					blackbox->printStatus(io);
+				} else {
+					io.printf("Error: unknown argument %s\n", arg.c_str());
+				}
+			};
+			m_config.command_line->addTestCommand(blackbox_cmd, "blackbox",
+				"flight recorder: status, dump [<last seconds>] (binary, see "
+				"tools/blackbox_decode.py), "
+				"clear, start, stop");
+		}
+		if(telemetry) {
+			auto telemetry_cmd = [telemetry](const vector<string>& arguments,
+					InputOutput& io) {
+				string arg = arguments.size() > 0 ? arguments[0] : "status";
+				if(arg == "start") {
+					telemetry->start();
+				} else if(arg == "stop") {
+					telemetry->stop();
+				} else if(arg == "rate" && arguments.size() == 3) {
+					int topic = telemetry->findTopic(arguments[1]);
+					int rate;
+					if(topic < 0 || !CommandBase::parseInt(arguments[2], rate)) {
+						io.printf("Error: invalid topic or rate\n");
+						return;
+					}
+					telemetry->setRate(topic, rate);
+				} else if(arg == "status") {
+					telemetry->printStatus(io);
+				} else {
+					io.printf("Error: invalid arguments\n");
+				}
+			};
+			m_config.command_line->addTestCommand(telemetry_cmd, "telemetry",
+				"binary telemetry (see tools/telemetry_decode.py): start, stop, "
+				"status, rate <topic> <Hz> (0=off)");
+		}
+		int cmd_print_rate = 100; //[ms]
+		bool clear_output = true;
+		CommandWatchValues* watch_sensor_cmd = new CommandWatchValues("sensors",
+				*m_config.command_line, cmd_print_rate, clear_output);
+		watch_sensor_cmd->addValue("altitude", m_data_baro.sensor_data);
+		watch_sensor_cmd->addValue("altitude-filtered", altitude_filtered);
+		watch_sensor_cmd->addValue("compass", m_data_compass.sensor_data);
+		watch_sensor_cmd->addValue("gyro", m_data_gyro.sensor_data);
+		watch_sensor_cmd->addValue("accel", m_data_accel.sensor_data);
+		CommandWatchValues* watch_attitude_cmd = new CommandWatchValues("attitude",
+				*m_config.command_line, cmd_print_rate, clear_output);
+		watch_attitude_cmd->addValue("attitude", attitude);
+		CommandWatchValues* watch_inputs_cmd = new CommandWatchValues("inputs",
+				*m_config.command_line, cmd_print_rate, clear_output);
+		watch_inputs_cmd->addValue("roll-pitch-yaw", input_roll_pitch_yaw);
+		watch_inputs_cmd->addValue("throttle", input_throttle);
+		//motor speed tests. they drive the motor controller from the
+		//foreground: not while the control path (timer IRQ) does
+		auto motors_available = [this]() {
+			return m_state == State_init || m_state == State_debug;
+		};
+		CommandControlMotor* motor_cmd = new CommandControlMotor(*m_config.command_line,
+			*m_config.motor_controller, motors_available);
+		m_config.command_line->addCommand(*motor_cmd);
+
+		auto init_motors_cmd = [this, motors_available](
+				const vector<string>& arguments, InputOutput& io) {
+			if(!motors_available()) {
+				io.printf("Error: the motors are driven by the flight controller "
+						"(only available in init or debug state)\n");
+				return;
+			}
+			this->initMotors();
+		};
+		m_config.command_line->addTestCommand(init_motors_cmd, "initmotors",
+			"initialize motors (only in init or debug state)");
+		
+		CommandStabilize* stabilize_cmd = new CommandStabilize(
+			*m_config.command_line, m_config, attitude, input_roll_pitch_yaw,
+			pid_roll_pitch_yaw_output, &input_throttle, motors_available);
+		m_config.command_line->addCommand(*stabilize_cmd);
+	}
+	
+	/* state switching. this happens in the control path (timer IRQ), where
+	 * printk would block on the UART: the changes are counted & printed by the
+	 * stats task. the foreground prints with printkUnmasked(): printk disables
+	 * interrupts & would delay the timer tick while the UART is busy */
+	volatile uint num_state_changes = 0;
+	uint num_state_changes_printed = 0;
+	auto switchState = [&] (State new_state) {
+		switch(new_state) {
+		case State_landed:
+			led_blinker->setBlinkRate(600);
+			landing_notice_printed = false;
+#ifdef FLIGHT_CONTROLLER_DEBUG_MODE
+			new_state = State_debug;
+#else
+			m_config.motor_controller->setMotorSpeedMin();
+#endif /* FLIGHT_CONTROLLER_DEBUG_MODE */
+			break;
+		case State_manual:
+			led_blinker->setBlinkRate(100);
+			break;
+		case State_flying:
+			led_blinker->setBlinkRate(300);
+			/* reset values */
+			for(int i=0; i<FlightControllerPID_Count; ++i) {
+				m_config.pid[i]->reset_I();
+			}
+			//reset relative input values
+			m_config.input_control->getConverter(InputControlValue_Roll).reset(attitude.x);
+			m_config.input_control->getConverter(InputControlValue_Pitch).reset(attitude.y);
+			m_config.input_control->getConverter(InputControlValue_Yaw).reset(attitude.z);
+			m_config.input_control->getConverter(InputControlValue_Throttle).reset(0.f);
+			break;
+		default: panic("Error: unhandled flying state %i!\n", (int)new_state);
+		break;
+		}
+		m_state = new_state;
+		++num_state_changes;
+	};
+	auto printStateChanges = [&]() {
+		disableInterrupts();
+		uint changes = num_state_changes - num_state_changes_printed;
+		State state = m_state;
+		enableInterrupts();
+		if(changes == 0) return;
+		num_state_changes_printed += changes;
+		if(changes > 1)
+			printkUnmasked(LogLevel_info, "FlightController: %u state changes since the last report\n", changes);
+		switch(state) {
+		case State_debug:
+			printkUnmasked(LogLevel_info, "FlightController: changed to State_debug\n");
+			break;
+		case State_landed:
+			printkUnmasked(LogLevel_info, "FlightController: changed to State_landed (motor control turned off)\n");
+			break;
+		case State_manual:
+			printkUnmasked(LogLevel_info, "FlightController: changed to State_manual\n");
+			break;
+		case State_flying:
+			printkUnmasked(LogLevel_info, "FlightController: changed to State_flying :)\n");
+			break;
+		default:
+			break;
+		}
+	};
+
+	
+	/* rate groups */
+	
+	auto control_task = [&]() {
+		/* I2C: deadline timeouts & bus recoveries also need to be handled when
+		 * nothing is submitted */
+		i2cPoll();
+		
+		/* update sensor data */
+		auto read_accel_gyro = [&]() {
+			return profiler.measure(profile_accel, [&]() {
+					return readSensor(accel(), m_data_accel); }) +
+				profiler.measure(profile_gyro, [&]() {
+					return readSensor(gyro(), m_data_gyro); });
+		};
+		int got_sensor_data = read_accel_gyro();
+		/*
+		 * A note on sensor filtering:
+		 * The current sensor fusion algorithm (Mahony) is very good at filtering,
+		 * so no sensor-prefiltering is needed (plus the accel/gyro has a built-in
+		 * LP filter). But if another sensor fusion alg is used, this probably
+		 * becomes necessary: use EMA, around 25-30Hz (integrate into SensorBase?)
+		 */
+		
+		/* sensors with a FIFO return all samples, also the ones that queued up
+		 * while the loop was late. each is fused with the time between the
+		 * samples */
+		for(int batch = 1; got_sensor_data; ++batch) {
+			float dt;
+			if(m_data_gyro.sample_time && last_sample_time_valid) {
+				dt = (float)(m_data_gyro.timestamp - last_sample_time)/1000.f;
+				delta_time_sensor_fusion.reset();
+			} else {
+				dt = delta_time_sensor_fusion.nextDeltaMilli<float>();
+			}
+			last_sample_time = m_data_gyro.timestamp;
+			last_sample_time_valid = m_data_gyro.sample_time;
+			
+			profiler.measure(profile_fusion, [&]() {
+				fusion().update(m_data_gyro.sensor_data,
+					m_data_accel.sensor_data, m_data_compass.sensor_data, dt, attitude);
+			});
+			attitude += m_config.attitude_offset;
+			++attitude_hz_counter;
+			
+			if(batch >= max_sensor_batch || gyro().numQueuedSamples() == 0)
+				break;
+			got_sensor_data = read_accel_gyro();
+		}
+
+		
+		/* input */
+		profiler.measure(profile_input, [&]() {
+			input().update();
+			for(int i=0; i<InputControlValue_Count; ++i) {
+				if(!input_data[i]) continue;
+				float val;
+				if(input().getControlValue((InputControlValue)i, val)) {
+					*input_data[i] = val;
+				}
+			}
+		});
+		
+		//calc PID's
+		profiler.measure(profile_pid, [&]() {
+			float dt = delta_time_pid.nextDeltaMilli<float>();
+			Vec3f error = input_roll_pitch_yaw - attitude;
+			for(int i=0; i<3; ++i) {
+				if(error[i] > M_PI) error[i] -= 2.*M_PI;
+				else if(error[i] < -M_PI) error[i] += 2.*M_PI;
+			}
+			//same as get_pid(), but we keep the terms
+			for(int i=0; i<3; ++i) {
+				PID<>& pid = *m_config.pid[FlightControllerPID_Roll + i];
+				pid_p[i] = pid.get_p(error[i]);
+				pid_i[i] = pid.get_i(error[i], dt);
+				pid_d[i] = pid.get_d(error[i], dt);
+				pid_roll_pitch_yaw_output[i] = pid_p[i] + pid_i[i] + pid_d[i];
+			}
+		});
+		
+
+		switch(m_state) {
+		case State_init:
+			if(time_after(getTimestamp(), init_delay_timestamp)) {
+				fusion().enableFastConvergence(false);
+#if defined(FLIGHT_CONTROLLER_INIT_MOTORS) || !defined(FLIGHT_CONTROLLER_DEBUG_MODE)
+				initMotors();
+#endif
+				switchState(State_landed);
+			}
+			break;
+		case State_debug:
+			/* nothing to do: we never change to another state */
+			break;
+		case State_landed:
+			
+			if(m_config.input_switch_flying->isOn()) {
+				switchState(State_flying);
+			} else if(m_config.input_switch_flying->numStates() == 3 &&
+					m_config.input_switch_flying->getState() == 1) {
+				switchState(State_manual);
+			}
+			break;
+		case State_manual:
+			
+			if(m_config.input_switch_flying->isOff()) {
+				switchState(State_landed);
+			} else if(m_config.input_switch_flying->isOn()) {
+				switchState(State_flying);
+			} else {
+				//set motor output
+				Vec3f raw_input;
+				input().getControlValueRaw(InputControlValue_Roll, raw_input.x);
+				input().getControlValueRaw(InputControlValue_Pitch, raw_input.y);
+				input().getControlValueRaw(InputControlValue_Yaw, raw_input.z);
+				profiler.measure(profile_motors, [&]() {
+					setThrust(mixer(), input_throttle, raw_input); });
+			}
+			break;
+			
+		case State_flying:
+			
+			if(m_config.input_switch_flying->isOff()) {
+				switchState(State_landed);
+			} else if(m_config.input_switch_flying->numStates() == 3 &&
+					m_config.input_switch_flying->getState() == 1) {
+				switchState(State_manual);
+			} else {
+				//set motor output
+				profiler.measure(profile_motors, [&]() {
+					setThrust(mixer(), input_throttle, pid_roll_pitch_yaw_output); });
+			}
+			
+			break;
+		}
+
+		if(blackbox || m_config.control_output) {
+			Profiler::Scope profile(profiler, profile_blackbox);
+			BlackboxRecord record;
+			record.timestamp = m_data_gyro.timestamp;
+			record.gyro = m_data_gyro.sensor_data;
+			record.accel = m_data_accel.sensor_data;
+			record.mag = m_data_compass.sensor_data;
+			record.attitude = attitude;
+			record.setpoint = input_roll_pitch_yaw;
+			record.throttle = input_throttle;
+			record.pid_p = pid_p;
+			record.pid_i = pid_i;
+			record.pid_d = pid_d;
+			for(int i=0; i<4; ++i)
+				record.motors[i] = mixer().motorOutput(i);
+			if(blackbox) blackbox->record(record);
+			if(m_config.control_output) m_config.control_output(record);
+		}
+
+		++hz_counter;
+	};
+	
+	auto compass_task = [&]() {
+		Profiler::Scope profile(profiler, profile_compass);
+		readSensor(compass(), m_data_compass);
+	};
+	
+	auto barometer_task = [&]() {
+		Profiler::Scope profile(profiler, profile_baro);
+		if(readSensor(baro(), m_data_baro))
+			altitude_filtered = altitude_filter.nextValue(m_data_baro.sensor_data);
+	};
+	
+	const uint barometer_period = max(1000u, m_config.sensor_barometer->minMeasurementDelayMicro());
+	uint num_invalid_compass_printed = 0;
+	auto stats_task = [&]() {
+		/* stuff that needs to be done once per second */
+		++seconds_counter;
+
+		//update current frequency (counters are updated from the timer IRQ)
+		disableInterrupts();
+		current_frequency = hz_counter;
+		hz_counter = 0;
+		current_attitude_frequency = attitude_hz_counter;
+		attitude_hz_counter = 0;
+		enableInterrupts();
+		
+		
+		//update PID cutoff frequency
+		if(current_frequency > 0) {
+			for(int i=0; i<FlightControllerPID_Count; ++i) {
+				m_config.pid[i]->d_filter().setCutoffFreq(m_config.pid_integrator_cutoff_freq,
+						1.f/(float)current_frequency);
+			}
+		}
+		altitude_filter.setCutoffFreq(m_config.altitude_cutoff_freq,
+				(float)barometer_period/1e6f);
+		
+		printStateChanges();
+		uint num_invalid_compass = m_config.sensor_compass->numInvalidMeasurements();
+		if(num_invalid_compass != num_invalid_compass_printed) {
+			printkUnmasked(LogLevel_warn, "Warning: Compass got %u invalid/overflow measurements -> gain too high?\n",
+					num_invalid_compass - num_invalid_compass_printed);
+			num_invalid_compass_printed = num_invalid_compass;
+		}
+		
+		if(m_state == State_landed && seconds_counter % 5 == 0 && !landing_notice_printed) {
+			landing_notice_printed = true;
+			printkUnmasked(LogLevel_debug, "In Landed state: waiting for flying switch to be enabled...\n");
+		}
+	};
+	
+	const uint control_period = 1000000 / m_config.control_rate_hz;
+	scheduler.addRateGroup("control", control_period, control_task);
+	scheduler.addRateGroup("compass",
+		max(1000u, m_config.sensor_compass->minMeasurementDelayMicro()), compass_task);
+	scheduler.addRateGroup("baro", barometer_period, barometer_task);
+	
+	foreground.addRateGroup("stats", 1000*1000, stats_task);
+	if(led_blinker) {
+		foreground.addBackgroundTask([led_blinker, &profiler, profile_led]() {
+			Profiler::Scope profile(profiler, profile_led);
+			led_blinker->update();
+		});
+	}
+	if(telemetry)
+		foreground.addBackgroundTask([telemetry]() { telemetry->update(); });
+	if(m_config.command_line) {
+		CommandLine* command_line = m_config.command_line;
+		foreground.addBackgroundTask([command_line, &profiler, profile_command_line]() {
+			Profiler::Scope profile(profiler, profile_command_line);
+			command_line->handleData();
+		});
+	}
+	
+	bool first_tick = true;
+	auto tick = [&scheduler, &first_tick, control_period]() {
+		//align the releases with the ticks
+		if(first_tick) {
+			scheduler.start();
+			first_tick = false;
+		}
+		scheduler.runDueGroups(control_period / 2);
+	};
+	
+	
+	/* main loop */
+	
+	/* the control path is polled from the main loop until the startup is done
+	 * (initMotors() blocks), then it is moved to the timer IRQ */
+	bool use_timer_tick = m_config.control_tick_irq;
+	scheduler.start();
+	foreground.start();
+	while(1) {
+		if(!timer_tick.running()) {
+			if(use_timer_tick && m_state != State_init) {
+				int ret = timer_tick.start(control_period, tick);
+				if(ret) {
+					printk_w("FlightController: failed to start the timer tick (%i), "
+							"polling the control path\n", ret);
+					use_timer_tick = false;
+				} else {
+					printkUnmasked(LogLevel_info,
+							"FlightController: control path runs in the timer IRQ at %u Hz\n",
+							m_config.control_rate_hz);
+				}
+				continue;
+			}
+			if(scheduler.update()) continue;
+		}
+		foreground.update();
+		if(m_config.idle && !m_config.idle(scheduler.nextRelease()))
+			break;
+	}
+	
+	timer_tick.stop();
+	delete telemetry;
+	delete blackbox;
+}
+
+template<class Sensors, class Fusion, class Mixer, class Input>
+void FlightController<Sensors, Fusion, Mixer, Input>::initMotors() {
+	printk_i("initializing motors...");
+	//FIXME: it would be better to calibrate the ESC here by first setting
+	//long pulse (2ms) for about 2 sec then short pulse (1ms) for some seconds.
+	//but this does not seem to work. (DShot ESCs need no calibration: they
+	//arm after receiving stop frames)
+	m_config.motor_controller->setMotorSpeedMin();
+	delay(3500);
+	printk_i(" done\n");
+}
+
+#endif /* _FLIGHT_CONTROLLER_FLIGHT_CONTROLLER_IMPL_HEADER_HPP_ */
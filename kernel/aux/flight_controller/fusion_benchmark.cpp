@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "fusion_benchmark.hpp"
+#include <kernel/timer.h>
+#include <kernel/math.h>
+#include <kernel/utils.h>
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace Math;
+
+#define BENCHMARK_GRAVITY 9.80665f
+
+const FusionBenchmark::Trajectory FusionBenchmark::trajectories[] = {
+	/* name           offset         amplitude     freq            phase          rate */
+	{ "static-level",  {0, 0, 30},    {0, 0, 0},    {0, 0, 0},      {0, 0, 0},     {0, 0, 0} },
+	{ "static-tilted", {20, -15, 120}, {0, 0, 0},   {0, 0, 0},      {0, 0, 0},     {0, 0, 0} },
+	{ "oscillation",   {0, 0, 30},    {20, 15, 45}, {0.5, 0.3, 0.1}, {0, 1, 0},    {0, 0, 0} },
+	{ "yaw-spin",      {0, 0, 0},     {0, 0, 0},    {0, 0, 0},      {0, 0, 0},     {0, 0, 90} },
+	{ "aggressive",    {0, 0, 0},     {45, 30, 0},  {1.5, 1, 0},    {0, 0.5, 0},   {0, 0, 180} },
+};
+const int FusionBenchmark::num_trajectories =
+	sizeof(FusionBenchmark::trajectories) / sizeof(FusionBenchmark::trajectories[0]);
+
+
+/* deterministic noise: xorshift & the sum of uniform values */
+static inline float randomUniform(uint32& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (float)state * (1.f / 4294967296.f) - 0.5f;
+}
+
+static inline float randomNormal(uint32& state) {
+	//sum of 4 uniform values has a variance of 1/3
+	return (randomUniform(state) + randomUniform(state) + randomUniform(state)
+		+ randomUniform(state)) * 1.7320508f;
+}
+
+/** JSON has no NaN or inf: -1 marks an invalid value (eg. diverged filter) */
+static inline float validOr(float value) {
+	return isfinite(value) ? value : -1.f;
+}
+
+static inline float wrapAngle(float angle) {
+	while(angle > (float)M_PI) angle -= 2.f*(float)M_PI;
+	while(angle < -(float)M_PI) angle += 2.f*(float)M_PI;
+	return angle;
+}
+
+
+FusionBenchmark::FusionBenchmark(float duration, uint rate_hz)
+	: m_duration(max(duration, 2.f*settle_time)), m_rate_hz(rate_hz) {
+}
+
+void FusionBenchmark::addAlgorithm(const std::string& name, FuncCreate create) {
+	Algorithm algorithm;
+	algorithm.name = name;
+	algorithm.create = create;
+	m_algorithms.push_back(algorithm);
+}
+
+void FusionBenchmark::addDefaultAlgorithms() {
+	addAlgorithm("mahony-fc", []() { return new SensorFusionMahonyAHRS<>(1.4f, 0.02f); });
+	addAlgorithm("mahony-fc-fixed", []() {
+		return new SensorFusionMahonyAHRS<Fixed20>(1.4f, 0.02f); });
+	addAlgorithm("mahony", []() { return new SensorFusionMahonyAHRS<>(); });
+	addAlgorithm("madgwick", []() { return new SensorFusionMadgwickAHRS(); });
+}
+
+void FusionBenchmark::run(Output& output) {
+	for(const auto& algorithm : m_algorithms) {
+		for(int i=0; i<num_trajectories; ++i) {
+			runSingle(output, algorithm, trajectories[i], false);
+			runSingle(output, algorithm, trajectories[i], true);
+		}
+	}
+}
+
+float FusionBenchmark::maxRMSDifference(FuncCreate create_a, FuncCreate create_b) {
+	const uint num_updates = (uint)(m_duration * m_rate_hz);
+	const uint fast_convergence_updates = (uint)(fast_convergence_time * m_rate_hz);
+	const float dt = 1.f / m_rate_hz;
+	float max_rms = 0.f;
+
+	for(int i=0; i<num_trajectories; ++i) {
+		for(int fast_convergence=0; fast_convergence<2; ++fast_convergence) {
+			SensorFusionBase* fusion_a = create_a();
+			SensorFusionBase* fusion_b = create_b();
+			if(!fusion_a || !fusion_b) {
+				delete fusion_a;
+				delete fusion_b;
+				return -1.f;
+			}
+			uint32 random = 0x2545f491;
+			float sum_squared[3] = {0.f, 0.f, 0.f};
+			uint num_errors = 0;
+			Sample sample;
+			Vec3f attitude_a, attitude_b;
+			fusion_a->enableFastConvergence(fast_convergence);
+			fusion_b->enableFastConvergence(fast_convergence);
+			for(uint k=0; k<num_updates; ++k) {
+				float t = (k+1)*dt;
+				generateSample(trajectories[i], t, random, sample);
+				if(k == fast_convergence_updates) {
+					fusion_a->enableFastConvergence(false);
+					fusion_b->enableFastConvergence(false);
+				}
+				fusion_a->update(sample.gyro, sample.accel, sample.mag, dt*1000.f, attitude_a);
+				fusion_b->update(sample.gyro, sample.accel, sample.mag, dt*1000.f, attitude_b);
+				if(t < settle_time) continue;
+				for(int j=0; j<3; ++j) {
+					float diff = wrapAngle(attitude_a[j] - attitude_b[j]);
+					sum_squared[j] += diff*diff;
+				}
+				++num_errors;
+			}
+			delete fusion_a;
+			delete fusion_b;
+			for(int j=0; j<3; ++j) {
+				float rms = (float)RAD2DEG(sqrtf(sum_squared[j] / num_errors));
+				if(!isfinite(rms)) return -1.f;
+				max_rms = max(max_rms, rms);
+			}
+		}
+	}
+	return max_rms;
+}
+
+void FusionBenchmark::generateSample(const Trajectory& trajectory, float t,
+		uint32& random, Sample& sample) {
+	/* attitude & euler angle rates */
+	float angle[3], angle_rate[3];
+	for(int i=0; i<3; ++i) {
+		float w = 2.f*(float)M_PI * trajectory.freq[i];
+		float x = w * t + trajectory.phase[i];
+		angle[i] = wrapAngle((float)DEG2RAD(trajectory.offset[i] +
+				trajectory.amplitude[i] * sinf(x) + trajectory.rate[i] * t));
+		angle_rate[i] = (float)DEG2RAD(trajectory.amplitude[i] * w * cosf(x) +
+				trajectory.rate[i]);
+	}
+	sample.attitude = Vec3f(angle[0], angle[1], angle[2]);
+
+	float sr = sinf(angle[0]), cr = cosf(angle[0]);
+	float sp = sinf(angle[1]), cp = cosf(angle[1]);
+	float sy = sinf(angle[2]), cy = cosf(angle[2]);
+
+	/* body rates from the euler angle rates (Z-Y-X) */
+	Vec3f gyro(angle_rate[0] - angle_rate[2] * sp,
+		angle_rate[1] * cr + angle_rate[2] * sr * cp,
+		-angle_rate[1] * sr + angle_rate[2] * cr * cp);
+
+	/* world (NED) to body (front, right, down) */
+	auto toBody = [=](const Vec3f& v) {
+		Vec3f a(cy * v.x + sy * v.y, -sy * v.x + cy * v.y, v.z);
+		Vec3f b(cp * a.x - sp * a.z, a.y, sp * a.x + cp * a.z);
+		return Vec3f(b.x, cr * b.y + sr * b.z, -sr * b.y + cr * b.z);
+	};
+	Vec3f accel = toBody(Vec3f(0.f, 0.f, -BENCHMARK_GRAVITY));
+	Vec3f mag = toBody(Vec3f(0.21f, 0.f, 0.43f));
+
+	/* same magnitude of noise & bias as the simulation (sil/) */
+	const Vec3f gyro_bias(0.01f, -0.008f, 0.005f);
+	for(int i=0; i<3; ++i) {
+		sample.gyro[i] = gyro[i] + gyro_bias[i] + 0.01f * randomNormal(random);
+		sample.accel[i] = accel[i] + 0.3f * randomNormal(random);
+		sample.mag[i] = mag[i] + 0.005f * randomNormal(random);
+	}
+}
+
+void FusionBenchmark::runSingle(Output& output, const Algorithm& algorithm,
+		const Trajectory& trajectory, bool fast_convergence) {
+
+	SensorFusionBase* fusion = algorithm.create();
+	static constexpr uint batch_size = 250;
+	Sample* samples = new Sample[batch_size];
+	Vec3f* attitudes = new Vec3f[batch_size];
+	if(!fusion || !samples || !attitudes) {
+		output.printf("Error: out of memory\n");
+		delete fusion;
+		delete[] samples;
+		delete[] attitudes;
+		return;
+	}
+
+	const uint num_updates = (uint)(m_duration * m_rate_hz);
+	const uint fast_convergence_updates = (uint)(fast_convergence_time * m_rate_hz);
+	const float dt = 1.f / m_rate_hz;
+	uint32 random = 0x2545f491; //same data for all algorithms
+
+	uint64_t total_cycles = 0;
+	float min_cycles_per_update = 1e30f;
+	float last_bad_time = 0.f; //last time the error was above the threshold
+	float sum_squared[3] = {0.f, 0.f, 0.f};
+	float max_error[3] = {0.f, 0.f, 0.f};
+	uint num_errors = 0;
+	const float threshold = (float)DEG2RAD(convergence_threshold);
+
+	fusion->enableFastConvergence(fast_convergence);
+	for(uint start = 0; start < num_updates; start += batch_size) {
+		uint count = min(batch_size, num_updates - start);
+		for(uint k=0; k<count; ++k)
+			generateSample(trajectory, (start+k+1)*dt, random, samples[k]);
+
+		uint32 start_cycles = getCycleCount();
+		for(uint k=0; k<count; ++k) {
+			if(start + k == fast_convergence_updates)
+				fusion->enableFastConvergence(false);
+			fusion->update(samples[k].gyro, samples[k].accel, samples[k].mag,
+					dt*1000.f, attitudes[k]);
+		}
+		uint32 cycles = getCycleCount() - start_cycles;
+		total_cycles += cycles;
+		min_cycles_per_update = min(min_cycles_per_update, (float)cycles / count);
+
+		for(uint k=0; k<count; ++k) {
+			float t = (start+k+1)*dt;
+			bool bad = false;
+			for(int i=0; i<3; ++i) {
+				float error = fabsf(wrapAngle(attitudes[k][i] - samples[k].attitude[i]));
+				if(!(error < threshold)) bad = true; //also catches NaN
+				if(t >= settle_time) {
+					sum_squared[i] += error*error;
+					if(!(error <= max_error[i])) max_error[i] = error;
+				}
+			}
+			if(bad) last_bad_time = t;
+			if(t >= settle_time) ++num_errors;
+		}
+	}
+
+	float cycles_per_update = (float)total_cycles / num_updates;
+	float ns_per_cycle = 1e9f / getCycleCounterFrequency();
+	float end_time = num_updates * dt;
+	float convergence = last_bad_time >= end_time - dt/2.f ? -1.f : last_bad_time;
+
+	output.printf("{\"benchmark\":\"fusion\",\"algorithm\":\"%s\",\"trajectory\":\"%s\","
+		"\"fast_convergence\":%i,\"rate_hz\":%u,\"updates\":%u,",
+		algorithm.name.c_str(), trajectory.name, (int)fast_convergence,
+		m_rate_hz, num_updates);
+	output.printf("\"cycles_per_update\":%.1f,\"min_cycles_per_update\":%.1f,"
+		"\"ns_per_update\":%.1f,\"updates_per_s\":%u,\"convergence_s\":%.3f,",
+		cycles_per_update, min_cycles_per_update, cycles_per_update * ns_per_cycle,
+		(uint)(1e9f / (cycles_per_update * ns_per_cycle)), convergence);
+	float rms[3];
+	for(int i=0; i<3; ++i) {
+		rms[i] = validOr((float)RAD2DEG(sqrtf(sum_squared[i] / num_errors)));
+		max_error[i] = validOr((float)RAD2DEG(max_error[i]));
+	}
+	output.printf("\"rms_deg\":[%.3f,%.3f,%.3f],\"max_deg\":[%.3f,%.3f,%.3f]}\n",
+		rms[0], rms[1], rms[2], max_error[0], max_error[1], max_error[2]);
+
+	delete fusion;
+	delete[] samples;
+	delete[] attitudes;
+}
+
+
+FusionComparison::FusionComparison(SensorFusionBase& primary, const char* primary_name,
+		SensorFusionBase& secondary, const char* secondary_name)
+	: m_primary(primary), m_secondary(secondary), m_primary_name(primary_name),
+	  m_secondary_name(secondary_name) {
+	setEnabled(false);
+}
+
+void FusionComparison::setEnabled(bool enabled) {
+	m_enabled = false;
+	m_num_updates = 0;
+	m_dt_sum = 0.f;
+	m_history_index = 0;
+	for(int i=0; i<2; ++i) {
+		m_cycles[i] = 0;
+		m_sum_squared_diff[i] = 0.f;
+	}
+	m_enabled = enabled;
+}
+
+void FusionComparison::update(const Math::Vec3f& gyro, const Math::Vec3f& accel,
+		const Math::Vec3f& mag, float dt, Math::Vec3f& attitude) {
+	m_primary.enableFastConvergence(m_fast_convergence);
+	if(!m_enabled) {
+		m_primary.update(gyro, accel, mag, dt, attitude);
+		return;
+	}
+	m_secondary.enableFastConvergence(m_fast_convergence);
+
+	Vec3f attitude_secondary;
+	uint32 start_cycles = getCycleCount();
+	m_primary.update(gyro, accel, mag, dt, attitude);
+	uint32 mid_cycles = getCycleCount();
+	m_secondary.update(gyro, accel, mag, dt, attitude_secondary);
+	uint32 end_cycles = getCycleCount();
+	m_cycles[0] += mid_cycles - start_cycles;
+	m_cycles[1] += end_cycles - mid_cycles;
+
+	for(int i=0; i<2; ++i) {
+		float diff = wrapAngle(attitude_secondary[i] - attitude[i]);
+		m_sum_squared_diff[i] += diff*diff;
+		m_history[0][i][m_history_index] = attitude[i];
+		m_history[1][i][m_history_index] = attitude_secondary[i];
+	}
+	m_history_index = (m_history_index + 1) % history_size;
+	m_dt_sum += dt;
+	++m_num_updates;
+}
+
+void FusionComparison::report(Output& output) {
+	bool was_enabled = m_enabled;
+	m_enabled = false; //the history must not change while it is evaluated
+
+	uint num_updates = m_num_updates;
+	float dt = num_updates ? m_dt_sum / num_updates : 0.f;
+	float ns_per_cycle = 1e9f / getCycleCounterFrequency();
+	float time_us[2];
+	for(int i=0; i<2; ++i)
+		time_us[i] = num_updates ? (float)m_cycles[i] / num_updates * ns_per_cycle / 1000.f : 0.f;
+
+	//normalized cross-correlation of roll & pitch (mean removed) for each lag
+	float lag = -1.f, best_correlation = -1.f;
+	int n = (int)min(num_updates, (uint)history_size);
+	if(n > 2 * max_lag) {
+		int first = (m_history_index - n + history_size) % history_size;
+		float mean[2][2];
+		for(int k=0; k<2; ++k) {
+			for(int i=0; i<2; ++i) {
+				float sum = 0.f;
+				for(int j=0; j<n; ++j) sum += m_history[k][i][(first + j) % history_size];
+				mean[k][i] = sum / n;
+			}
+		}
+		for(int l=-max_lag; l<=max_lag; ++l) {
+			float sum_ab = 0.f, sum_aa = 0.f, sum_bb = 0.f;
+			for(int j=max(0, -l); j<min(n, n - l); ++j) {
+				for(int i=0; i<2; ++i) {
+					float a = m_history[0][i][(first + j) % history_size] - mean[0][i];
+					float b = m_history[1][i][(first + j + l) % history_size] - mean[1][i];
+					sum_ab += a*b;
+					sum_aa += a*a;
+					sum_bb += b*b;
+				}
+			}
+			if(sum_aa > 0.f && sum_bb > 0.f) {
+				float correlation = sum_ab / sqrtf(sum_aa * sum_bb);
+				if(correlation > best_correlation) {
+					best_correlation = correlation;
+					lag = l * dt;
+				}
+			}
+		}
+		if(best_correlation < 0.f) lag = -1.f;
+	}
+
+	output.printf("{\"benchmark\":\"fusion_compare\",\"primary\":\"%s\",\"secondary\":\"%s\","
+		"\"updates\":%u,\"dt_ms\":%.3f,\"time_us\":[%.2f,%.2f],",
+		m_primary_name, m_secondary_name, num_updates, dt, time_us[0], time_us[1]);
+	float rms[2];
+	for(int i=0; i<2; ++i)
+		rms[i] = num_updates ? validOr((float)RAD2DEG(sqrtf(m_sum_squared_diff[i] / num_updates))) : -1.f;
+	output.printf("\"lag_ms\":%.3f,\"correlation\":%.3f,\"rms_diff_deg\":[%.3f,%.3f]}\n",
+		lag, validOr(best_correlation), rms[0], rms[1]);
+
+	m_enabled = was_enabled;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _FLIGHT_CONTROLLER_FUSION_BENCHMARK_HEADER_HPP_
+#define _FLIGHT_CONTROLLER_FUSION_BENCHMARK_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/io.hpp>
+#include <kernel/aux/vec3.hpp>
+
+#include "sensor_fusion.hpp"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+/**
+ * benchmark of the sensor fusion algorithms: each algorithm runs over a set
+ * of synthetic trajectories with known attitude. the sensor data is generated
+ * from the true attitude plus (deterministic) noise & bias, so all algorithms
+ * get exactly the same input.
+ *
+ * each run starts with the identity attitude & is done with and without fast
+ * convergence (enabled for the first second). measured are:
+ * - execution time of update(), in CPU cycles & ns (on the host the cycle
+ *   counter counts ns). IRQ's during a measurement are included
+ * - convergence time: after this, the error of all axes stays below 5 deg
+ * - RMS & max error per axis (roll, pitch, yaw) after the settle time (5 s)
+ *
+ * output: one JSON object per run & line, for example:
+ *   {"benchmark":"fusion","algorithm":"mahony","trajectory":"static-level",
+ *    "fast_convergence":0,"rate_hz":1000,"updates":20000,
+ *    "cycles_per_update":812.4,"min_cycles_per_update":790.2,
+ *    "ns_per_update":1160.5,"updates_per_s":861700,"convergence_s":3.214,
+ *    "rms_deg":[0.1,0.1,0.3],"max_deg":[0.4,0.3,0.9]}
+ *   convergence_s is -1 if the error never stays below the threshold. the
+ *   errors are -1 if the filter diverged (NaN).
+ */
+class FusionBenchmark {
+public:
+	typedef std::function<SensorFusionBase* ()> FuncCreate;
+
+	/**
+	 * @param duration simulated time per run [s] (>= 2*settle time)
+	 * @param rate_hz update rate
+	 */
+	FusionBenchmark(float duration=20.f, uint rate_hz=1000);
+
+	/** add an algorithm. create must return a new instance (deleted after the run) */
+	void addAlgorithm(const std::string& name, FuncCreate create);
+
+	/** all implemented algorithms, Mahony also with the gains of the FC (in
+	 *  float & fixed-point) */
+	void addDefaultAlgorithms();
+
+	/** run all algorithms over all trajectories. this blocks for a while */
+	void run(Output& output);
+
+	/**
+	 * run two algorithms with the same input over all trajectories (with and
+	 * without fast convergence) & compare their attitudes, eg. float against
+	 * fixed-point.
+	 * @return the largest RMS difference of an axis after the settle time
+	 *         [deg] (-1 if an algorithm diverged)
+	 */
+	float maxRMSDifference(FuncCreate create_a, FuncCreate create_b);
+
+	static constexpr float settle_time = 5.f; /** [s] */
+	static constexpr float fast_convergence_time = 1.f; /** [s] */
+	static constexpr float convergence_threshold = 5.f; /** [deg] */
+
+private:
+	struct Algorithm {
+		std::string name;
+		FuncCreate create;
+	};
+
+	/**
+	 * trajectory: each angle (roll, pitch, yaw) is given by
+	 * offset + amplitude * sin(2*pi*freq*t + phase) + rate * t. in [deg]
+	 */
+	struct Trajectory {
+		const char* name;
+		float offset[3];
+		float amplitude[3];
+		float freq[3]; /** [Hz] */
+		float phase[3]; /** [rad] */
+		float rate[3]; /** [deg/s] */
+	};
+
+	/** generated input & the true attitude of one time step */
+	struct Sample {
+		Math::Vec3f gyro, accel, mag;
+		Math::Vec3f attitude;
+	};
+
+	void runSingle(Output& output, const Algorithm& algorithm,
+			const Trajectory& trajectory, bool fast_convergence);
+
+	/** calculate true attitude & sensor data at time t */
+	static void generateSample(const Trajectory& trajectory, float t,
+			uint32& random, Sample& sample);
+
+	static const Trajectory trajectories[];
+	static const int num_trajectories;
+
+	std::vector<Algorithm> m_algorithms;
+	float m_duration;
+	uint m_rate_hz;
+};
+
+
+/**
+ * live comparison of two sensor fusion algorithms on the real sensor data (eg.
+ * the MPU-6050 DMP against Mahony, which cannot run on synthetic data). It is
+ * used as the fusion of the flight controller: the primary algorithm is always
+ * updated & its attitude is returned. When enabled, the secondary gets the
+ * same input and the following is measured:
+ * - execution time of update() of both algorithms
+ * - attitude lag of the secondary relative to the primary: the maximum of the
+ *   cross-correlation of roll & pitch over the last history_size updates.
+ *   positive means the secondary is late
+ * - RMS difference of roll & pitch (yaw is not compared, the references of
+ *   the algorithms can differ)
+ *
+ * output of report(): one JSON object per line, for example:
+ *   {"benchmark":"fusion_compare","primary":"dmp","secondary":"mahony",
+ *    "updates":5000,"dt_ms":2.000,"time_us":[310.5,4.1],"lag_ms":-6.000,
+ *    "correlation":0.987,"rms_diff_deg":[0.8,1.1]}
+ *   lag_ms & correlation are -1 if there is not enough data or no motion.
+ */
+class FusionComparison final : public SensorFusionBase {
+public:
+	FusionComparison(SensorFusionBase& primary, const char* primary_name,
+			SensorFusionBase& secondary, const char* secondary_name);
+
+	virtual void update(const Math::Vec3f& gyro, const Math::Vec3f& accel,
+			const Math::Vec3f& mag, float dt, Math::Vec3f& attitude);
+
+	/** start (resets the measurement) or stop the comparison */
+	void setEnabled(bool enabled);
+	bool enabled() const { return m_enabled; }
+
+	void report(Output& output);
+
+	static constexpr int history_size = 512; /** [updates] */
+	static constexpr int max_lag = 100; /** [updates] */
+private:
+	SensorFusionBase& m_primary;
+	SensorFusionBase& m_secondary;
+	const char* m_primary_name;
+	const char* m_secondary_name;
+
+	volatile bool m_enabled = false;
+
+	uint m_num_updates = 0;
+	uint64_t m_cycles[2];
+	float m_dt_sum = 0.f; /** [ms] */
+	float m_sum_squared_diff[2];
+
+	/** ring buffer of roll & pitch: [algorithm][axis][index] */
+	float m_history[2][2][history_size];
+	int m_history_index = 0;
+};
+
+#endif /* _FLIGHT_CONTROLLER_FUSION_BENCHMARK_HEADER_HPP_ */
@@ -270,9 +270,11 @@ protected:
 
 /**
  * PPM sum input signal: single signal for multiple channels.
+ * the decoder publishes complete frames, so update() does not disable
+ * interrupts & all values of a frame are updated together, once.
  */
 template<typename T=float>
-class InputControlPPMSumIRQ : public InputControlPWMIRQ<T> {
+class InputControlPPMSumIRQ final : public InputControlPWMIRQ<T> {
 public:
 	/**
 	 * constructor. does not setup gpio irqs.
@@ -298,8 +300,22 @@ public:
 	void setupAndEnableIRQs();
 
 	virtual void update();
+
+	/** number of frames received (including the short ones) */
+	uint32 numFrames() const { return m_frame_counter; }
+	/**
+	 * number of frames that ended before all mapped channels (cut short by a
+	 * sync pulse). they are ignored, so that the values of an update are
+	 * always from the same frame
+	 */
+	uint numShortFrames() const { return m_num_short_frames; }
+	/** end of the last complete frame */
+	Timestamp frameTimestamp() const { return m_frame_timestamp; }
 private:
 	int m_gpio_ppm_pin;
+	uint32 m_frame_counter = 0;
+	uint m_num_short_frames = 0;
+	Timestamp m_frame_timestamp = 0;
 };
 
 
@@ -358,19 +374,22 @@ inline void InputControlPWMIRQ<T>::setScalingAll(T scaling) {
 template<typename T>
 inline void InputControlPWMIRQ<T>::update() {
 	
-	disableInterrupts();
 	for(int i=0; i<InputControlValue_Count; ++i) {
 		int idx = m_gpio_indexes[i];
 		if(idx == -1) continue;
+		/* no need to disable interrupts: a rising edge after reading high does
+		 * not matter, a falling edge after reading high is detected with the
+		 * counter (then the pulse is read in the next update) */
+		uint low_count = g_irq_gpio_low_counter[idx];
+		Timestamp high = g_irq_gpio_high_last_timestamp[idx];
+		Timestamp low = g_irq_gpio_low_last_timestamp[idx];
+		if(low_count != g_irq_gpio_low_counter[idx]) continue;
 		//this can be wrong on wrap-around. but we miss at most one pulse, so no big deal.
-		if(g_irq_gpio_low_last_timestamp[idx] != m_gpio_last_timestamps[i]
-			&& g_irq_gpio_low_last_timestamp[idx] > g_irq_gpio_high_last_timestamp[idx]) {
-			m_gpio_last_timestamps[i] = g_irq_gpio_low_last_timestamp[idx];
-			updateValue((InputControlValue)i,
-				T(g_irq_gpio_low_last_timestamp[idx] - g_irq_gpio_high_last_timestamp[idx]) / T(1000));
+		if(low != m_gpio_last_timestamps[i] && low > high) {
+			m_gpio_last_timestamps[i] = low;
+			updateValue((InputControlValue)i, T(low - high) / T(1000));
 		}
 	}
-	enableInterrupts();
 }
 
 template<typename T>
@@ -426,24 +445,32 @@ inline InputControlPPMSumIRQ<T>::InputControlPPMSumIRQ(int gpio_signal_pin,
 
 template<typename T>
 inline void InputControlPPMSumIRQ<T>::setupAndEnableIRQs() {
-	setupPPMDecoder(m_gpio_ppm_pin, 4500);
+	int num_channels = 1;
+	for(int i=0; i<InputControlValue_Count; ++i)
+		num_channels = std::max(num_channels, this->m_gpio_indexes[i]+1);
+	setupPPMDecoder(m_gpio_ppm_pin, 4500, std::min(num_channels, MAX_PPM_CHANNELS));
 	InputControlPWMIRQ<T>::setupGPIOPin(m_gpio_ppm_pin);
 	enableGpioIRQ();
 }
 
 template<typename T>
 void InputControlPPMSumIRQ<T>::update() {
-	disableInterrupts();
+	PPMFrame frame;
+	if(!getPPMFrame(&frame) || frame.frame_counter == m_frame_counter)
+		return;
+	m_frame_counter = frame.frame_counter;
+	for(int i=0; i<InputControlValue_Count; ++i) {
+		if(this->m_gpio_indexes[i] >= frame.num_channels) {
+			++m_num_short_frames;
+			return;
+		}
+	}
+	m_frame_timestamp = frame.timestamp;
 	for(int i=0; i<InputControlValue_Count; ++i) {
 		int idx = this->m_gpio_indexes[i];
 		if(idx == -1) continue;
-		if(g_ppm_signals[idx].pulse_stop != this->m_gpio_last_timestamps[i]) {
-			this->m_gpio_last_timestamps[i] = g_ppm_signals[idx].pulse_stop;
-			this->updateValue((InputControlValue)i,
-				T(g_ppm_signals[idx].pulse_stop - g_ppm_signals[idx].pulse_start) / T(1000));
-		}
+		this->updateValue((InputControlValue)i, T(frame.pulse_length[idx]) / T(1000));
 	}
-	enableInterrupts();
 }
 
 template<typename T>
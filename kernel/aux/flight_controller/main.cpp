@@ -26,11 +26,16 @@ using namespace std;
 #include <kernel/gpio.h>
 #include <kernel/math.h>
 #include <kernel/serial.h>
+#include <kernel/i2c.hpp>
+#include <kernel/spi.h>
+#include <kernel/interrupt.h>
 #include <kernel/aux/filter.hpp>
 
-#include "flight_controller.hpp"
+#include "flight_controller_impl.hpp"
 #include "main.hpp"
 #include "sensor.hpp"
+#include "sensor_fusion_dmp.hpp"
+#include "fusion_benchmark.hpp"
 #include "common.hpp"
 
 #ifdef FLIGHT_CONTROLLER_DEBUG_MODE
@@ -66,7 +71,24 @@ void flight_controller_main() {
 	config.input_switch_flying = &input_switch_flying;
 	
 	/* sensors */
+#ifdef FLIGHT_CONTROLLER_SPI_IMU
+	SPIMPU6000 accelgyro(spiTransfer, 0);
+	accelgyro.initialize();
+	if(!accelgyro.testConnection()) {
+		printk_crit("Error: no connection to SPI Accel/Gyro\n");
+		RETURN_IF_NOT_DEBUG;
+	}
+	MPU6000Sampler accelgyro_sampler(accelgyro);
+	typedef SensorMPU6000GyroAccel<true> SensorAccel;
+	typedef SensorMPU6000GyroAccel<false> SensorGyro;
+	SensorAccel sensor_accel(accelgyro_sampler);
+	SensorGyro sensor_gyro(accelgyro_sampler);
+	//full gyro rate: every control iteration integrates all new samples
+	accelgyro_sampler.setFIFOMode(true, accelgyro.setSampleRate(8000));
+#else
 	I2CMPU6050 accelgyro;
+	//configuration changes without reading the register first
+	accelgyro.enableRegisterCache();
 	accelgyro.initialize();
 	//enable slave bypass for direct access to attached compass
 	accelgyro.setI2CMasterModeEnabled(false);
@@ -75,8 +97,31 @@ void flight_controller_main() {
 		printk_crit("Error: no connection to Accel/Gyro\n");
 		RETURN_IF_NOT_DEBUG;
 	}
-	SensorMPU6050GyroAccel<true> sensor_accel(accelgyro);
-	SensorMPU6050GyroAccel<false> sensor_gyro(accelgyro);
+	MPU6050Sampler accelgyro_sampler(accelgyro); //one burst read for both
+	typedef SensorMPU6050GyroAccel<true> SensorAccel;
+	typedef SensorMPU6050GyroAccel<false> SensorGyro;
+	SensorAccel sensor_accel(accelgyro_sampler);
+	SensorGyro sensor_gyro(accelgyro_sampler);
+#ifdef FLIGHT_CONTROLLER_DMP_FUSION
+	//the DMP uses the FIFO, so the sampler stays in direct mode. the DMP
+	//initialization resets the device & sets its own rate & ranges
+	SensorFusionMPU6050DMP sensor_fusion_dmp(accelgyro);
+	if(sensor_fusion_dmp.initialize() != SUCCESS) {
+		printk_crit("Error: DMP initialization failed\n");
+		RETURN_IF_NOT_DEBUG;
+	}
+	accelgyro.setI2CMasterModeEnabled(false);
+	accelgyro.setI2CBypassEnabled(true);
+	sensor_accel.updateScale();
+	sensor_gyro.updateScale();
+#else
+	//no gyro samples are lost when the control loop is late
+	accelgyro_sampler.setFIFOMode(true, sensor_gyro.minMeasurementDelayMicro());
+	//INT pin of the MPU-6050 on GPIO 4 (-1 if not connected): read only new
+	//samples & use the IRQ timestamp as sample time
+	accelgyro_sampler.setDataReadyPin(4);
+#endif /* FLIGHT_CONTROLLER_DMP_FUSION */
+#endif /* FLIGHT_CONTROLLER_SPI_IMU */
 	config.sensor_accel = &sensor_accel;
 	config.sensor_gyro = &sensor_gyro;
 
@@ -90,6 +135,7 @@ void flight_controller_main() {
 	config.sensor_barometer = &sensor_baro;
 	
 	SensorHMC5883LCompass<> sensor_compass;
+	sensor_compass.enableRegisterCache();
 	sensor_compass.initialize();
 	if(!sensor_compass.testConnection()) {
 		printk_crit("Error: no connection to Compass!\n");
@@ -97,7 +143,14 @@ void flight_controller_main() {
 	}
 	config.sensor_compass = &sensor_compass;
 	
-	SensorFusionMahonyAHRS sensor_fusion(1.4f, 0.02f);
+#ifdef FLIGHT_CONTROLLER_DMP_FUSION
+	SensorFusionMahonyAHRS<> sensor_fusion_mahony(1.4f, 0.02f);
+	FusionComparison sensor_fusion(sensor_fusion_dmp, "dmp", sensor_fusion_mahony, "mahony");
+	typedef FusionComparison SensorFusion;
+#else
+	SensorFusionMahonyAHRS<> sensor_fusion(1.4f, 0.02f);
+	typedef SensorFusionMahonyAHRS<> SensorFusion;
+#endif /* FLIGHT_CONTROLLER_DMP_FUSION */
 	config.sensor_fusion = &sensor_fusion;
 	config.altitude_cutoff_freq = 0.15f; //barometer data is very noisy!
 	
@@ -106,18 +159,57 @@ void flight_controller_main() {
 	
 	
 	/* motor output */
+#if defined(FLIGHT_CONTROLLER_DSHOT_OUTPUT)
+	//DShot300: a frame takes 53 us. the period without updates (2 ms) is
+	//longer than a control loop iteration, so that every update sends a new
+	//frame immediately
+	const int dshot_pins[4] = { 22, 23, 24, 25 }; /* gpio pin per motor (see also motor_controller.hpp) */
+	if(initESCOutputDShot(dshot_pins, 4, ESC_MODE_SYNCHRONIZED, 2000000, 300) != SUCCESS) {
+		printk_crit("Error: DShot output initialization failed\n");
+		RETURN_IF_NOT_DEBUG;
+	}
+	/* digital throttle: 0 stops the motors, no calibration needed */
+	array<float, 4> min_thrusts = {{ 0.f, 0.f, 0.f, 0.f }};
+	array<float, 4> max_thrusts = {{ 1.f, 1.f, 1.f, 1.f }};
+	typedef MotorControllerDShot MotorController;
+	MotorControllerDShot motor_controller(min_thrusts, max_thrusts,
+		[](const uint16* frames) { return escOutputUpdateDShot(frames); });
+#else
+#ifdef FLIGHT_CONTROLLER_ESC_OUTPUT
+	//OneShot125: period 1.25 ms without updates, longer than a control loop
+	//iteration, so that every update starts a new pulse immediately
+	int pwm_frequency = 100;
+#else
 	int pwm_frequency = 350;
+#endif /* FLIGHT_CONTROLLER_ESC_OUTPUT */
 	float mfreq = (float)pwm_frequency/1000.f;
 	array<float, 4> min_thrusts = {{mfreq*1.312f, mfreq*1.297f, mfreq*1.355f, mfreq*1.305f}}; /* min thrust per motor (around 1ms) */
 	array<float, 4> max_thrusts = {{mfreq*(1.312f+0.8f), mfreq*(1.297f+0.8f), mfreq*(1.355f+0.8f), mfreq*(1.305f+0.8f)}}; /* max thrust per motor (around 2ms) */
+#ifdef FLIGHT_CONTROLLER_ESC_OUTPUT
+	typedef MotorControllerESC MotorController;
+	MotorControllerESC motor_controller(min_thrusts, max_thrusts,
+		{{ 22, 23, 24, 25 }}, /* gpio pin per motor (see also motor_controller.hpp) */
+		MotorControllerESC::Protocol_OneShot125, true);
+#else
+	typedef MotorControllerAdafruitPWM MotorController;
+	const int motor_i2c_bus = FLIGHT_CONTROLLER_MOTOR_I2C_BUS;
+	if(motor_i2c_bus != I2C_DEFAULT_BUS && initI2CBus(motor_i2c_bus, 400) != SUCCESS) {
+		printk_crit("Error: initializing the motor I2C bus failed\n");
+		RETURN_IF_NOT_DEBUG;
+	}
 	MotorControllerAdafruitPWM motor_controller(min_thrusts, max_thrusts,
 		{{ 0, 1, 2, 3 }}, /* motor channel association (see also motor_controller.hpp) */
-		i2cWrite, i2cRead);
+		/* the control loop does not wait for motor updates */
+		i2cBusWriteAsyncFunction(motor_i2c_bus), i2cBusReadFunction(motor_i2c_bus));
+	//register reads with a repeated start
+	motor_controller.setWriteReadFunction(i2cBusWriteReadFunction(motor_i2c_bus));
 	motor_controller.reset();
+#endif /* FLIGHT_CONTROLLER_ESC_OUTPUT */
 	if(!motor_controller.setPWMFreq(pwm_frequency)) {
 		printk_crit("Error: setting PWM frequency failed\n");
 		RETURN_IF_NOT_DEBUG;
 	}
+#endif /* FLIGHT_CONTROLLER_DSHOT_OUTPUT */
 	config.motor_controller = &motor_controller;
 	
 	
@@ -135,6 +227,122 @@ void flight_controller_main() {
 	InputOutput io(uartTryRead, uart_writef);
 	CommandLine cmd_line(io, "$\x1b[32;1mbPI\x1b[0m> ");
 	config.command_line = &cmd_line;
+	cmd_line.addTestCommand([&accelgyro_sampler](const vector<string>& arguments,
+			InputOutput& io) {
+		accelgyro_sampler.printStatus(io);
+		if(arguments.size() > 0 && arguments[0] == "reset")
+			accelgyro_sampler.resetStatistics();
+	}, "imu", "print IMU sampling statistics ('reset' to reset them)");
+	cmd_line.addTestCommand([](const vector<string>& arguments,
+			InputOutput& io) {
+		SPIStatistics statistics;
+		spiGetStatistics(&statistics);
+		io.printf("transfers: %u (%u async), errors: %u, queue full: %u\n",
+				statistics.transfers, statistics.async_transfers,
+				statistics.errors, statistics.queue_full);
+		io.printf("  bytes: %u, bus time: %u us, waiting: %u us\n",
+				statistics.bytes, statistics.bus_time_us, statistics.wait_time_us);
+		if(arguments.size() > 0 && arguments[0] == "reset")
+			spiResetStatistics();
+	}, "spi", "print SPI statistics ('reset' to reset them)");
+	uint i2c_statistics_ticks = getTimerIRQCounter();
+	cmd_line.addTestCommand([&i2c_statistics_ticks](const vector<string>& arguments,
+			InputOutput& io) {
+		uint ticks = getTimerIRQCounter() - i2c_statistics_ticks;
+		for(int bus = 0; bus < I2C_NUM_BUSES; ++bus) {
+			I2CStatistics statistics;
+			if(i2cGetStatistics(bus, &statistics) < 0) continue;
+			if(statistics.transactions == 0 && bus != I2C_DEFAULT_BUS) continue;
+			io.printf("bus %i: transactions: %u (%u async), errors: %u, timeouts: %u, queue full: %u\n",
+					bus, statistics.transactions, statistics.async_transactions,
+					statistics.errors, statistics.timeouts, statistics.queue_full);
+			io.printf("  bus time: %u us (%.1f us per transaction), waiting: %u us\n",
+					statistics.bus_time_us, statistics.transactions ?
+					(float)statistics.bus_time_us / statistics.transactions : 0.f,
+					statistics.wait_time_us);
+			io.printf("  CPU time recovered by async transfers: %u us (%.1f us per tick, %u ticks)\n",
+					statistics.async_bus_time_us, ticks ?
+					(float)statistics.async_bus_time_us / ticks : 0.f, ticks);
+			io.printf("  bus recoveries: %u, rejected during recovery: %u\n",
+					statistics.recoveries, statistics.rejected);
+			for(int addr = 0; addr < 128; ++addr) {
+				I2CDeviceStatistics device;
+				if(i2cGetDeviceStatistics(bus, addr, &device) < 0 || device.transactions == 0)
+					continue;
+				io.printf("  0x%02x: %u transactions, errors: %u, timeouts: %u, "
+						"latency: %.1f us mean, %u us max\n", addr, device.transactions,
+						device.errors, device.timeouts,
+						(float)device.latency_sum_us / device.transactions,
+						device.latency_max_us);
+			}
+		}
+		io.printf("register cache: %u reads saved, %u misses\n",
+				(uint)I2Cdev::cacheHits, (uint)I2Cdev::cacheMisses);
+		if(arguments.size() > 0 && arguments[0] == "reset") {
+			i2cResetStatistics();
+			I2Cdev::cacheHits = I2Cdev::cacheMisses = 0;
+			i2c_statistics_ticks = getTimerIRQCounter();
+		}
+	}, "i2c", "print I2C statistics ('reset' to reset them)");
+	cmd_line.addTestCommand([&motor_controller](const vector<string>& arguments,
+			InputOutput& io) {
+		motor_controller.printStatus(io);
+		motor_controller.mixer().printStatus(io);
+#if defined(FLIGHT_CONTROLLER_DSHOT_OUTPUT)
+		ESCOutputStatistics statistics;
+		escOutputGetStatistics(&statistics);
+		io.printf("period %u us, immediate: %u, next period: %u, replaced: %u, errors: %u\n",
+				(uint)(escOutputPeriod()/1000), statistics.immediate, statistics.busy,
+				statistics.deferred, statistics.errors);
+		if(arguments.size() > 0 && arguments[0] == "reset")
+			escOutputResetStatistics();
+#elif !defined(FLIGHT_CONTROLLER_ESC_OUTPUT)
+		const int motor_i2c_bus = FLIGHT_CONTROLLER_MOTOR_I2C_BUS;
+		I2CDeviceStatistics device;
+		if(i2cGetDeviceStatistics(motor_i2c_bus, motor_controller.address(), &device) >= 0
+				&& device.transactions > 0) {
+			//submit to stop condition (includes waiting for other transactions)
+			io.printf("update latency: %.1f us mean, %u us max (bus %i)\n",
+					(float)device.latency_sum_us / device.transactions,
+					device.latency_max_us, motor_i2c_bus);
+		}
+#endif /* FLIGHT_CONTROLLER_ESC_OUTPUT */
+		if(arguments.size() > 0 && arguments[0] == "reset") {
+			motor_controller.resetStatistics();
+			motor_controller.mixer().resetStatistics();
+		}
+	}, "pwm", "print motor output statistics ('reset' to reset them)");
+	cmd_line.addTestCommand([&input_control](const vector<string>& arguments,
+			InputOutput& io) {
+		uint32 frames = input_control.numFrames();
+		if(frames == 0) {
+			io.printf("no PPM frame received\n");
+			return;
+		}
+		io.printf("PPM frames: %u (%u short, ignored), last one %u ms ago\n", frames,
+				input_control.numShortFrames(),
+				(uint)((getTimestamp() - input_control.frameTimestamp())/1000));
+	}, "ppm", "print the number of received PPM frames");
+#ifdef FLIGHT_CONTROLLER_DMP_FUSION
+	cmd_line.addTestCommand([&sensor_fusion_dmp](const vector<string>& arguments,
+			InputOutput& io) {
+		sensor_fusion_dmp.printStatus(io);
+		if(arguments.size() > 0 && arguments[0] == "reset")
+			sensor_fusion_dmp.resetStatistics();
+	}, "dmp", "print MPU-6050 DMP statistics ('reset' to reset them)");
+	cmd_line.addTestCommand([&sensor_fusion](const vector<string>& arguments,
+			InputOutput& io) {
+		if(arguments.size() > 0 && arguments[0] == "start")
+			sensor_fusion.setEnabled(true);
+		else if(arguments.size() > 0 && arguments[0] == "stop")
+			sensor_fusion.setEnabled(false);
+		else
+			sensor_fusion.report(io);
+	}, "fusioncmp", "compare DMP & Mahony: 'start', 'stop' or print the result");
+#endif /* FLIGHT_CONTROLLER_DMP_FUSION */
+	config.binary_output = [](int c) { uartWrite(c); return 0; };
+	config.telemetry_output = uartTryWrite;
+	config.blackbox_size = 4*1024*1024; //about 2min at 1kHz ('blackbox dump <s>' for the last s seconds)
 	
 
 	/* additional stuff */
@@ -142,8 +350,13 @@ void flight_controller_main() {
 	config.led_blinker = &led_blinker;
 	
 	
-	/* let's start flying ... */
-	FlightController flight_controller(config);
+	/* let's start flying ... (composed with the device types above, so that
+	 * the control path has no virtual calls) */
+	FlightController<
+		FlightControllerSensors<SensorGyro, SensorAccel,
+			SensorHMC5883LCompass<>, SensorBMP180Baro<>>,
+		SensorFusion, MotorController,
+		InputControlPPMSumIRQ<>> flight_controller(config);
 	flight_controller.run();
 	
 }
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "mixer.hpp"
+#include <kernel/timer.h>
+#include <kernel/utils.h>
+
+using namespace std;
+using namespace Math;
+
+/* deterministic inputs: xorshift, in [-0.5, 0.5] */
+static inline float randomUniform(uint32& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (float)state * (1.f / 4294967296.f) - 0.5f;
+}
+
+template<int N>
+static void benchmarkMixer(Output& output, const char* geometry,
+		const typename MotorMixer<N>::Matrix& matrix, uint num_mixes) {
+
+	MotorMixer<N> mixer(matrix);
+	static constexpr uint batch_size = 250;
+	float* throttle = new float[batch_size];
+	Vec3f* roll_pitch_yaw = new Vec3f[batch_size];
+	std::array<float, N>* outputs = new std::array<float, N>[batch_size];
+	if(!throttle || !roll_pitch_yaw || !outputs) {
+		output.printf("Error: out of memory\n");
+		delete[] throttle;
+		delete[] roll_pitch_yaw;
+		delete[] outputs;
+		return;
+	}
+	uint32 random = 0x2545f491; //same inputs for all geometries
+	uint64_t total_cycles = 0;
+	float checksum = 0.f; //so that the results are used
+
+	for(uint start = 0; start < num_mixes; start += batch_size) {
+		uint count = min(batch_size, num_mixes - start);
+		for(uint k=0; k<count; ++k) {
+			/* full input range: saturates yaw & throttle */
+			throttle[k] = 2.f * randomUniform(random);
+			for(int i=0; i<3; ++i)
+				roll_pitch_yaw[k][i] = 2.f * randomUniform(random);
+		}
+
+		uint32 start_cycles = getCycleCount();
+		for(uint k=0; k<count; ++k)
+			mixer.mix(throttle[k], roll_pitch_yaw[k], outputs[k]);
+		total_cycles += getCycleCount() - start_cycles;
+
+		for(uint k=0; k<count; ++k)
+			checksum += outputs[k][0];
+	}
+
+	float cycles_per_mix = (float)total_cycles / num_mixes;
+	float ns_per_cycle = 1e9f / getCycleCounterFrequency();
+	output.printf("{\"benchmark\":\"mixer\",\"geometry\":\"%s\",\"motors\":%i,"
+		"\"mixes\":%u,\"cycles_per_mix\":%.1f,\"ns_per_mix\":%.1f,",
+		geometry, N, num_mixes, cycles_per_mix, cycles_per_mix * ns_per_cycle);
+	output.printf("\"roll_pitch_limited\":%u,\"yaw_limited\":%u,"
+		"\"throttle_limited\":%u,\"checksum\":%.3f}\n",
+		mixer.numRollPitchLimited(), mixer.numYawLimited(),
+		mixer.numThrottleLimited(), checksum);
+
+	delete[] throttle;
+	delete[] roll_pitch_yaw;
+	delete[] outputs;
+}
+
+void benchmarkMixers(Output& output, uint num_mixes) {
+	if(num_mixes == 0) return;
+	benchmarkMixer<4>(output, "quad-x", mixerQuadX(), num_mixes);
+	benchmarkMixer<4>(output, "quad-plus", mixerQuadPlus(), num_mixes);
+	benchmarkMixer<6>(output, "hex-x", mixerHexX(), num_mixes);
+	benchmarkMixer<8>(output, "octo-x", mixerOctoX(), num_mixes);
+}
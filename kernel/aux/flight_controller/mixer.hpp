@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _FLIGHT_CONTROLLER_MIXER_HEADER_HPP_
+#define _FLIGHT_CONTROLLER_MIXER_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/math.h>
+#include <kernel/io.hpp>
+#include <kernel/aux/vec3.hpp>
+
+#include <array>
+#include <algorithm>
+
+/**
+ * motor mixer for N motors: a N x 4 matrix maps throttle, roll, pitch & yaw
+ * (all in [-1,1]) to the motor outputs in [-1,1]. the matrix size is a
+ * template argument, so the loops have a fixed length & are unrolled.
+ *
+ * desaturation is done in one pass, by priority:
+ * - roll & pitch are scaled down if their differences do not fit the output
+ *   range (then yaw is dropped)
+ * - yaw is reduced so that roll, pitch & yaw fit
+ * - throttle is shifted so that all outputs are in [-1,1]
+ * each limitation is counted (the mixer runs in the control loop, so it
+ * does not print anything).
+ */
+template<int N>
+class MotorMixer {
+public:
+	enum Column {
+		Column_throttle = 0,
+		Column_roll,
+		Column_pitch,
+		Column_yaw
+	};
+	/** one row per motor */
+	typedef std::array<std::array<float, 4>, N> Matrix;
+
+	explicit MotorMixer(const Matrix& matrix) : m_matrix(matrix) {}
+
+	/**
+	 * @param throttle in [-1,1]
+	 * @param roll_pitch_yaw in [-1,1]
+	 * @param output in [-1,1] per motor
+	 */
+	inline void mix(float throttle, const Math::Vec3f& roll_pitch_yaw,
+			std::array<float, N>& output);
+
+	const Matrix& matrix() const { return m_matrix; }
+	void setMatrix(const Matrix& matrix) { m_matrix = matrix; }
+	static constexpr int numMotors() { return N; }
+
+	/**
+	 * motors evenly spaced on a circle, clockwise seen from above, with
+	 * alternating yaw direction (the first motor turns counter-clockwise).
+	 * the coefficients are scaled so that the torques are the same as with a
+	 * quad X of the same size
+	 * @param first_motor_deg angle of motor 0 from the front, clockwise
+	 */
+	static Matrix circular(float first_motor_deg);
+
+	uint numMixes() const { return m_num_mixes; }
+	uint numRollPitchLimited() const { return m_num_roll_pitch_limited; }
+	uint numYawLimited() const { return m_num_yaw_limited; }
+	uint numThrottleLimited() const { return m_num_throttle_limited; }
+
+	void printStatus(Output& output) const {
+		output.printf("mixer: %u mixes, limited roll & pitch: %u, yaw: %u, throttle: %u\n",
+				m_num_mixes, m_num_roll_pitch_limited, m_num_yaw_limited,
+				m_num_throttle_limited);
+	}
+	void resetStatistics() {
+		m_num_mixes = m_num_roll_pitch_limited = m_num_yaw_limited =
+				m_num_throttle_limited = 0;
+	}
+private:
+	Matrix m_matrix;
+
+	uint m_num_mixes = 0;
+	uint m_num_roll_pitch_limited = 0;
+	uint m_num_yaw_limited = 0;
+	uint m_num_throttle_limited = 0;
+};
+
+/**
+ * frame geometries. motor association of the quad frames (the others are
+ * the same, with the motors clockwise from the front right (X) or front (+)):
+ *
+ *   X configuration:             + configuration:
+ *         roll, front                  front
+ *   --->    ^    <---                  |M0|
+ *   |M3|    |    |M0|                  <--->
+ *   <--- \  |  / --->                    |
+ *          \|/                     --->  |  --->
+ *  ---------*--------- pitch      |M3|---*---|M1|
+ *          /|\                     <---  |  <---
+ *   <--- /  |  \ --->                    |
+ *   |M2|    |    |M1|                  <--->
+ *   --->    ^    <---                  |M2|
+ */
+inline MotorMixer<4>::Matrix mixerQuadX() {
+	return MotorMixer<4>::Matrix{{
+		/* throttle, roll, pitch, yaw */
+		{{ 1.f, -0.5f,  0.5f,  1.f }},
+		{{ 1.f, -0.5f, -0.5f, -1.f }},
+		{{ 1.f,  0.5f, -0.5f,  1.f }},
+		{{ 1.f,  0.5f,  0.5f, -1.f }},
+	}};
+}
+inline MotorMixer<4>::Matrix mixerQuadPlus() { return MotorMixer<4>::circular(0.f); }
+inline MotorMixer<6>::Matrix mixerHexX() { return MotorMixer<6>::circular(30.f); }
+inline MotorMixer<8>::Matrix mixerOctoX() { return MotorMixer<8>::circular(22.5f); }
+
+/**
+ * run the mixer of each geometry with random inputs (also saturated ones) &
+ * print the execution time & limitations, one JSON object per geometry &
+ * line, for example:
+ *   {"benchmark":"mixer","geometry":"quad-x","motors":4,"mixes":100000,
+ *    "cycles_per_mix":40.4,"ns_per_mix":40.4,"roll_pitch_limited":0,
+ *    "yaw_limited":33475,"throttle_limited":77441,"checksum":49.688}
+ *   checksum is the sum of the first output (keeps the results alive)
+ */
+void benchmarkMixers(Output& output, uint num_mixes=100000);
+
+
+template<int N>
+inline void MotorMixer<N>::mix(float throttle, const Math::Vec3f& roll_pitch_yaw,
+		std::array<float, N>& output) {
+
+	++m_num_mixes;
+	/* roll & pitch, and roll, pitch & yaw ranges */
+	std::array<float, N> roll_pitch;
+	std::array<float, N> yaw;
+	float roll_pitch_min = 1e30f, roll_pitch_max = -1e30f;
+	float attitude_min = 1e30f, attitude_max = -1e30f;
+	for(int i=0; i<N; ++i) {
+		roll_pitch[i] = m_matrix[i][Column_roll] * roll_pitch_yaw.x
+				+ m_matrix[i][Column_pitch] * roll_pitch_yaw.y;
+		yaw[i] = m_matrix[i][Column_yaw] * roll_pitch_yaw.z;
+		float attitude = roll_pitch[i] + yaw[i];
+		roll_pitch_min = std::min(roll_pitch_min, roll_pitch[i]);
+		roll_pitch_max = std::max(roll_pitch_max, roll_pitch[i]);
+		attitude_min = std::min(attitude_min, attitude);
+		attitude_max = std::max(attitude_max, attitude);
+	}
+
+	/* the output range is 2. the range of roll_pitch + k*yaw is at most
+	 * (1-k)*range(roll_pitch) + k*range(roll_pitch+yaw) (convex in k) */
+	float roll_pitch_scale = 1.f;
+	float yaw_scale = 1.f;
+	float roll_pitch_range = roll_pitch_max - roll_pitch_min;
+	float attitude_range = attitude_max - attitude_min;
+	if(roll_pitch_range > 2.f) {
+		roll_pitch_scale = 2.f / roll_pitch_range;
+		yaw_scale = 0.f;
+		++m_num_roll_pitch_limited;
+	} else if(attitude_range > 2.f) {
+		yaw_scale = (2.f - roll_pitch_range) / (attitude_range - roll_pitch_range);
+		++m_num_yaw_limited;
+	}
+
+	float output_min = 1e30f, output_max = -1e30f;
+	for(int i=0; i<N; ++i) {
+		output[i] = m_matrix[i][Column_throttle] * throttle
+				+ roll_pitch[i] * roll_pitch_scale + yaw[i] * yaw_scale;
+		output_min = std::min(output_min, output[i]);
+		output_max = std::max(output_max, output[i]);
+	}
+
+	/* shift the throttle: the attitude range fits, so one direction is enough */
+	float shift = 0.f;
+	if(output_max > 1.f) shift = 1.f - output_max;
+	else if(output_min < -1.f) shift = -1.f - output_min;
+	if(shift != 0.f) ++m_num_throttle_limited;
+	for(int i=0; i<N; ++i) {
+		float value = output[i] + shift;
+		//rounding errors
+		output[i] = value > 1.f ? 1.f : (value < -1.f ? -1.f : value);
+	}
+}
+
+template<int N>
+typename MotorMixer<N>::Matrix MotorMixer<N>::circular(float first_motor_deg) {
+	/* quad X: sum of sin^2 over the motors is N/2, the coefficients 0.5 */
+	const float scale = 2.f * sqrtf(2.f) / N;
+	Matrix matrix;
+	for(int i=0; i<N; ++i) {
+		float angle = (first_motor_deg + 360.f * i / N) * (float)(M_PI / 180.);
+		matrix[i][Column_throttle] = 1.f;
+		matrix[i][Column_roll] = -sinf(angle) * scale; //right side: negative
+		matrix[i][Column_pitch] = cosf(angle) * scale;
+		matrix[i][Column_yaw] = (i % 2 == 0 ? 4.f : -4.f) / N;
+	}
+	return matrix;
+}
+
+#endif /* _FLIGHT_CONTROLLER_MIXER_HEADER_HPP_ */
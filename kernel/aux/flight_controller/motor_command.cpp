@@ -15,15 +15,17 @@
 #include "motor_command.hpp"
 
 CommandControlMotor::CommandControlMotor(CommandLine& command_line,
-		MotorControllerPWMBase& motor_controller)
+		MotorControllerBase& motor_controller, FuncMotorsAvailable motors_available)
 	: CommandBase("motors", 
 	  "Adjust motor speeds\n"
 	  "Keys: 'q' to quit, '1'-'4' to select motors, ' ' reset all speeds to 0\n"
 	  "'j'/'k' decrease/increase speed by 0.01, 'n'/'m' change by 0.001\n"
-	  "'u'/'i' decrease/increase PWM frequency by 25\n"
-	  "'x' set selected motor speeds to 1ms, 'c' set sel motors to min thrust",
+	  "'u'/'i' decrease/increase PWM frequency by 25 (PWM output only)\n"
+	  "'x' set selected motor speeds to 1ms (PWM output only), 'c' set sel motors to min thrust",
 	  command_line),
-	  m_motor_controller(motor_controller) {
+	  m_motor_controller(motor_controller),
+	  m_motors_available(motors_available),
+	  m_pwm(motor_controller.pwmController()) {
 
 	m_selected_motors = new bool[m_motor_controller.numMotors()];
 	for(int i=0; i<m_motor_controller.numMotors(); ++i)
@@ -36,10 +38,18 @@ CommandControlMotor::~CommandControlMotor() {
 
 
 void CommandControlMotor::startExecute(const std::vector<std::string>& arguments) {
-	refreshOutput(false);
+	if(motorsAvailable())
+		refreshOutput(false);
 }
 
 int CommandControlMotor::handleData() {
+	//checked on every call: the state can change while the command runs
+	if(!motorsAvailable()) {
+		m_command_line.inputOutput().printf("Error: the motors are driven by the "
+				"flight controller (only available in init or debug state)\n");
+		finishExecute();
+		return 0;
+	}
 	int c = m_command_line.inputOutput().readByte();
 	if(c == 'q') { //quit
 		finishExecute();
@@ -112,7 +122,13 @@ void CommandControlMotor::refreshOutput(bool clear_first) {
 	}
 	if(!had_motor) io.printf(" None (use keys '1'-'%i')", m_motor_controller.numMotors());
 	
-	int pwm_frequency = m_motor_controller.getPWMFreq();
+	if(!m_pwm) {
+		io.printf("\nDigital output (no PWM)\n");
+		for(int i=0; i<m_motor_controller.numMotors(); ++i)
+			io.printf("Motor %i speed: %.4f\n", i, m_motor_controller.getMotorSpeed(i));
+		return;
+	}
+	int pwm_frequency = m_pwm->getPWMFreq();
 
 	io.printf("\nPWM Frequency: %i Hz\n", pwm_frequency);
 
@@ -134,7 +150,8 @@ void CommandControlMotor::changeSelectedMotorsSpeed(float amount) {
 	}
 }
 void CommandControlMotor::setSelectedMotorSpeed(float pulse_ms) {
-	float pwm_frequency = m_motor_controller.getPWMFreq();
+	if(!m_pwm) return;
+	float pwm_frequency = m_pwm->getPWMFreq();
 	float val = pulse_ms * pwm_frequency / 1000.f;
 	if(val < 0.f) val = 0.f;
 	if(val > 1.f) val = 1.f;
@@ -154,8 +171,9 @@ void CommandControlMotor::setSelectedMotorSpeedMin() {
 
 
 void CommandControlMotor::changePWMFrequency(int amount) {
-	int new_freq = m_motor_controller.getPWMFreq() + amount;
+	if(!m_pwm) return;
+	int new_freq = m_pwm->getPWMFreq() + amount;
 	if(new_freq > 400) new_freq = 400;
 	if(new_freq < 50) new_freq = 50;
-	m_motor_controller.setPWMFreq(new_freq);
+	m_pwm->setPWMFreq(new_freq);
 }
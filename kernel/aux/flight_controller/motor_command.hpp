@@ -18,10 +18,20 @@
 #include <kernel/aux/command_line.hpp>
 #include "motor_controller.hpp"
 
+#include <functional>
+
+/**
+ * whether a command may drive the motors: not while the control path (timer
+ * IRQ) does, otherwise the motor controller state can be torn.
+ * an empty function means always
+ */
+typedef std::function<bool ()> FuncMotorsAvailable;
+
 class CommandControlMotor : public CommandBase {
 public:
 	CommandControlMotor(CommandLine& command_line,
-			MotorControllerPWMBase& motor_controller);
+			MotorControllerBase& motor_controller,
+			FuncMotorsAvailable motors_available = FuncMotorsAvailable());
 	
 	~CommandControlMotor();
 
@@ -35,8 +45,11 @@ private:
 	void setSelectedMotorSpeed(float pulse_ms);
 	void setSelectedMotorSpeedMin();
 	void changePWMFrequency(int amount);
+	bool motorsAvailable() const { return !m_motors_available || m_motors_available(); }
 
-	MotorControllerPWMBase& m_motor_controller;
+	MotorControllerBase& m_motor_controller;
+	FuncMotorsAvailable m_motors_available;
+	MotorControllerPWMBase* m_pwm; //NULL if not a PWM output
 	bool* m_selected_motors;
 };
 
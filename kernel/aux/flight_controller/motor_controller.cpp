@@ -20,6 +20,7 @@
 MotorControllerBase::~MotorControllerBase() {
 	delete[] m_min_thrust;
 	delete[] m_max_thrust;
+	delete[] m_output;
 }
 
 void MotorControllerBase::setMotorSpeedMin() {
@@ -29,71 +30,166 @@ void MotorControllerBase::setMotorSpeedMin() {
 }
 
 
-
 MotorControllerAdafruitPWM::MotorControllerAdafruitPWM(
 		std::array<float, 4> min_thrust, std::array<float, 4> max_thrust,
 		std::array<int, 4> channels, FuncI2CWrite func_write,
 		FuncI2CRead func_read, int addr)
-	: MotorControllerPWMBase(min_thrust, max_thrust),
-	  I2CAdafruitPWM(func_write, func_read, addr), m_channels(channels) {
-}
-
-void MotorControllerAdafruitPWM::setThrust(float throttle,
-		const Math::Vec3f& roll_pitch_yaw) {
-	
-	/* convert to X configuration */
-	const float& roll = roll_pitch_yaw.x;
-	const float& pitch = roll_pitch_yaw.y;
-	const float& yaw = roll_pitch_yaw.z;
-	std::array<float, 4> thrusts{{
-		throttle + yaw + (+pitch -roll) * 0.5f, /* motor 0 */
-		throttle - yaw + (-pitch -roll) * 0.5f, /* motor 1 */
-		throttle + yaw + (-pitch +roll) * 0.5f, /* motor 2 */
-		throttle - yaw + (+pitch +roll) * 0.5f, /* motor 3 */
-	}};
-	
-	//scale to range
-	for(int i=0; i<4; ++i)
-		thrusts[i] = m_min_thrust[i] + (thrusts[i] + 1.f) * (m_max_thrust[i]-m_min_thrust[i])/2.f;
-	
-	//check max:
-	float adjust = 0.f;
-	for(int i=0; i<4; ++i) {
-		if(thrusts[i]-adjust > m_max_thrust[i])
-			adjust = thrusts[i] - m_max_thrust[i];
-	}
-	if(adjust > 0.f) {
-		//we must not exceed the maximum, so remove thrust equally
-		for(int i=0; i<4; ++i) thrusts[i] -= adjust;
+	: MotorControllerQuadX(min_thrust, max_thrust),
+	  I2CAdafruitPWM(func_write, func_read, addr), m_channels(channels),
+	  m_first_channel(channels[0]) {
+
+	for(int i=1; i<4; ++i) {
+		if(channels[i] != channels[0]+i) m_first_channel = -1;
 	}
-	//same for min:
-	adjust = 0.f;
+	m_duty.fill(duty_invalid);
+}
+
+void MotorControllerAdafruitPWM::setMotorSpeed(int motor, float speed) {
+	m_output[motor] = speed;
+	uint16 duty = dutyTime(speed);
+	m_duty[motor] = setPWM(m_channels[motor], duty) ? duty : duty_invalid;
+}
+
+void MotorControllerAdafruitPWM::setMotorSpeeds(const std::array<float, 4>& speeds) {
+	std::array<uint16, 4> duty;
+	bool changed = false;
 	for(int i=0; i<4; ++i) {
-		if(thrusts[i]+adjust < m_min_thrust[i])
-			adjust = m_min_thrust[i] - thrusts[i];
+		m_output[i] = speeds[i];
+		duty[i] = dutyTime(speeds[i]);
+		if(duty[i] != m_duty[i]) changed = true;
 	}
-	if(adjust > 0.f) {
-		//we must not exceed the maximum, so add thrust equally
+	++m_num_updates;
+	if(!changed && ++m_num_unchanged < refresh_interval) {
+		++m_num_skipped;
+		return;
+	}
+	m_num_unchanged = 0;
+
+	bool success = true;
+	if(m_first_channel >= 0) {
+		success = setPWMMulti(m_first_channel, duty.data(), 4);
+	} else {
 		for(int i=0; i<4; ++i) {
-			thrusts[i] += adjust;
-			if(thrusts[i] > m_max_thrust[i]) {
-				//unable to satisfy both constraints...
-				printk_w("Max thrust exceeded for motor %i: %.3f, max=%.3f, t=%.3f, r=%.3f, p=%.3f, y=%.3f\n",
-						i, thrusts[i], m_max_thrust[i], throttle, roll, pitch, yaw);
-				thrusts[i] = m_max_thrust[i];
-			}
+			if(!setPWM(m_channels[i], duty[i])) success = false;
 		}
 	}
+	++m_num_writes;
+	if(success) {
+		m_duty = duty;
+	} else {
+		++m_num_errors;
+		m_duty.fill(duty_invalid);
+	}
+}
 
-	//apply
-	for(size_t i=0; i<thrusts.size(); ++i)
-		setMotorSpeed(i, thrusts[i]);
+float MotorControllerAdafruitPWM::getMotorSpeed(int motor) {
+	return (float)getPWMDuty(m_channels[motor])/4096.f;
 }
 
-void MotorControllerAdafruitPWM::setMotorSpeed(int motor, float speed) {
-	setPWM(m_channels[motor], (uint16)(speed*4096.f));
+void MotorControllerAdafruitPWM::printStatus(Output& output) {
+	output.printf("updates: %u, writes: %u (%s), unchanged skipped: %u, errors: %u\n",
+			m_num_updates, m_num_writes, m_first_channel >= 0 ?
+			"one burst each" : "one transaction per motor",
+			m_num_skipped, m_num_errors);
 }
 
-float MotorControllerAdafruitPWM::getMotorSpeed(int motor) {
-	return (float)getPWMDuty(m_channels[motor])/4096.f;
+void MotorControllerAdafruitPWM::resetStatistics() {
+	m_num_updates = m_num_writes = m_num_skipped = m_num_errors = 0;
+}
+
+
+MotorControllerESC::MotorControllerESC(const std::array<float, 4>& min_thrust,
+		const std::array<float, 4>& max_thrust, const std::array<int, 4>& gpio_pins,
+		Protocol protocol, bool synchronized)
+	: MotorControllerQuadX(min_thrust, max_thrust), m_gpio_pins(gpio_pins),
+	  m_protocol(protocol), m_synchronized(synchronized) {
+}
+
+uint32 MotorControllerESC::period() const {
+	uint32 period_ns = 1000000000 / m_frequency;
+	return m_protocol == Protocol_OneShot125 ? period_ns / 8 : period_ns;
+}
+
+bool MotorControllerESC::setPWMFreq(int freq) {
+	if(freq <= 0) return false;
+	bool initialized = m_frequency != 0;
+	m_frequency = freq;
+	if(initialized) return escOutputSetPeriod(period()) == SUCCESS;
+
+	//1000 steps between 1 & 2 ms (125 & 250 us)
+	uint32 resolution_ns = m_protocol == Protocol_OneShot125 ? 250 : 1000;
+	int ret = initESCOutput(m_gpio_pins.data(), 4, m_synchronized ?
+			ESC_MODE_SYNCHRONIZED : ESC_MODE_CONTINUOUS, period(), resolution_ns);
+	if(ret != SUCCESS) {
+		printk_e("Error: ESC output initialization failed (%i)\n", ret);
+		m_frequency = 0;
+		return false;
+	}
+	update();
+	return true;
+}
+
+void MotorControllerESC::setMotorSpeed(int motor, float speed) {
+	m_output[motor] = speed;
+	update();
+}
+
+void MotorControllerESC::setMotorSpeeds(const std::array<float, 4>& speeds) {
+	for(int i=0; i<4; ++i) m_output[i] = speeds[i];
+	update();
+}
+
+void MotorControllerESC::update() {
+	if(m_frequency == 0) return;
+	uint32 pulses[4];
+	float period_ns = (float)period();
+	for(int i=0; i<4; ++i) {
+		float pulse = m_output[i] * period_ns;
+		pulses[i] = pulse > 0.f ? (uint32)pulse : 0;
+	}
+	escOutputUpdate(pulses);
+}
+
+void MotorControllerESC::printStatus(Output& output) {
+	ESCOutputStatistics statistics;
+	escOutputGetStatistics(&statistics);
+	output.printf("%s output, %s, period %u us\n",
+			m_protocol == Protocol_OneShot125 ? "OneShot125" : "PWM",
+			m_synchronized ? "synchronized" : "continuous",
+			(uint)(escOutputPeriod()/1000));
+	output.printf("updates: %u, immediate: %u, next period: %u, replaced: %u, errors: %u\n",
+			statistics.updates, statistics.immediate, statistics.busy,
+			statistics.deferred, statistics.errors);
+}
+
+
+MotorControllerDShot::MotorControllerDShot(const std::array<float, 4>& min_thrust,
+		const std::array<float, 4>& max_thrust, const FuncOutput& output)
+	: MotorControllerBase(min_thrust, max_thrust), m_output_func(output),
+	  m_mixer(mixerQuadX()) {
+	m_frames.fill(dshotEncode(DSHOT_VALUE_STOP, false));
+}
+
+void MotorControllerDShot::setMotorSpeed(int motor, float speed) {
+	m_output[motor] = speed;
+	update();
+}
+
+void MotorControllerDShot::setMotorSpeeds(const std::array<float, 4>& speeds) {
+	for(int i=0; i<4; ++i) m_output[i] = speeds[i];
+	update();
+}
+
+void MotorControllerDShot::update() {
+	for(int i=0; i<4; ++i)
+		m_frames[i] = dshotEncode(dshotThrottleValue(m_output[i]), false);
+	++m_num_updates;
+	if(m_output_func(m_frames.data()) != SUCCESS) ++m_num_errors;
+}
+
+void MotorControllerDShot::printStatus(Output& output) {
+	output.printf("DShot updates: %u, errors: %u, frames:", m_num_updates,
+			m_num_errors);
+	for(int i=0; i<4; ++i) output.printf(" 0x%04x", m_frames[i]);
+	output.printf("\n");
 }
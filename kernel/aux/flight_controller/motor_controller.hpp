@@ -17,8 +17,17 @@
 
 #include <kernel/aux/vec3.hpp>
 #include <drivers/i2c/adafruit_pwm.hpp>
+#include <kernel/printk.h>
+#include <kernel/io.hpp>
+#include <kernel/esc.h>
+#include <kernel/dshot.h>
+
+#include "mixer.hpp"
 
 #include <array>
+#include <functional>
+
+class MotorControllerPWMBase;
 
 
 /**
@@ -56,6 +65,12 @@ public:
 	 */
 	virtual float getMotorSpeed(int motor) =0;
 
+	/**
+	 * last speed set with setMotorSpeed() (does not access the hardware)
+	 * @return speed in [0,1]
+	 */
+	float motorOutput(int motor) const { return m_output[motor]; }
+
 	/**
 	 * @param throttle assumed to be in range [-1,1]
 	 * @param roll_pitch_yaw should also be in range [-1,1]
@@ -70,9 +85,15 @@ public:
 	 * number of motors
 	 */
 	int numMotors() { return m_num_motors; }
+
+	/**
+	 * @return this if the speed is a PWM duty cycle, NULL otherwise
+	 */
+	virtual MotorControllerPWMBase* pwmController() { return NULL; }
 protected:
 	float* m_min_thrust;
 	float* m_max_thrust;
+	float* m_output; /** must be updated by setMotorSpeed() */
 	int m_num_motors;
 };
 
@@ -99,27 +120,56 @@ public:
 	virtual bool setPWMFreq(int freq) =0;
 
 	virtual int getPWMFreq() =0;
+
+	virtual MotorControllerPWMBase* pwmController() { return this; }
 private:
 };
 
 /**
- * motor controller that uses the adafruit 16 channel PWM board via I2C.
- * motor association:
- *   X configuration:
- * 
- *         roll, front
- *   --->    ^    <---
- *   |M3|    |    |M0|
- *   <--- \  |  / --->
- *          \|/
- *  ---------*--------- pitch
- *          /|\
- *   <--- /  |  \ --->
- *   |M2|    |    |M1|
- *   --->    ^    <---
+ * PWM motor controller for a quadcopter: implements the mixing (setThrust())
+ * with a MotorMixer, subclasses only need to do the output. the mixing is for
+ * the X configuration (see mixerQuadX() for the motor association), it can be
+ * changed with mixer().setMatrix() (eg. mixerQuadPlus())
  */
+class MotorControllerQuadX : public MotorControllerPWMBase {
+public:
+	MotorControllerQuadX(const std::array<float, 4>& min_thrust,
+			const std::array<float, 4>& max_thrust)
+		: MotorControllerPWMBase(min_thrust, max_thrust), m_mixer(mixerQuadX()) {}
 
-class MotorControllerAdafruitPWM : public MotorControllerPWMBase, public I2CAdafruitPWM {
+	virtual void setThrust(float throttle, const Math::Vec3f& roll_pitch_yaw) {
+		mix(*this, m_mixer, throttle, roll_pitch_yaw);
+	}
+
+	/**
+	 * set the speed of all motors at once (called by mix()). subclasses can
+	 * override this to update the outputs together
+	 */
+	virtual void setMotorSpeeds(const std::array<float, 4>& speeds) {
+		for(int i=0; i<4; ++i) setMotorSpeed(i, speeds[i]);
+	}
+
+	MotorMixer<4>& mixer() { return m_mixer; }
+
+	/**
+	 * mix & set the motor speeds of a given output type, scaled to
+	 * [minThrust(), maxThrust()]: if Output is final, setMotorSpeeds() is not
+	 * called virtually (used by the statically composed FlightController)
+	 */
+	template<class Output>
+	static inline void mix(Output& output, MotorMixer<4>& mixer, float throttle,
+			const Math::Vec3f& roll_pitch_yaw);
+private:
+	MotorMixer<4> m_mixer;
+};
+
+/**
+ * motor controller that uses the adafruit 16 channel PWM board via I2C.
+ * see mixerQuadX() for the motor association.
+ * setMotorSpeeds() writes all 4 channels in one burst if they are consecutive
+ * and skips the write if the 12bit duty times did not change.
+ */
+class MotorControllerAdafruitPWM final : public MotorControllerQuadX, public I2CAdafruitPWM {
 public:
 	/**
 	 * constructor: this will not setup & set PWM frequency
@@ -128,10 +178,8 @@ public:
 		std::array<float, 4> max_thrust, std::array<int, 4> channels,
 		FuncI2CWrite func_write, FuncI2CRead func_read, int addr=0b1000000);
 
-	virtual void setThrust(float throttle, const Math::Vec3f& roll_pitch_yaw);
-	
-	
 	virtual void setMotorSpeed(int motor, float speed);
+	virtual void setMotorSpeeds(const std::array<float, 4>& speeds);
 	virtual float getMotorSpeed(int motor);
 
 
@@ -142,8 +190,125 @@ public:
 	virtual int getPWMFreq() {
 		return I2CAdafruitPWM::getPWMFreq();
 	}
+
+	void printStatus(Output& output);
+	void resetStatistics();
 private:
+	/** 12bit duty time of a speed in [0,1] */
+	static uint16 dutyTime(float speed) {
+		return std::min((uint16)4095, (uint16)(speed*4096.f));
+	}
+
+	/** unchanged outputs are still written after this many skipped updates,
+	 * so that a lost (async) write does not persist */
+	static const uint refresh_interval = 50;
+	static const uint16 duty_invalid = 0xffff;
+
 	std::array<int, 4> m_channels; //PWM channel <--> motor association
+	int m_first_channel; //first channel if consecutive, -1 otherwise
+	std::array<uint16, 4> m_duty; //last written duty times
+
+	uint m_num_updates = 0;
+	uint m_num_writes = 0;
+	uint m_num_skipped = 0;
+	uint m_num_errors = 0;
+	uint m_num_unchanged = 0; //consecutive skipped updates
+};
+
+/**
+ * motor controller with the ESCs directly on gpio pins: the pulses are
+ * generated by the hardware (see kernel/esc.h), so an update does not need a
+ * bus transaction & all motors are updated together.
+ * as with the other PWM controllers, the speed is the duty cycle at the PWM
+ * frequency. OneShot125 is the same signal 8 times faster, so the same
+ * min/max thrust values can be used for both protocols.
+ * see mixerQuadX() for the motor association
+ */
+class MotorControllerESC final : public MotorControllerQuadX {
+public:
+	enum Protocol {
+		Protocol_PWM, /** standard 1-2 ms pulses */
+		Protocol_OneShot125 /** 125-250 us pulses */
+	};
+
+	/**
+	 * constructor: the output is set up with setPWMFreq()
+	 * @param gpio_pins pin per motor
+	 * @param synchronized start the pulses when the speed is set (aligned
+	 *        with the control loop) instead of at a fixed rate. the output
+	 *        rate without updates should then be lower than the control
+	 *        loop rate (eg. OneShot125)
+	 */
+	MotorControllerESC(const std::array<float, 4>& min_thrust,
+		const std::array<float, 4>& max_thrust, const std::array<int, 4>& gpio_pins,
+		Protocol protocol, bool synchronized);
+
+	virtual void setMotorSpeed(int motor, float speed);
+	virtual void setMotorSpeeds(const std::array<float, 4>& speeds);
+	/** last speed set (the pulses are not read back) */
+	virtual float getMotorSpeed(int motor) { return m_output[motor]; }
+
+	/**
+	 * set the PWM frequency. the first call initializes the output
+	 * @return true on success
+	 */
+	virtual bool setPWMFreq(int freq);
+	virtual int getPWMFreq() { return m_frequency; }
+
+	void printStatus(Output& output);
+	void resetStatistics() { escOutputResetStatistics(); }
+private:
+	/** output period [ns] */
+	uint32 period() const;
+	void update();
+
+	std::array<int, 4> m_gpio_pins;
+	Protocol m_protocol;
+	bool m_synchronized;
+	int m_frequency = 0;
+};
+
+/**
+ * motor controller for DShot ESCs (see kernel/dshot.h): the throttle is sent
+ * digitally with a checksum, so there is no ESC calibration. the speed is the
+ * throttle in [0,1], where 0 stops the motor. the frames of all motors are
+ * sent together by the output function (eg. escOutputUpdateDShot()).
+ * see mixerQuadX() for the motor association
+ */
+class MotorControllerDShot final : public MotorControllerBase {
+public:
+	/** send the frames of all motors, returns 0 on success */
+	typedef std::function<int(const uint16* frames)> FuncOutput;
+
+	MotorControllerDShot(const std::array<float, 4>& min_thrust,
+		const std::array<float, 4>& max_thrust, const FuncOutput& output);
+
+	virtual void setMotorSpeed(int motor, float speed);
+	void setMotorSpeeds(const std::array<float, 4>& speeds);
+	/** last speed set (the ESCs are not read back) */
+	virtual float getMotorSpeed(int motor) { return m_output[motor]; }
+
+	virtual void setThrust(float throttle, const Math::Vec3f& roll_pitch_yaw) {
+		MotorControllerQuadX::mix(*this, m_mixer, throttle, roll_pitch_yaw);
+	}
+
+	/** quad X by default, see MotorControllerQuadX */
+	MotorMixer<4>& mixer() { return m_mixer; }
+
+	/** last frame sent to a motor */
+	uint16 frame(int motor) const { return m_frames[motor]; }
+
+	void printStatus(Output& output);
+	void resetStatistics() { m_num_updates = m_num_errors = 0; }
+private:
+	void update();
+
+	FuncOutput m_output_func;
+	std::array<uint16, 4> m_frames;
+	MotorMixer<4> m_mixer;
+
+	uint m_num_updates = 0;
+	uint m_num_errors = 0;
 };
 
 template<std::size_t num_motors>
@@ -154,9 +319,11 @@ inline MotorControllerBase::MotorControllerBase(
 
 	m_min_thrust = new float[num_motors];
 	m_max_thrust = new float[num_motors];
+	m_output = new float[num_motors];
 	for(std::size_t i=0; i<num_motors; ++i) {
 		m_min_thrust[i] = min_thrust[i];
 		m_max_thrust[i] = max_thrust[i];
+		m_output[i] = 0.f;
 	}
 }
 
@@ -167,6 +334,16 @@ inline MotorControllerPWMBase::MotorControllerPWMBase(
 	: MotorControllerBase(min_thrust, max_thrust) {
 }
 
+template<class Output>
+inline void MotorControllerQuadX::mix(Output& output, MotorMixer<4>& mixer,
+		float throttle, const Math::Vec3f& roll_pitch_yaw) {
+	std::array<float, 4> thrusts;
+	mixer.mix(throttle, roll_pitch_yaw, thrusts);
+	for(int i=0; i<4; ++i)
+		thrusts[i] = output.minThrust(i) + (thrusts[i] + 1.f) * (output.maxThrust(i)-output.minThrust(i))/2.f;
+	output.setMotorSpeeds(thrusts);
+}
+
 #endif /* _FLIGHT_CONTROLLER_MOTOR_CONTROLLER_HEADER_HPP_ */
 
 
@@ -11,6 +11,7 @@
 /**
  * PID controller class.
  * FilterClass is of type Filter1D 
+ * T can also be a Fixed<> type (kernel/aux/fixed.hpp) for targets without FPU
  */
 template<typename FilterClass=Filter1D<Filter1D_EMA, 1, float>, typename T=float>
 class PID {
@@ -31,7 +32,7 @@ public:
         _imax = abs(initial_imax);
 
 		// derivative is invalid on startup
-		_last_derivative = NAN;
+		_last_derivative_valid = false;
 		
     }
 
@@ -85,6 +86,7 @@ protected:
     T           _integrator;                                ///< integrator value
     T           _last_input;                                ///< last input for derivative
     T           _last_derivative;                           ///< last derivative for low-pass filter
+    bool        _last_derivative_valid;                     ///< false after a reset (no NaN, so T can be fixed-point)
     
     FilterClass _d_filter;                                  ///< derivative lowpass filter
 };
@@ -118,12 +120,12 @@ inline T PID<FilterClass, T>::get_d(T input, T dt)
 {
     if ((_kd != 0) && (dt != 0)) {
         T derivative;
-		if (std::isnan(_last_derivative)) {
+		if (!_last_derivative_valid) {
 			// we've just done a reset, suppress the first derivative
 			// term as we don't want a sudden change in input to cause
 			// a large D output change			
 			derivative = 0;
-			_last_derivative = 0;
+			_last_derivative_valid = true;
 		} else {
 			// calculate instantaneous derivative
 			derivative = (input - _last_input) / dt;
@@ -161,7 +163,7 @@ inline void PID<FilterClass, T>::reset_I()
 {
     _integrator = 0;
 	// mark derivative as invalid
-    _last_derivative = NAN;
+    _last_derivative_valid = false;
 }
 
 
@@ -17,11 +17,18 @@
 
 #include <kernel/utils.h>
 #include <kernel/math.h>
+#include <kernel/timer.h>
+#include <kernel/io.hpp>
 #include <kernel/aux/vec3.hpp>
+#include <kernel/interrupt.h>
+#include <kernel/gpio.h>
 
 #include <drivers/i2c/bmp180_barometer.hpp>
 #include <drivers/i2c/hmc5883l_compass.hpp>
 #include <drivers/i2c/mpu-6050_accel_gyro.hpp>
+#include <drivers/spi/mpu-6000_accel_gyro.hpp>
+
+#include <algorithm>
 
 // acceleration due to gravity in m/s/s
 #define GRAVITY_MSS 9.80665f
@@ -55,6 +62,22 @@ public:
 	/** get the minimum delay between two getMeasurement calls in microseconds */
 	virtual uint minMeasurementDelayMicro() { return 0; }
 	
+	/**
+	 * sensors with a FIFO: time when the sample of the last getMeasurement()
+	 * was taken. others return false: the readout time is used instead
+	 */
+	virtual bool getSampleTimestamp(Timestamp& timestamp) { return false; }
+	
+	/** sensors with a FIFO: number of samples that can be read without waiting */
+	virtual uint numQueuedSamples() { return 0; }
+	
+	/**
+	 * number of invalid measurements (getMeasurement() returned false).
+	 * getMeasurement() is called in the control path & must not print: the
+	 * foreground reports this instead
+	 */
+	virtual uint numInvalidMeasurements() { return 0; }
+	
 	int minMeasurementDelayMilli() { return minMeasurementDelayMicro()/1000; }
 protected:
 };
@@ -63,7 +86,7 @@ protected:
 /* wrappers for different sensors */
 
 template<typename T=float>
-class SensorBMP180Baro : public SensorBase<T>, public I2CBMP085 {
+class SensorBMP180Baro final : public SensorBase<T>, public I2CBMP085 {
 public:
 	void initialize();
 	
@@ -73,28 +96,167 @@ public:
 };
 
 template<typename T=float>
-class SensorHMC5883LCompass : public SensorBase<T>, public I2CHMC5883L {
+class SensorHMC5883LCompass final : public SensorBase<T>, public I2CHMC5883L {
 public:
 	void initialize();
 
 	//direction of north pole
 	virtual bool getMeasurement(Math::Vec3<T>& val);
 	virtual uint minMeasurementDelayMicro();
+	/** overflows (gain too high?) */
+	virtual uint numInvalidMeasurements() { return m_num_invalid; }
+private:
+	uint m_num_invalid = 0;
 };
 
 
-template<bool use_accel, typename T=float>
-class SensorMPU6050GyroAccel : public SensorBase<T> {
+/**
+ * shared sample of an MPU-6050 (or SPI MPU-6000, see Device): accel, temperature & gyro are read with a
+ * single burst & then served to both SensorMPU6050GyroAccel wrappers, so the
+ * two readings are from the same instant & the bus is accessed only once.
+ * a new burst is read when a wrapper asks again for a sample it already got.
+ * 
+ * FIFO mode: the device buffers the accel & gyro samples, and a burst reads
+ * all of them (up to max_batch). so no sample is lost when the control loop
+ * is late: the wrappers return them one after the other (see
+ * SensorBase::numQueuedSamples()). the sample times are reconstructed from
+ * the sample period. if the FIFO overflows, it is reset (counted).
+ * 
+ * data-ready IRQ: if the INT pin of the device is connected to a GPIO, a new
+ * sample is only read when the device signaled one, so the same sample is
+ * never read twice. the IRQ timestamp is used as sample time (in FIFO mode
+ * it anchors the reconstructed sample times). samples that were overwritten
+ * before they were read are counted (direct mode).
+ *
+ * Device: I2CMPU6050 or SPIMPU6000 (same sampling interface)
+ */
+template<class Device>
+class MPUSampler {
+public:
+	typedef typename Device::Motion Motion;
+
+	enum Consumer {
+		Consumer_Accel = 0,
+		Consumer_Gyro,
+		
+		Consumer_Count
+	};
+	
+	static constexpr int max_batch = Device::fifo_max_burst;
+
+	MPUSampler(Device& sensor);
+
+	Device& sensor() { return m_sensor; }
+	
+	/**
+	 * enable/disable FIFO mode
+	 * @param sample_period [us], must match the sample rate of the device
+	 */
+	void setFIFOMode(bool enabled, uint sample_period=1000);
+	bool fifoMode() const { return m_fifo_mode; }
+	/** [us] (0 in direct mode) */
+	uint samplePeriod() const { return m_sample_period; }
+	
+	/**
+	 * configure the device to pulse the INT pin for every new sample & use the
+	 * GPIO IRQ of that pin (rising edge) to detect new samples.
+	 * @param gpio_pin pin connected to INT or -1 to disable
+	 */
+	void setDataReadyPin(int gpio_pin);
+	/** true if sampleTimestamp() returns the time when the sample was taken */
+	bool hasSampleTimestamps() const { return m_fifo_mode || m_data_ready_pin != -1; }
+
+	/** @return the next sample for a consumer or NULL if none (or read error) */
+	inline const Motion* get(Consumer consumer);
+	
+	/** time when the sample last returned to consumer was taken */
+	Timestamp sampleTimestamp(Consumer consumer) const {
+		return m_timestamp + (m_index[consumer]-1) * m_sample_period;
+	}
+	/** number of samples that a consumer can get without waiting */
+	uint numQueued(Consumer consumer) const {
+		return m_num_samples - m_index[consumer] + m_device_queued;
+	}
+
+	/** temperature of the last sample [deg C] (not updated in FIFO mode) */
+	float temperature() const { return (float)m_temperature / 340.f + 36.53f; }
+	
+	void printStatus(Output& output);
+	void resetStatistics();
+private:
+	/** read the next sample(s). @return true if there is at least one */
+	bool read(Consumer consumer);
+	
+	/**
+	 * check the data-ready IRQ of the device
+	 * @param timestamp set to the time of the newest IRQ
+	 * @return number of new samples signaled since the last call
+	 */
+	uint dataReadyEvents(Timestamp& timestamp);
+	
+	Device& m_sensor;
+	Motion m_samples[max_batch];
+	int m_num_samples = 0;
+	int m_index[Consumer_Count]; /** next sample for each consumer */
+	Timestamp m_timestamp = 0; /** time of m_samples[0] */
+	int16_t m_temperature = 0;
+	
+	bool m_fifo_mode = false;
+	uint m_sample_period = 0; /** [us] (0 in direct mode) */
+	uint m_device_queued = 0; /** samples left in the device after the last read */
+	bool m_next_timestamp_valid = false;
+	Timestamp m_next_timestamp; /** expected time of the next sample in the FIFO */
+	
+	int m_data_ready_pin = -1;
+	uint m_data_ready_count = 0; /** IRQ events at the last dataReadyEvents() */
+	
+	/* statistics */
+	uint m_num_reads = 0; /** burst reads */
+	uint m_num_samples_read = 0;
+	uint m_num_errors = 0;
+	uint m_num_overflows = 0;
+	uint m_max_fifo_samples = 0;
+	uint m_num_data_ready = 0; /** data-ready IRQ events */
+	uint m_num_missed = 0; /** samples overwritten before they were read */
+	uint m_num_duplicates = 0; /** gyro polls without a new sample (not read) */
+};
+
+typedef MPUSampler<I2CMPU6050> MPU6050Sampler;
+typedef MPUSampler<SPIMPU6000> MPU6000Sampler;
+
+/** accel or gyro of an MPU-6050 (or of an SPI MPU-6000 with
+ *  Device=SPIMPU6000, see SensorMPU6000GyroAccel) */
+template<bool use_accel, typename T=float, class Device=I2CMPU6050>
+class SensorMPU6050GyroAccel final : public SensorBase<T> {
 public:
-	SensorMPU6050GyroAccel(I2CMPU6050& sensor);
+	typedef MPUSampler<Device> Sampler;
+
+	SensorMPU6050GyroAccel(Sampler& sampler);
 
 	//either acceleration in [m/s^2] or gyroscope in [rad/s]
 	virtual bool getMeasurement(Math::Vec3<T>& val);
 	virtual uint minMeasurementDelayMicro();
+	
+	virtual bool getSampleTimestamp(Timestamp& timestamp) {
+		if(!m_sampler.hasSampleTimestamps()) return false;
+		timestamp = m_sampler.sampleTimestamp(consumer);
+		return true;
+	}
+	virtual uint numQueuedSamples() { return m_sampler.numQueued(consumer); }
+	
+	/** read the full scale range from the device & update the scaling. call
+	 * this if the range was changed (eg. by the DMP initialization) */
+	void updateScale();
 private:
-	I2CMPU6050& m_sensor;
+	static constexpr typename Sampler::Consumer consumer = use_accel ?
+			Sampler::Consumer_Accel : Sampler::Consumer_Gyro;
+	Sampler& m_sampler;
+	T m_scale;
 };
 
+template<bool use_accel, typename T=float>
+using SensorMPU6000GyroAccel = SensorMPU6050GyroAccel<use_accel, T, SPIMPU6000>;
+
 
 template<typename T>
 void SensorBMP180Baro<T>::initialize() {
@@ -133,7 +295,7 @@ inline bool SensorHMC5883LCompass<T>::getMeasurement(Math::Vec3<T>& val) {
 	int16_t mx, my, mz;
 	getHeading(&mx, &my, &mz);
 	if(mx == -4096 || my == -4096 || mz == -4096) {
-		printk_w("Warning: Compass got invalid/overflow measurement -> gain too high?\n");
+		++m_num_invalid;
 		return false;
 	}
 	
@@ -149,45 +311,237 @@ inline uint SensorHMC5883LCompass<T>::minMeasurementDelayMicro() {
 	return 13334/2; //75 Hz (times 2 because the reading can be out of sync)
 }
 
-template<bool use_accel, typename T>
-inline SensorMPU6050GyroAccel<use_accel, T>::SensorMPU6050GyroAccel(I2CMPU6050& sensor)
-	: m_sensor(sensor) {
+template<class Device>
+MPUSampler<Device>::MPUSampler(Device& sensor) : m_sensor(sensor) {
+	for(int i=0; i<Consumer_Count; ++i) m_index[i] = 0;
+}
+
+template<class Device>
+void MPUSampler<Device>::setFIFOMode(bool enabled, uint sample_period) {
+	m_fifo_mode = enabled;
+	m_sample_period = enabled ? sample_period : 0;
+	m_sensor.setMotionFIFO(enabled);
+	m_num_samples = 0;
+	m_device_queued = 0;
+	m_next_timestamp_valid = false;
+	for(int i=0; i<Consumer_Count; ++i) m_index[i] = 0;
+}
+
+template<class Device>
+void MPUSampler<Device>::setDataReadyPin(int gpio_pin) {
+	m_sensor.setIntDataReadyEnabled(gpio_pin != -1);
+	if(gpio_pin == -1) {
+		if(m_data_ready_pin != -1)
+			setGpioEdgeDetect(m_data_ready_pin, 0);
+		m_data_ready_pin = -1;
+		return;
+	}
+	m_sensor.setInterruptMode(false); //active high
+	m_sensor.setInterruptDrive(false); //push-pull
+	m_sensor.setInterruptLatch(false); //50us pulse
+	setGpioPullUpDown(gpio_pin, 1); //pull-down
+	setGpioFunction(gpio_pin, 0); //input
+	setGpioEdgeDetect(gpio_pin, GPIO_RISING_EDGE);
+	m_data_ready_pin = gpio_pin;
+	Timestamp timestamp;
+	dataReadyEvents(timestamp); //ignore old events
+	enableGpioIRQ();
+}
+
+template<class Device>
+uint MPUSampler<Device>::dataReadyEvents(Timestamp& timestamp) {
+	/* only rising edges are detected, but the pulse is short: the IRQ handler
+	 * can already see the pin low & count the event as low */
+	const int pin = m_data_ready_pin;
+	/* the gpio IRQ can preempt this even with disabled interrupts (FIQ): read
+	 * again if an edge came in between */
+	uint count;
+	Timestamp high, low;
+	do {
+		count = g_irq_gpio_high_counter[pin] + g_irq_gpio_low_counter[pin];
+		high = g_irq_gpio_high_last_timestamp[pin];
+		low = g_irq_gpio_low_last_timestamp[pin];
+	} while(count != g_irq_gpio_high_counter[pin] + g_irq_gpio_low_counter[pin]);
+	timestamp = time_after(high, low) ? high : low;
+	uint events = count - m_data_ready_count;
+	m_data_ready_count = count;
+	m_num_data_ready += events;
+	return events;
+}
+
+template<class Device>
+bool MPUSampler<Device>::read(Consumer consumer) {
+	Timestamp data_ready_timestamp = 0;
+	if(m_data_ready_pin != -1) {
+		uint events = dataReadyEvents(data_ready_timestamp);
+		if(events == 0 && m_device_queued == 0) {
+			//no new sample: do not access the bus
+			if(consumer == Consumer_Gyro) ++m_num_duplicates;
+			return false;
+		}
+		if(!m_fifo_mode && events > 1)
+			m_num_missed += events - 1;
+	}
+	if(!m_fifo_mode) {
+		Motion& motion = m_samples[0];
+		if(!m_sensor.getMotion(motion)) {
+			++m_num_errors;
+			return false;
+		}
+		m_timestamp = m_data_ready_pin != -1 ? data_ready_timestamp : getTimestamp();
+		m_temperature = motion.temperature;
+		m_num_samples = 1;
+	} else {
+		int count = m_sensor.readFIFOCount();
+		Timestamp now = getTimestamp();
+		if(count < 0) {
+			++m_num_errors;
+			return false;
+		}
+		if(count >= Device::fifo_size || count % Device::fifo_sample_size != 0) {
+			/* the device overwrote the oldest data, so we lost the alignment
+			 * of the samples */
+			++m_num_overflows;
+			m_sensor.resetFIFO();
+			m_device_queued = 0;
+			m_next_timestamp_valid = false;
+			return false;
+		}
+		uint available = count / Device::fifo_sample_size;
+		if(available > m_max_fifo_samples) m_max_fifo_samples = available;
+		if(available == 0) {
+			m_device_queued = 0;
+			return false;
+		}
+		int num = std::min((int)available, max_batch);
+		if(m_sensor.readFIFOMotion(m_samples, num) != num) {
+			++m_num_errors;
+			m_sensor.resetFIFO(); //we do not know how much was read
+			m_device_queued = 0;
+			m_next_timestamp_valid = false;
+			return false;
+		}
+		
+		/* sample times: the newest sample was taken within the last period.
+		 * with the data-ready IRQ it is on the grid of the IRQ timestamps.
+		 * follow the sample period & slowly correct the clock drift */
+		Timestamp newest;
+		if(m_data_ready_pin != -1 && m_sample_period > 0
+				&& time_after_eq(now, data_ready_timestamp)) {
+			newest = data_ready_timestamp + (now - data_ready_timestamp)
+				/ m_sample_period * m_sample_period;
+		} else {
+			newest = now - m_sample_period / 2;
+		}
+		Timestamp first_estimate = newest - (available-1) * m_sample_period;
+		if(!m_next_timestamp_valid) {
+			m_next_timestamp = first_estimate;
+			m_next_timestamp_valid = true;
+		} else {
+			m_next_timestamp += (int)(first_estimate - m_next_timestamp) / 16;
+		}
+		m_timestamp = m_next_timestamp;
+		m_next_timestamp += num * m_sample_period;
+		m_device_queued = available - num;
+		m_num_samples = num;
+	}
+	++m_num_reads;
+	m_num_samples_read += m_num_samples;
+	for(int i=0; i<Consumer_Count; ++i) m_index[i] = 0;
+	return true;
+}
 
+template<class Device>
+void MPUSampler<Device>::printStatus(Output& output) {
+	output.printf("%s %s mode", Device::deviceName(), m_fifo_mode ? "FIFO" : "direct");
+	if(m_fifo_mode) output.printf(" (sample period %u us)", m_sample_period);
+	output.printf(", temperature %.1f C\n", temperature());
+	output.printf("burst reads: %u, samples: %u (%.2f per read), errors: %u\n",
+			m_num_reads, m_num_samples_read,
+			m_num_reads ? (float)m_num_samples_read / m_num_reads : 0.f, m_num_errors);
+	if(m_fifo_mode) {
+		output.printf("FIFO overflows: %u, max fill: %u samples\n",
+				m_num_overflows, m_max_fifo_samples);
+	}
+	if(m_data_ready_pin != -1) {
+		output.printf("data-ready IRQ (GPIO %i): %u samples", m_data_ready_pin,
+				m_num_data_ready);
+		if(!m_fifo_mode) output.printf(", %u missed", m_num_missed);
+		output.printf(", %u duplicate polls skipped\n", m_num_duplicates);
+	}
+}
+
+template<class Device>
+void MPUSampler<Device>::resetStatistics() {
+	m_num_reads = 0;
+	m_num_samples_read = 0;
+	m_num_errors = 0;
+	m_num_overflows = 0;
+	m_max_fifo_samples = 0;
+	m_num_data_ready = 0;
+	m_num_missed = 0;
+	m_num_duplicates = 0;
+}
+
+template<class Device>
+inline const typename MPUSampler<Device>::Motion* MPUSampler<Device>::get(Consumer consumer) {
+	if(m_index[consumer] >= m_num_samples && !read(consumer))
+		return NULL;
+	return &m_samples[m_index[consumer]++];
+}
+
+template<bool use_accel, typename T, class Device>
+inline SensorMPU6050GyroAccel<use_accel, T, Device>::SensorMPU6050GyroAccel(Sampler& sampler)
+	: m_sampler(sampler) {
+
+	Device& sensor = m_sampler.sensor();
 	delay(5); //make sure device was woken up
 	if(use_accel) {
-		m_sensor.setFullScaleAccelRange(MPU6050_ACCEL_FS_8); //8g -> affects scaling below!
+		sensor.setFullScaleAccelRange(MPU6050_ACCEL_FS_8); //8g
 	} else {
-		m_sensor.setDLPFMode(2); //lowpass filter
-		m_sensor.setRate(0); //0=1kHz, 1=500Hz, 2=333Hz, ...
+		sensor.setDLPFMode(2); //lowpass filter
+		sensor.setRate(0); //0=1kHz, 1=500Hz, 2=333Hz, ...
 			//when changing rate, also change minMeasurementDelayMicro
-		m_sensor.setFullScaleGyroRange(MPU6050_GYRO_FS_2000); //2000deg/s -> affects scaling below!
+		sensor.setFullScaleGyroRange(MPU6050_GYRO_FS_2000); //2000deg/s
 	}
+	updateScale();
 }
 
-template<bool use_accel, typename T>
-inline bool SensorMPU6050GyroAccel<use_accel, T>::getMeasurement(Math::Vec3<T>& val) {
+template<bool use_accel, typename T, class Device>
+void SensorMPU6050GyroAccel<use_accel, T, Device>::updateScale() {
+	Device& sensor = m_sampler.sensor();
 	if(use_accel) {
-		int16_t ax, ay, az;
-		m_sensor.getAcceleration(&ax, &ay, &az);
-		const T accel_scale = (GRAVITY_MSS / 4096.0f); //4096 LSB/g for +-8g
-		val.x = (T)ay * accel_scale;
-		val.y = (T)ax * accel_scale;
-		val.z = (T)-az * accel_scale;
+		//16384 LSB/g for +-2g, 8192 for +-4g, ...
+		uint8_t range = sensor.getFullScaleAccelRange() & 3;
+		m_scale = (T)(GRAVITY_MSS / (float)(16384 >> range));
 	} else {
-		int16_t gx, gy, gz;
-		m_sensor.getRotation(&gx, &gy, &gz);
 		//convert to rad/s
-		const T gyro_scale = (T)(M_PI/180. / 16.4); //16.4 LSB/deg/s +-2000deg/s
-		val.x = (T)gy * gyro_scale;
-		val.y = (T)gx * gyro_scale;
-		val.z = (T)-gz * gyro_scale;
+		static const float lsb_per_deg_s[4] = { 131.f, 65.5f, 32.8f, 16.4f };
+		uint8_t range = sensor.getFullScaleGyroRange() & 3;
+		m_scale = (T)(M_PI/180. / lsb_per_deg_s[range]);
+	}
+}
+
+template<bool use_accel, typename T, class Device>
+inline bool SensorMPU6050GyroAccel<use_accel, T, Device>::getMeasurement(Math::Vec3<T>& val) {
+	const typename Sampler::Motion* motion = m_sampler.get(consumer);
+	if(!motion) return false;
+	if(use_accel) {
+		val.x = (T)motion->accel[1] * m_scale;
+		val.y = (T)motion->accel[0] * m_scale;
+		val.z = (T)-motion->accel[2] * m_scale;
+	} else {
+		val.x = (T)motion->gyro[1] * m_scale;
+		val.y = (T)motion->gyro[0] * m_scale;
+		val.z = (T)-motion->gyro[2] * m_scale;
 	}
 	return true;
 }
 
-template<bool use_accel, typename T>
-inline uint SensorMPU6050GyroAccel<use_accel, T>::minMeasurementDelayMicro() {
-	return 1000; //1 kHz
+template<bool use_accel, typename T, class Device>
+inline uint SensorMPU6050GyroAccel<use_accel, T, Device>::minMeasurementDelayMicro() {
+	//1 kHz, unless the sample rate was changed for the FIFO mode
+	return m_sampler.fifoMode() ? m_sampler.samplePeriod() : 1000;
 }
 
 #endif /* _FLIGHT_CONTROLLER_SENSOR_HEADER_HPP_ */
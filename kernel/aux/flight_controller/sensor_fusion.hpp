@@ -16,6 +16,7 @@
 #define _FLIGHT_CONTROLLER_SENSOR_FUSION_HEADER_HPP_
 
 #include <kernel/aux/vec3.hpp>
+#include <kernel/aux/fixed.hpp>
 #include <kernel/utils.h>
 
 /**
@@ -24,6 +25,7 @@
  */
 class SensorFusionBase {
 public:
+	virtual ~SensorFusionBase() {}
 	
 	/**
 	 * update attitude from new sensor values.
@@ -57,6 +59,10 @@ protected:
 	 * calculate x^(-1/2)
 	 */
 	static inline float invSqrt(float x);
+	template<int frac_bits>
+	static inline Fixed<frac_bits> invSqrt(Fixed<frac_bits> x) {
+		return Fixed<frac_bits>(1) / sqrt(x);
+	}
 	
 	bool m_fast_convergence = false;
 };
@@ -99,8 +105,12 @@ float SensorFusionBase::invSqrt(float x) {
 
 /**
  * sensor fusion class based on Mahony's AHRS quaternion algorithm
+ * @param T type for the calculations: float or Fixed20 for targets without
+ *          FPU (only the interface & the conversion to euler angles use float
+ *          then). with Fixed20 the input values must be within +-2000
  */
-class SensorFusionMahonyAHRS : public SensorFusionBase {
+template<typename T=float>
+class SensorFusionMahonyAHRS final : public SensorFusionBase {
 public:
 	/**
 	 * @param Kp p coefficient for PI controller
@@ -111,14 +121,16 @@ public:
 	virtual void update(const Math::Vec3f& gyro, const Math::Vec3f& accel,
 			const Math::Vec3f& mag, float dt, Math::Vec3f& attitude);
 private:
-	inline void MahonyAHRSupdate(float gx, float gy, float gz,
-			float ax, float ay, float az, float mx, float my, float mz, float dt);
-	inline void MahonyAHRSupdateIMU(float gx, float gy, float gz,
-			float ax, float ay, float az, float dt);
-
-	float m_twoKp, m_twoKi;
-	float q0 = 1.0f, q1 = 0.0f, q2 = 0.0f, q3 = 0.0f;					// quaternion of sensor frame relative to auxiliary frame
-	float integralFBx = 0.0f,  integralFBy = 0.0f, integralFBz = 0.0f;	// integral error terms scaled by Ki
+	inline void MahonyAHRSupdate(T gx, T gy, T gz,
+			T ax, T ay, T az, T mx, T my, T mz, T dt);
+	inline void MahonyAHRSupdateIMU(T gx, T gy, T gz,
+			T ax, T ay, T az, T dt);
+	/** returns false (and does not normalize) for a zero vector */
+	static inline bool normalize(T& x, T& y, T& z);
+
+	T m_twoKp, m_twoKi;
+	T q0 = 1.0f, q1 = 0.0f, q2 = 0.0f, q3 = 0.0f;					// quaternion of sensor frame relative to auxiliary frame
+	T integralFBx = 0.0f,  integralFBy = 0.0f, integralFBz = 0.0f;	// integral error terms (not scaled by Ki)
 };
 
 
@@ -128,7 +140,7 @@ private:
  * TODO: take into account m_fast_convergence
  * FIXME: this method seems not to work AT ALL (-> wrong coordinate system input?)
  */
-class SensorFusionMadgwickAHRS : public SensorFusionBase {
+class SensorFusionMadgwickAHRS final : public SensorFusionBase {
 public:
 	SensorFusionMadgwickAHRS(float beta=0.1f);
 
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "sensor_fusion_dmp.hpp"
+#include <kernel/errors.h>
+#include <kernel/utils.h>
+#include <kernel/printk.h>
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Math;
+
+SensorFusionMPU6050DMP::SensorFusionMPU6050DMP(I2CMPU6050& sensor, float compass_gain)
+	: m_sensor(sensor), m_compass_gain(compass_gain) {
+}
+
+int SensorFusionMPU6050DMP::initialize() {
+	uint8_t ret = m_sensor.dmpInitialize();
+	if(ret != 0) {
+		printk_e("Error: MPU-6050 DMP initialization failed (%i)\n", (int)ret);
+		return -E_IO;
+	}
+	m_sensor.setDMPEnabled(true);
+	m_initialized = true;
+	return SUCCESS;
+}
+
+bool SensorFusionMPU6050DMP::readPackets() {
+	int count = m_sensor.readFIFOCount();
+	if(count < 0) {
+		++m_num_errors;
+		return false;
+	}
+	if(count >= I2CMPU6050::fifo_size) {
+		//overflow: the FIFO content is not aligned to packets anymore
+		m_sensor.resetFIFO();
+		++m_num_overflows;
+		return false;
+	}
+	//the FIFO must be read in order: read bursts of multiple packets & only
+	//use the newest
+	static constexpr int max_burst = 255 / packet_size;
+	uint8_t buffer[max_burst * packet_size];
+	int num_packets = count / packet_size;
+	int num_read = 0;
+	while(num_read < num_packets) {
+		int num = std::min(num_packets - num_read, max_burst);
+		if(m_sensor.readFIFO(buffer, num * packet_size) < 0) {
+			++m_num_errors;
+			return false;
+		}
+		num_read += num;
+	}
+	m_num_packets += num_packets;
+	if(num_packets > (int)m_max_packets_per_update)
+		m_max_packets_per_update = num_packets;
+	if(num_packets == 0) return false;
+
+	const uint8_t* packet = buffer + (num_packets - 1) % max_burst * packet_size;
+	float q_chip[4];
+	for(int i=0; i<4; ++i)
+		q_chip[i] = (float)(int16_t)((packet[4*i] << 8) | packet[4*i+1]) / 16384.f;
+	//chip to FC axes (same as the sensor classes): x=y_chip, y=x_chip, z=-z_chip.
+	//this is a proper rotation, so the quaternion can be converted directly
+	m_q[0] = q_chip[0];
+	m_q[1] = q_chip[2];
+	m_q[2] = q_chip[1];
+	m_q[3] = -q_chip[3];
+	return true;
+}
+
+void SensorFusionMPU6050DMP::update(const Math::Vec3f& gyro, const Math::Vec3f& accel,
+		const Math::Vec3f& mag, float dt, Math::Vec3f& attitude) {
+	++m_num_updates;
+	if(m_initialized && readPackets()) {
+		const float w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+		m_attitude.x = atan2f(2.f*(w*x + y*z), 1.f - 2.f*(x*x + y*y));
+		m_attitude.y = asinf(std::max(-1.f, std::min(1.f, 2.f*(w*y - z*x))));
+		m_attitude.z = atan2f(2.f*(w*z + x*y), 1.f - 2.f*(y*y + z*z));
+	} else {
+		++m_num_stale_updates;
+	}
+
+	float yaw = m_attitude.z;
+	if(m_compass_gain > 0.f && !(mag.x == 0.f && mag.y == 0.f && mag.z == 0.f)) {
+		//tilt-compensated heading
+		const float sr = sinf(m_attitude.x), cr = cosf(m_attitude.x);
+		const float sp = sinf(m_attitude.y), cp = cosf(m_attitude.y);
+		const float my = mag.y*cr - mag.z*sr;
+		const float mz = mag.y*sr + mag.z*cr;
+		const float hx = mag.x*cp + mz*sp;
+		const float heading = atan2f(-my, hx);
+
+		float error = heading - (yaw + m_yaw_offset);
+		while(error > (float)M_PI) error -= 2.f*(float)M_PI;
+		while(error < -(float)M_PI) error += 2.f*(float)M_PI;
+		if(!m_yaw_offset_valid || m_fast_convergence) {
+			m_yaw_offset += error;
+			m_yaw_offset_valid = true;
+		} else {
+			m_yaw_offset += m_compass_gain * error;
+		}
+		if(m_yaw_offset > (float)M_PI) m_yaw_offset -= 2.f*(float)M_PI;
+		else if(m_yaw_offset < -(float)M_PI) m_yaw_offset += 2.f*(float)M_PI;
+	}
+	yaw += m_yaw_offset;
+	if(yaw > (float)M_PI) yaw -= 2.f*(float)M_PI;
+	else if(yaw < -(float)M_PI) yaw += 2.f*(float)M_PI;
+
+	attitude.x = m_attitude.x;
+	attitude.y = m_attitude.y;
+	attitude.z = yaw;
+}
+
+void SensorFusionMPU6050DMP::printStatus(Output& output) {
+	output.printf("MPU-6050 DMP %s, %u Hz, compass gain %.4f, yaw offset %.2f deg\n",
+			m_initialized ? "running" : "not initialized", rate_hz,
+			m_compass_gain, m_yaw_offset * (float)(180./M_PI));
+	output.printf("updates: %u (%u without new packet), packets: %u (max %u per update)\n",
+			m_num_updates, m_num_stale_updates, m_num_packets, m_max_packets_per_update);
+	output.printf("FIFO overflows: %u, errors: %u\n", m_num_overflows, m_num_errors);
+}
+
+void SensorFusionMPU6050DMP::resetStatistics() {
+	m_num_updates = 0;
+	m_num_packets = 0;
+	m_num_stale_updates = 0;
+	m_num_overflows = 0;
+	m_num_errors = 0;
+	m_max_packets_per_update = 0;
+}
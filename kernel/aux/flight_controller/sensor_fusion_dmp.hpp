@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _FLIGHT_CONTROLLER_SENSOR_FUSION_DMP_HEADER_HPP_
+#define _FLIGHT_CONTROLLER_SENSOR_FUSION_DMP_HEADER_HPP_
+
+#include "sensor_fusion.hpp"
+
+#include <kernel/types.h>
+#include <kernel/io.hpp>
+#include <drivers/i2c/mpu-6050_accel_gyro.hpp>
+
+/**
+ * sensor fusion on the Digital Motion Processor (DMP) of the MPU-6050, with
+ * the MotionApps 2.0 firmware: the DMP fuses gyro & accel at 200 Hz and writes
+ * a quaternion packet to the FIFO. update() only reads the newest packet, the
+ * gyro & accel arguments are not used.
+ *
+ * The DMP quaternion is 6 axis, so the yaw drifts. If mag is valid, the yaw is
+ * slowly corrected towards the tilt-compensated compass heading.
+ *
+ * The DMP uses the FIFO, so the MPU6050Sampler must be in direct mode.
+ * initialize() resets the device: the I2C bypass mode (for the compass) must
+ * be enabled again afterwards & the accel range changes to +-2g.
+ */
+class SensorFusionMPU6050DMP final : public SensorFusionBase {
+public:
+	/**
+	 * @param compass_gain yaw correction factor per update, in [0, 1]. 0 disables it
+	 */
+	SensorFusionMPU6050DMP(I2CMPU6050& sensor, float compass_gain=0.005f);
+
+	/**
+	 * load the firmware & start the DMP. this takes a while.
+	 * @return 0 on success, <0 on error
+	 */
+	int initialize();
+
+	virtual void update(const Math::Vec3f& gyro, const Math::Vec3f& accel,
+			const Math::Vec3f& mag, float dt, Math::Vec3f& attitude);
+
+	void printStatus(Output& output);
+	void resetStatistics();
+
+	static constexpr int packet_size = 42; /** [bytes] */
+	static constexpr uint rate_hz = 200;
+private:
+	/**
+	 * read all packets from the FIFO & keep the newest
+	 * @return true if there was a new packet
+	 */
+	bool readPackets();
+
+	I2CMPU6050& m_sensor;
+	float m_compass_gain;
+	bool m_initialized = false;
+
+	float m_q[4] = { 1.f, 0.f, 0.f, 0.f }; /** newest quaternion, FC frame */
+	Math::Vec3f m_attitude = Math::Vec3f(0.f, 0.f, 0.f); /** from m_q, without yaw correction */
+	float m_yaw_offset = 0.f;
+	bool m_yaw_offset_valid = false;
+
+	/* statistics */
+	uint m_num_updates = 0;
+	uint m_num_packets = 0;
+	uint m_num_stale_updates = 0; /** updates without a new packet */
+	uint m_num_overflows = 0;
+	uint m_num_errors = 0;
+	uint m_max_packets_per_update = 0;
+};
+
+#endif /* _FLIGHT_CONTROLLER_SENSOR_FUSION_DMP_HEADER_HPP_ */
@@ -16,44 +16,66 @@
 #include <kernel/utils.h>
 
 #include <cmath>
+#include <algorithm>
 
 #define FAST_CONVERGENCE_FACTOR 200.f
 
 
+template<typename T>
+inline bool SensorFusionMahonyAHRS<T>::normalize(T& x, T& y, T& z) {
+	if(!std::is_floating_point<T>::value) {
+		//fixed-point: scale into [0.5, 4] first, so that the squares can
+		//neither overflow nor round to 0
+		T m = std::max(fabs(x), std::max(fabs(y), fabs(z)));
+		if(m == T(0)) return false;
+		while(m > T(4)) {
+			x *= T(0.125f);
+			y *= T(0.125f);
+			z *= T(0.125f);
+			m *= T(0.125f);
+		}
+		while(m < T(0.5f)) {
+			x *= T(8);
+			y *= T(8);
+			z *= T(8);
+			m *= T(8);
+		}
+	}
+	T norm_sq = x * x + y * y + z * z;
+	if(norm_sq == T(0)) return false;
+	T recipNorm = invSqrt(norm_sq);
+	x *= recipNorm;
+	y *= recipNorm;
+	z *= recipNorm;
+	return true;
+}
+
+
 /* algorithm by Seb Magdwick */
-void SensorFusionMahonyAHRS::MahonyAHRSupdate(float gx, float gy, float gz,
-		float ax, float ay, float az, float mx, float my, float mz, float dt) {
-	float recipNorm;
-    float q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;  
-	float hx, hy, bx, bz;
-	float halfvx, halfvy, halfvz, halfwx, halfwy, halfwz;
-	float halfex, halfey, halfez;
-	float qa, qb, qc;
-	float twoKp = m_twoKp;
-	float twoKi = m_twoKi;
+template<typename T>
+void SensorFusionMahonyAHRS<T>::MahonyAHRSupdate(T gx, T gy, T gz,
+		T ax, T ay, T az, T mx, T my, T mz, T dt) {
+	T recipNorm;
+    T q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;  
+	T hx, hy, bx, bz;
+	T halfvx, halfvy, halfvz, halfwx, halfwy, halfwz;
+	T halfex, halfey, halfez;
+	T qa, qb, qc;
+	T twoKp = m_twoKp;
+	T twoKi = m_twoKi;
 	if(m_fast_convergence) twoKp *= FAST_CONVERGENCE_FACTOR;
 
 	// Use IMU algorithm if magnetometer measurement invalid (avoids NaN in magnetometer normalisation)
-	if((mx == 0.0f) && (my == 0.0f) && (mz == 0.0f)) {
+	if(((mx == 0.0f) && (my == 0.0f) && (mz == 0.0f)) || !normalize(mx, my, mz)) {
 		MahonyAHRSupdateIMU(gx, gy, gz, ax, ay, az, dt);
 		return;
 	}
 	dt /= 1000.f;
 
 	// Compute feedback only if accelerometer measurement valid (avoids NaN in accelerometer normalisation)
-	if(!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))) {
-
-		// Normalise accelerometer measurement
-		recipNorm = invSqrt(ax * ax + ay * ay + az * az);
-		ax *= recipNorm;
-		ay *= recipNorm;
-		az *= recipNorm;     
-
-		// Normalise magnetometer measurement
-		recipNorm = invSqrt(mx * mx + my * my + mz * mz);
-		mx *= recipNorm;
-		my *= recipNorm;
-		mz *= recipNorm;   
+	// (the magnetometer measurement is normalised above)
+	if(!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))
+			&& normalize(ax, ay, az)) { // Normalise accelerometer measurement
 
         // Auxiliary variables to avoid repeated arithmetic
         q0q0 = q0 * q0;
@@ -88,12 +110,12 @@ void SensorFusionMahonyAHRS::MahonyAHRSupdate(float gx, float gy, float gz,
 
 		// Compute and apply integral feedback if enabled
 		if(twoKi > 0.0f) {
-			integralFBx += twoKi * halfex * dt;	// integral error scaled by Ki
-			integralFBy += twoKi * halfey * dt;
-			integralFBz += twoKi * halfez * dt;
-			gx += integralFBx;	// apply integral feedback
-			gy += integralFBy;
-			gz += integralFBz;
+			integralFBx += halfex * dt;	// integral error (Ki is applied below)
+			integralFBy += halfey * dt;
+			integralFBz += halfez * dt;
+			gx += twoKi * integralFBx;	// apply integral feedback
+			gy += twoKi * integralFBy;
+			gz += twoKi * integralFBz;
 		}
 		else {
 			integralFBx = 0.0f;	// prevent integral windup
@@ -128,25 +150,21 @@ void SensorFusionMahonyAHRS::MahonyAHRSupdate(float gx, float gy, float gz,
 }
 
 
-void SensorFusionMahonyAHRS::MahonyAHRSupdateIMU(float gx, float gy, float gz,
-		float ax, float ay, float az, float dt) {
-	float recipNorm;
-	float halfvx, halfvy, halfvz;
-	float halfex, halfey, halfez;
-	float qa, qb, qc;
-	float twoKi = m_twoKi;
-	float twoKp = m_twoKp;
+template<typename T>
+void SensorFusionMahonyAHRS<T>::MahonyAHRSupdateIMU(T gx, T gy, T gz,
+		T ax, T ay, T az, T dt) {
+	T recipNorm;
+	T halfvx, halfvy, halfvz;
+	T halfex, halfey, halfez;
+	T qa, qb, qc;
+	T twoKi = m_twoKi;
+	T twoKp = m_twoKp;
 	if(m_fast_convergence) twoKp *= FAST_CONVERGENCE_FACTOR;
 	dt /= 1000.f;
 
 	// Compute feedback only if accelerometer measurement valid (avoids NaN in accelerometer normalisation)
-	if(!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))) {
-
-		// Normalise accelerometer measurement
-		recipNorm = invSqrt(ax * ax + ay * ay + az * az);
-		ax *= recipNorm;
-		ay *= recipNorm;
-		az *= recipNorm;        
+	if(!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))
+			&& normalize(ax, ay, az)) { // Normalise accelerometer measurement
 
 		// Estimated direction of gravity and vector perpendicular to magnetic flux
 		halfvx = q1 * q3 - q0 * q2;
@@ -160,12 +178,12 @@ void SensorFusionMahonyAHRS::MahonyAHRSupdateIMU(float gx, float gy, float gz,
 
 		// Compute and apply integral feedback if enabled
 		if(twoKi > 0.0f) {
-			integralFBx += twoKi * halfex * dt;	// integral error scaled by Ki
-			integralFBy += twoKi * halfey * dt;
-			integralFBz += twoKi * halfez * dt;
-			gx += integralFBx;	// apply integral feedback
-			gy += integralFBy;
-			gz += integralFBz;
+			integralFBx += halfex * dt;	// integral error (Ki is applied below)
+			integralFBy += halfey * dt;
+			integralFBz += halfez * dt;
+			gx += twoKi * integralFBx;	// apply integral feedback
+			gy += twoKi * integralFBy;
+			gz += twoKi * integralFBz;
 		}
 		else {
 			integralFBx = 0.0f;	// prevent integral windup
@@ -199,15 +217,22 @@ void SensorFusionMahonyAHRS::MahonyAHRSupdateIMU(float gx, float gy, float gz,
 	q3 *= recipNorm;
 }
 
-SensorFusionMahonyAHRS::SensorFusionMahonyAHRS(float Kp, float Ki)
+template<typename T>
+SensorFusionMahonyAHRS<T>::SensorFusionMahonyAHRS(float Kp, float Ki)
 	: m_twoKp(2.f*Kp), m_twoKi(2.f*Ki) {
 }
 
-void SensorFusionMahonyAHRS::update(const Math::Vec3f& gyro,
+template<typename T>
+void SensorFusionMahonyAHRS<T>::update(const Math::Vec3f& gyro,
 		const Math::Vec3f& accel, const Math::Vec3f& mag, float dt,
 		Math::Vec3f& attitude) {
-	MahonyAHRSupdate(gyro.x, -gyro.y, -gyro.z, accel.x, -accel.y, -accel.z,
-			mag.x, -mag.y, -mag.z, dt);
-	quaternionToRollPitchYaw(q0, q1, q2, q3, attitude.x, attitude.y, attitude.z);
+	MahonyAHRSupdate(T(gyro.x), -T(gyro.y), -T(gyro.z),
+			T(accel.x), -T(accel.y), -T(accel.z),
+			T(mag.x), -T(mag.y), -T(mag.z), T(dt));
+	quaternionToRollPitchYaw((float)q0, (float)q1, (float)q2, (float)q3,
+			attitude.x, attitude.y, attitude.z);
 }
 
+template class SensorFusionMahonyAHRS<float>;
+template class SensorFusionMahonyAHRS<Fixed20>;
+
@@ -23,7 +23,8 @@ using namespace Math;
 CommandStabilize::CommandStabilize(CommandLine& command_line,
 		FlightControllerConfig& config, const Math::Vec3f& attitude,
 		Math::Vec3f& dest_roll_pitch_yaw,
-		const Math::Vec3f& pid_roll_pitch_yaw_output, float* throttle_input)
+		const Math::Vec3f& pid_roll_pitch_yaw_output, float* throttle_input,
+		FuncMotorsAvailable motors_available)
 	: CommandBase("stabilize",
 			"Test stabilization\n"
 			  "Keys: 'q' to quit, '1'-'3' pitch, roll, yaw stabilization,\n"
@@ -35,7 +36,7 @@ CommandStabilize::CommandStabilize(CommandLine& command_line,
 	  m_config(config), m_attitude(attitude),
 	  m_dest_roll_pitch_yaw(dest_roll_pitch_yaw),
 	  m_pid_roll_pitch_yaw_output(pid_roll_pitch_yaw_output),
-	  m_throttle_remote(throttle_input) {
+	  m_throttle_remote(throttle_input), m_motors_available(motors_available) {
 }
 
 CommandStabilize::~CommandStabilize() {
@@ -46,10 +47,18 @@ void CommandStabilize::startExecute(const std::vector<std::string>& arguments) {
 	m_use_throttle_remote = false;
 	m_next_update = getTimestamp() + update_delay_ms*1000;
 	m_last_printed_line_count = 0;
-	refreshOutput();
+	if(!m_motors_available || m_motors_available())
+		refreshOutput();
 }
 
 int CommandStabilize::handleData() {
+	//checked on every call: the state can change while the command runs
+	if(m_motors_available && !m_motors_available()) {
+		m_command_line.inputOutput().printf("Error: the motors are driven by the "
+				"flight controller (only available in init or debug state)\n");
+		finishExecute();
+		return 0;
+	}
 	int c = m_command_line.inputOutput().readByte();
 	if(c == 'q') { //quit
 		m_config.motor_controller->setMotorSpeedMin();
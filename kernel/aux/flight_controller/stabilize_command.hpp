@@ -18,6 +18,7 @@
 #include <kernel/aux/command_line.hpp>
 #include <kernel/aux/vec3.hpp>
 #include "flight_controller.hpp"
+#include "motor_command.hpp"
 
 /**
  * command to test stabilization
@@ -29,7 +30,8 @@ public:
 			const Math::Vec3f& attitude,
 			Math::Vec3f& dest_roll_pitch_yaw,
 			const Math::Vec3f& pid_roll_pitch_yaw_output,
-			float* throttle_input=NULL);
+			float* throttle_input=NULL,
+			FuncMotorsAvailable motors_available = FuncMotorsAvailable());
 	
 	~CommandStabilize();
 
@@ -49,6 +51,7 @@ private:
 	bool m_stabilize_yaw = false;
 	float m_throttle = -1.f;
 	float* m_throttle_remote; //throttle input from remote
+	FuncMotorsAvailable m_motors_available;
 	bool m_use_throttle_remote = false;
 	Timestamp m_next_update;
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "profiler.hpp"
+#include <kernel/interrupt.h>
+
+using namespace std;
+
+Profiler::Profiler() {
+	m_statistics_start = getTimestamp();
+}
+
+int Profiler::addStage(const std::string& name) {
+	Stage stage;
+	stage.name = name;
+	resetStage(stage);
+	m_stages.push_back(stage);
+	return (int)m_stages.size()-1;
+}
+
+void Profiler::stage(int stage, Stage& copy) const {
+	disableInterrupts();
+	copy = m_stages[stage];
+	enableInterrupts();
+	if(copy.reset) resetStage(copy);
+}
+
+void Profiler::resetStatistics() {
+	for(auto& stage : m_stages)
+		stage.reset = true;
+	m_statistics_start = getTimestamp();
+}
+
+/**
+ * print a duration in us with 2 decimals, right-aligned to width. printf
+ * ignores the field width of floats, so it is printed as integers
+ */
+static void printMicros(Output& output, uint64_t cycles, uint32 frequency, int width) {
+	uint64_t hundredths = (cycles * 100000000 + frequency/2) / frequency;
+	uint32 us = (uint32)(hundredths / 100);
+	int len = 4; //1 digit & 3 for the decimals
+	for(uint32 v = us; v >= 10; v /= 10) ++len;
+	for(; len < width; ++len) output.writeByte(' ');
+	output.printf("%u.%02u", us, (uint32)(hundredths % 100));
+}
+
+void Profiler::printStatistics(Output& output, bool print_histograms) const {
+	const size_t name_length = 10;
+	const uint32 frequency = getCycleCounterFrequency();
+
+	output.printf("Statistics over the last %u ms, cycle counter at %u MHz\n",
+			(getTimestamp() - m_statistics_start) / 1000,
+			frequency / 1000000);
+	output.printf("stage         count   min[us]  mean[us]   max[us]   p99[us]\n");
+	Stage s;
+	for(int i=0; i<numStages(); ++i) {
+		stage(i, s);
+		output.writeString(s.name);
+		for(size_t k=s.name.length(); k<name_length; ++k)
+			output.writeByte(' ');
+		if(s.count == 0) {
+			output.printf(" %8u         -         -         -         -\n", 0);
+			continue;
+		}
+
+		/* p99: upper bound of the bucket that contains the 99th percentile */
+		uint p99_count = s.count - s.count / 100;
+		uint cumulative = 0;
+		int p99_bucket = 0;
+		while(p99_bucket < num_buckets-1 &&
+				(cumulative += s.histogram[p99_bucket]) < p99_count)
+			++p99_bucket;
+		uint32 p99 = p99_bucket >= 31 ? 0xffffffff : (2u << p99_bucket) - 1;
+		if(p99 > s.max) p99 = s.max;
+
+		output.printf(" %8u", s.count);
+		const uint64_t columns[4] = { s.min, s.total / s.count, s.max, p99 };
+		for(int k=0; k<4; ++k) {
+			output.writeByte(' ');
+			printMicros(output, columns[k], frequency, 9);
+		}
+		output.writeByte('\n');
+	}
+
+	if(!print_histograms) return;
+
+	const int bar_length = 40;
+	for(int i=0; i<numStages(); ++i) {
+		stage(i, s);
+		if(s.count == 0) continue;
+		output.printf("\nhistogram of %s (bucket lower bound [us], count)\n",
+				s.name.c_str());
+		uint max_count = 0;
+		for(int k=0; k<num_buckets; ++k)
+			if(s.histogram[k] > max_count) max_count = s.histogram[k];
+		for(int k=bucket(s.min); k<=bucket(s.max); ++k) {
+			output.writeByte(' ');
+			printMicros(output, k == 0 ? 0 : 1u << k, frequency, 10);
+			output.printf(" %8u ", s.histogram[k]);
+			int len = (int)((uint64_t)s.histogram[k] * bar_length / max_count);
+			if(len == 0 && s.histogram[k] > 0) len = 1;
+			for(int j=0; j<len; ++j) output.writeByte('#');
+			output.writeByte('\n');
+		}
+	}
+}
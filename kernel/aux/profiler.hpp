@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _PROFILER_HEADER_HPP_
+#define _PROFILER_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/timer.h>
+#include <kernel/io.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * execution time profiler for a fixed set of stages. durations are measured
+ * with the CPU cycle counter (or the 1MHz timer if the arch has none) and
+ * collected in log2 histograms, so recording is cheap and needs no memory.
+ *
+ * each stage must only be recorded from one context (either IRQ or main loop),
+ * different stages can be recorded from different contexts.
+ *
+ * usage:
+ *   int stage = profiler.addStage("fusion");
+ *   profiler.measure(stage, [&]() { fusion.update(...); });
+ */
+class Profiler {
+public:
+	/** bucket i contains durations in [2^i, 2^(i+1)) cycles (0 is in bucket 0) */
+	static constexpr int num_buckets = 32;
+
+	struct Stage {
+		std::string name;
+		uint count;
+		uint32 min; /** [cycles] */
+		uint32 max; /** [cycles] */
+		uint64_t total; /** [cycles] */
+		uint histogram[num_buckets];
+		volatile bool reset; /** reset requested (done at the next record) */
+	};
+
+	/** records the time between construction & destruction */
+	class Scope {
+	public:
+		Scope(Profiler& profiler, int stage)
+			: m_profiler(profiler), m_stage(stage), m_start(getCycleCount()) {}
+		~Scope() { m_profiler.record(m_stage, getCycleCount() - m_start); }
+	private:
+		Profiler& m_profiler;
+		int m_stage;
+		uint32 m_start;
+	};
+
+	Profiler();
+
+	/**
+	 * add a stage. must be called before measurements are recorded.
+	 * @return stage index
+	 */
+	int addStage(const std::string& name);
+
+	/**
+	 * call func & record its execution time
+	 * @return the return value of func
+	 */
+	template<typename Func>
+	inline auto measure(int stage, Func func) -> decltype(func()) {
+		Scope scope(*this, stage);
+		return func();
+	}
+
+	/** record a duration in cycles */
+	inline void record(int stage, uint32 cycles);
+
+	int numStages() const { return (int)m_stages.size(); }
+
+	/** get a consistent copy of a stage */
+	void stage(int stage, Stage& copy) const;
+
+	void resetStatistics();
+
+	/**
+	 * print min/mean/max/p99 of all stages, and optionally the histograms.
+	 * the p99 value is the upper bound of the histogram bucket.
+	 */
+	void printStatistics(Output& output, bool print_histograms=false) const;
+
+private:
+	static inline int bucket(uint32 cycles) {
+		return cycles == 0 ? 0 : 31 - __builtin_clz(cycles);
+	}
+	static inline void resetStage(Stage& stage);
+
+	std::vector<Stage> m_stages;
+	Timestamp m_statistics_start;
+};
+
+
+void Profiler::record(int stage, uint32 cycles) {
+	Stage& s = m_stages[stage];
+	if(s.reset) resetStage(s);
+	if(cycles < s.min) s.min = cycles;
+	if(cycles > s.max) s.max = cycles;
+	s.total += cycles;
+	++s.histogram[bucket(cycles)];
+	++s.count;
+}
+
+void Profiler::resetStage(Stage& stage) {
+	stage.count = 0;
+	stage.min = 0xffffffff;
+	stage.max = 0;
+	stage.total = 0;
+	for(int i=0; i<num_buckets; ++i) stage.histogram[i] = 0;
+	stage.reset = false;
+}
+
+#endif /* _PROFILER_HEADER_HPP_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "rate_scheduler.hpp"
+#include <kernel/utils.h>
+
+using namespace std;
+
+RateScheduler::RateScheduler() {
+	m_statistics_start = getTimestamp();
+}
+
+int RateScheduler::addRateGroup(const std::string& name, uint period_us,
+		FuncTask task, uint deadline_us) {
+	ASSERT(period_us > 0);
+	RateGroup group;
+	group.name = name;
+	group.task = task;
+	group.next_release = getTimestamp();
+	m_groups.push_back(group);
+	int idx = (int)m_groups.size()-1;
+	setPeriod(idx, period_us, deadline_us);
+	return idx;
+}
+
+void RateScheduler::addBackgroundTask(FuncTask task) {
+	m_background_tasks.push_back(task);
+}
+
+void RateScheduler::setPeriod(int group, uint period_us, uint deadline_us) {
+	RateGroup& g = m_groups[group];
+	g.period = period_us;
+	g.deadline = deadline_us == 0 ? period_us : deadline_us;
+}
+
+void RateScheduler::start() {
+	Timestamp now = getTimestamp();
+	for(auto& group : m_groups)
+		group.next_release = now;
+	resetStatistics();
+}
+
+bool RateScheduler::update() {
+	Timestamp now = getTimestamp();
+	for(auto& group : m_groups) {
+		if(time_after_eq(now, group.next_release)) {
+			runGroup(group, now);
+			//start over, so that higher priority groups are checked first
+			return true;
+		}
+	}
+
+	/* slack: run a background task */
+	if(m_background_tasks.empty()) return false;
+	m_background_tasks[m_next_background_task]();
+	if(++m_next_background_task >= m_background_tasks.size())
+		m_next_background_task = 0;
+	++m_num_background_runs;
+	return false;
+}
+
+void RateScheduler::runDueGroups(uint tolerance_us) {
+	for(auto& group : m_groups) {
+		Timestamp now = getTimestamp();
+		if(time_after_eq(now + tolerance_us, group.next_release)) {
+			runGroup(group, now);
+		}
+	}
+}
+
+Timestamp RateScheduler::nextRelease() const {
+	Timestamp next = m_groups[0].next_release;
+	for(const auto& group : m_groups) {
+		if(time_before(group.next_release, next))
+			next = group.next_release;
+	}
+	return next;
+}
+
+void RateScheduler::runGroup(RateGroup& group, Timestamp now) {
+	Timestamp release = group.next_release;
+	uint latency = time_after(now, release) ? now - release : 0; //can be early with a tolerance
+	if(latency > group.max_latency) group.max_latency = latency;
+
+	group.task();
+
+	Timestamp end = getTimestamp();
+	uint exec_time = end - now;
+	if(exec_time > group.max_exec_time) group.max_exec_time = exec_time;
+	group.total_exec_time += exec_time;
+	++group.num_runs;
+	if(time_after(end, release + group.deadline))
+		++group.num_overruns;
+
+	/* next release: keep the phase. if we are behind by more than one period,
+	 * drop the missed releases instead of running the group back-to-back */
+	release += group.period;
+	if(time_after_eq(end, release + group.period)) {
+		uint missed = (end - release) / group.period;
+		group.num_skipped += missed;
+		release += missed * group.period;
+	}
+	group.next_release = release;
+}
+
+void RateScheduler::resetStatistics() {
+	for(auto& group : m_groups) {
+		group.num_runs = 0;
+		group.num_overruns = 0;
+		group.num_skipped = 0;
+		group.max_latency = 0;
+		group.max_exec_time = 0;
+		group.total_exec_time = 0;
+	}
+	m_num_background_runs = 0;
+	m_statistics_start = getTimestamp();
+}
+
+void RateScheduler::printStatistics(Output& output) {
+	const size_t name_length = 10;
+	uint elapsed_ms = (getTimestamp() - m_statistics_start) / 1000;
+	if(elapsed_ms == 0) elapsed_ms = 1;
+
+	output.printf("Statistics over the last %u ms\n", elapsed_ms);
+	output.printf("group      rate[Hz] runs     overruns skipped  "
+			"max lat[us]  avg/max exec[us] load[%%]\n");
+	for(auto& group : m_groups) {
+		output.writeString(group.name);
+		for(size_t i=group.name.length(); i<name_length; ++i)
+			output.writeByte(' ');
+		uint avg_exec = group.num_runs ? (uint)(group.total_exec_time / group.num_runs) : 0;
+		uint load = (uint)(group.total_exec_time / 10 / elapsed_ms); //in %
+		output.printf(" %8u %8u %8u %8u %11u %8u/%8u %3u\n",
+				1000000 / group.period, group.num_runs, group.num_overruns,
+				group.num_skipped, group.max_latency, avg_exec,
+				group.max_exec_time, load);
+	}
+	output.printf("background runs: %u\n", m_num_background_runs);
+}
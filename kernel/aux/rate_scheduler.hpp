@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _RATE_SCHEDULER_HEADER_HPP_
+#define _RATE_SCHEDULER_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/timer.h>
+#include <kernel/io.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * cooperative fixed-rate scheduler with multiple rate groups (based on
+ * polling).
+ *
+ * each rate group has a fixed period and a (relative) deadline. groups are
+ * strictly prioritized in the order they are added: the first added group has
+ * the highest priority. release times are computed as multiples of the period,
+ * so there is no drift, even if a single run is delayed.
+ *
+ * background tasks are best-effort: they are only called when no rate group
+ * is due, so they only consume slack. Note that the scheduler is not
+ * preemptive: a background task that takes long still delays the rate groups
+ * (this is visible in the latency & overrun statistics). To avoid that, the
+ * groups can be run from a timer IRQ with runDueGroups() (see TimerTick).
+ */
+class RateScheduler {
+public:
+	typedef std::function<void ()> FuncTask;
+
+	struct RateGroup {
+		std::string name;
+		uint period; /** [us] */
+		uint deadline; /** relative to release time [us] */
+		FuncTask task;
+		Timestamp next_release;
+
+		/* statistics */
+		uint num_runs;
+		uint num_overruns; /** finished after the deadline */
+		uint num_skipped; /** releases dropped because we were behind */
+		uint max_latency; /** max delay from release to start [us] */
+		uint max_exec_time; /** [us] */
+		uint64_t total_exec_time; /** [us] */
+	};
+
+	RateScheduler();
+
+	/**
+	 * add a rate group. must be called before update() is called the first time.
+	 * @param name name for statistics output
+	 * @param period_us period in microseconds (>0)
+	 * @param task function to call once per period
+	 * @param deadline_us deadline relative to the release time. 0 means same
+	 *                    as the period
+	 * @return group index
+	 */
+	int addRateGroup(const std::string& name, uint period_us, FuncTask task,
+			uint deadline_us=0);
+
+	/**
+	 * add a best-effort background task. they are called in a round-robin
+	 * manner, one per scheduling pass.
+	 */
+	void addBackgroundTask(FuncTask task);
+
+	/**
+	 * (re)start all rate groups: first release is now
+	 */
+	void start();
+
+	/**
+	 * one scheduling pass: run the highest priority group that is due, or if
+	 * none is due a single background task. call this from the main loop.
+	 * @return true if a rate group was run
+	 */
+	bool update();
+
+	/**
+	 * run all groups that are due, in priority order (no background tasks).
+	 * this is meant to be called from a periodic tick (eg. timer IRQ): the
+	 * group periods should then be multiples of the tick period.
+	 * @param tolerance_us a group is considered due if its release is at most
+	 *                     this far in the future (to compensate tick jitter)
+	 */
+	void runDueGroups(uint tolerance_us=0);
+
+	/**
+	 * earliest release of all groups: until then there is only slack.
+	 * there must be at least one group
+	 */
+	Timestamp nextRelease() const;
+
+	/**
+	 * change the period of a group. the next release is not changed.
+	 */
+	void setPeriod(int group, uint period_us, uint deadline_us=0);
+
+	int numGroups() const { return (int)m_groups.size(); }
+	const RateGroup& group(int group) const { return m_groups[group]; }
+
+	/** number of background task calls */
+	uint numBackgroundRuns() const { return m_num_background_runs; }
+
+	void resetStatistics();
+
+	/** print statistics of all groups (since last reset) */
+	void printStatistics(Output& output);
+
+private:
+	inline void runGroup(RateGroup& group, Timestamp now);
+
+	std::vector<RateGroup> m_groups;
+	std::vector<FuncTask> m_background_tasks;
+	size_t m_next_background_task = 0;
+	uint m_num_background_runs = 0;
+	Timestamp m_statistics_start;
+};
+
+#endif /* _RATE_SCHEDULER_HEADER_HPP_ */
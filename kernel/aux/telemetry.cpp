@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "telemetry.hpp"
+#include <kernel/crc.h>
+#include <kernel/interrupt.h>
+#include <kernel/utils.h>
+
+using namespace std;
+
+enum TelemetryPacketType {
+	TelemetryPacketType_Schema = 0,
+	TelemetryPacketType_Data = 1,
+};
+
+Telemetry::Telemetry(FuncWrite output, size_t buffer_size)
+	: m_output(output), m_buffer_size(buffer_size) {
+	m_buffer = new uint8[buffer_size];
+}
+
+Telemetry::~Telemetry() {
+	delete[] m_buffer;
+}
+
+int Telemetry::addTopic(const std::string& name, uint rate_hz) {
+	ASSERT(m_topics.size() < 256);
+	Topic topic;
+	topic.name = name;
+	topic.rate_hz = rate_hz;
+	topic.next_update = getTimestamp();
+	topic.num_components = 0;
+	topic.schema_size = 1 + 1 + 2 + name.length() + 1 + 1;
+	ASSERT(topic.schema_size <= max_payload_size);
+	topic.num_sent = 0;
+	topic.num_dropped = 0;
+	m_topics.push_back(topic);
+	return (int)m_topics.size()-1;
+}
+
+void Telemetry::addValue(int topic, const std::string& name, const float& value) {
+	Value v;
+	v.name = name;
+	v.components.push_back(&value);
+	m_topics[topic].values.push_back(v);
+	m_topics[topic].num_components += 1;
+	m_topics[topic].schema_size += name.length() + 1 + 1;
+	ASSERT(1 + 1 + 4 + m_topics[topic].num_components * 4 <= max_payload_size);
+	ASSERT(m_topics[topic].schema_size <= max_payload_size);
+}
+
+void Telemetry::addValue(int topic, const std::string& name,
+		const Math::Vec3<float>& value) {
+	Value v;
+	v.name = name;
+	v.components.push_back(&value.x);
+	v.components.push_back(&value.y);
+	v.components.push_back(&value.z);
+	m_topics[topic].values.push_back(v);
+	m_topics[topic].num_components += 3;
+	m_topics[topic].schema_size += name.length() + 1 + 1;
+	ASSERT(1 + 1 + 4 + m_topics[topic].num_components * 4 <= max_payload_size);
+	ASSERT(m_topics[topic].schema_size <= max_payload_size);
+}
+
+int Telemetry::findTopic(const std::string& name) const {
+	for(size_t i=0; i<m_topics.size(); ++i) {
+		if(m_topics[i].name == name) return (int)i;
+	}
+	return -E_NO_SUCH_RESOURCE;
+}
+
+void Telemetry::setRate(int topic, uint rate_hz) {
+	m_topics[topic].rate_hz = rate_hz;
+	m_topics[topic].next_update = getTimestamp();
+	m_next_schema = getTimestamp(); //announce the change
+}
+
+void Telemetry::start() {
+	Timestamp now = getTimestamp();
+	for(auto& topic : m_topics) {
+		topic.next_update = now;
+		topic.num_sent = 0;
+		topic.num_dropped = 0;
+	}
+	m_next_schema = now;
+	m_num_bytes = 0;
+	m_running = true;
+}
+
+void Telemetry::update() {
+	if(m_running) {
+		Timestamp now = getTimestamp();
+		if(time_after_eq(now, m_next_schema)) {
+			sendSchema();
+			m_next_schema = now + 1000*1000;
+		}
+		for(size_t i=0; i<m_topics.size(); ++i) {
+			Topic& topic = m_topics[i];
+			if(topic.rate_hz == 0 || !time_after_eq(now, topic.next_update))
+				continue;
+			sendData(i, now);
+			uint period = 1000000 / topic.rate_hz;
+			topic.next_update += period;
+			//do not try to catch up if we are behind
+			if(time_after(now, topic.next_update)) topic.next_update = now + period;
+		}
+	}
+	flush();
+}
+
+void Telemetry::sendData(int topic_idx, Timestamp now) {
+	Topic& topic = m_topics[topic_idx];
+	uint8 payload[max_payload_size];
+	size_t len = 0;
+	payload[len++] = TelemetryPacketType_Data;
+	payload[len++] = (uint8)topic_idx;
+	for(int k=0; k<4; ++k)
+		payload[len++] = (uint8)(now >> (k*8));
+
+	/* values can be written from IRQ context: get a consistent snapshot */
+	disableInterrupts();
+	for(const auto& value : topic.values) {
+		for(const float* component : value.components) {
+			memcpy(payload + len, component, sizeof(float));
+			len += sizeof(float);
+		}
+	}
+	enableInterrupts();
+
+	if(queuePacket(payload, len)) ++topic.num_sent;
+	else ++topic.num_dropped;
+}
+
+void Telemetry::sendSchema() {
+	uint8 payload[max_payload_size];
+	for(size_t i=0; i<m_topics.size(); ++i) {
+		const Topic& topic = m_topics[i];
+		size_t len = 0;
+		//the sizes are checked in addTopic & addValue, but never write past
+		//the payload: strings are truncated, leaving space for the zero & a
+		//count byte
+		auto add_string = [&payload, &len](const std::string& str) {
+			for(size_t k=0; k<str.length() && len + 2 < max_payload_size; ++k)
+				payload[len++] = str[k];
+			payload[len++] = 0;
+		};
+		payload[len++] = TelemetryPacketType_Schema;
+		payload[len++] = (uint8)i;
+		payload[len++] = (uint8)(topic.rate_hz & 0xff);
+		payload[len++] = (uint8)(topic.rate_hz >> 8);
+		add_string(topic.name);
+		size_t num_values_pos = len++;
+		uint8 num_values = 0;
+		for(const auto& value : topic.values) {
+			if(len + value.name.length() + 2 > max_payload_size || num_values == 0xff)
+				break;
+			add_string(value.name);
+			payload[len++] = (uint8)value.components.size();
+			++num_values;
+		}
+		payload[num_values_pos] = num_values; //only the values that fit
+		queuePacket(payload, len);
+	}
+}
+
+bool Telemetry::queuePacket(const uint8* payload, size_t length) {
+	uint16 crc = crc16(CRC16_INIT, payload, length);
+	uint8 crc_bytes[2] = { (uint8)(crc & 0xff), (uint8)(crc >> 8) };
+
+	/* COBS encode: each zero is replaced by the offset to the next zero. the
+	 * worst-case overhead is 1 byte per 254 bytes */
+	uint8 encoded[max_payload_size + 2 + (max_payload_size + 2) / 254 + 2];
+	size_t code_pos = 0, out = 1;
+	uint8 code = 1;
+	for(size_t i=0; i<length+2; ++i) {
+		uint8 byte = i < length ? payload[i] : crc_bytes[i-length];
+		if(byte == 0) {
+			encoded[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+		} else {
+			encoded[out++] = byte;
+			if(++code == 0xff) {
+				encoded[code_pos] = code;
+				code_pos = out++;
+				code = 1;
+			}
+		}
+	}
+	encoded[code_pos] = code;
+	encoded[out++] = 0; //delimiter
+
+	if(bufferUsed() + out >= m_buffer_size) return false;
+	for(size_t i=0; i<out; ++i) {
+		m_buffer[m_write_pos] = encoded[i];
+		if(++m_write_pos == m_buffer_size) m_write_pos = 0;
+	}
+	return true;
+}
+
+void Telemetry::flush() {
+	while(m_read_pos != m_write_pos) {
+		if(m_output(m_buffer[m_read_pos]) < 0) return;
+		if(++m_read_pos == m_buffer_size) m_read_pos = 0;
+		++m_num_bytes;
+	}
+}
+
+void Telemetry::printStatus(Output& output) {
+	output.printf("telemetry %s, %u bytes sent, %u bytes queued\n",
+			m_running ? "running" : "stopped", m_num_bytes, (uint)bufferUsed());
+	output.printf("id rate[Hz]     sent  dropped topic: values\n");
+	for(size_t i=0; i<m_topics.size(); ++i) {
+		const Topic& topic = m_topics[i];
+		output.printf("%2u %8u %8u %8u %s:", (uint)i, topic.rate_hz,
+				topic.num_sent, topic.num_dropped, topic.name.c_str());
+		for(const auto& value : topic.values)
+			output.printf(" %s", value.name.c_str());
+		output.writeByte('\n');
+	}
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _TELEMETRY_HEADER_HPP_
+#define _TELEMETRY_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/timer.h>
+#include <kernel/io.hpp>
+#include <kernel/aux/vec3.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+ * binary telemetry: periodically send float values as packets. this is a
+ * lot cheaper than printing them as text (CommandWatchValues), both in CPU
+ * time & bandwidth.
+ *
+ * values are grouped into topics, each topic has its own rate. sending is
+ * non-blocking: packets are queued in a ring buffer and written out with each
+ * update() as long as the output accepts data. if the buffer is full, packets
+ * are dropped (counted per topic).
+ *
+ * packet format (all values little endian):
+ *   packet = COBS(payload crc:u16) 0x00
+ *   the CRC-16/CCITT covers the payload. payload types:
+ *   - 0 (schema, sent for each topic on start & once per second):
+ *     topic:u8 rate_hz:u16 name:zero-terminated num_values:u8,
+ *     then for each value: name:zero-terminated num_components:u8
+ *   - 1 (data): topic:u8 timestamp_us:u32 then all components as float32
+ *   decoder: tools/telemetry_decode.py
+ */
+class Telemetry {
+public:
+	/**
+	 * @param output non-blocking output function: must return -E_WOULD_BLOCK
+	 *               (or any other value <0) if it cannot accept the byte
+	 * @param buffer_size size of the transmit ring buffer
+	 */
+	Telemetry(FuncWrite output, size_t buffer_size=2048);
+	~Telemetry();
+
+	/**
+	 * add a topic. the schema & data packets of a topic must fit into
+	 * max_payload_size (asserted here & in addValue)
+	 * @param rate_hz send rate. 0 means disabled
+	 * @return topic id
+	 */
+	int addTopic(const std::string& name, uint rate_hz);
+
+	/**
+	 * add values to a topic
+	 * @param value reference to the value that changes over time
+	 */
+	void addValue(int topic, const std::string& name, const float& value);
+	void addValue(int topic, const std::string& name, const Math::Vec3<float>& value);
+
+	/** @return topic id or <0 if not found */
+	int findTopic(const std::string& name) const;
+	void setRate(int topic, uint rate_hz);
+	int numTopics() const { return (int)m_topics.size(); }
+
+	void start();
+	void stop() { m_running = false; }
+	bool running() const { return m_running; }
+
+	/** send due topics & write out queued data. call this from the main loop */
+	void update();
+
+	void printStatus(Output& output);
+
+	static constexpr size_t max_payload_size = 250;
+
+private:
+	struct Value {
+		std::string name;
+		std::vector<const float*> components;
+	};
+	struct Topic {
+		std::string name;
+		uint rate_hz;
+		Timestamp next_update;
+		std::vector<Value> values;
+		size_t num_components;
+		size_t schema_size; /** payload size of the schema packet */
+		uint num_sent;
+		uint num_dropped;
+	};
+
+	/**
+	 * add CRC, COBS encode & queue a packet
+	 * @return false if not enough space in the buffer
+	 */
+	bool queuePacket(const uint8* payload, size_t length);
+	void sendData(int topic, Timestamp now);
+	void sendSchema();
+	void flush();
+
+	inline size_t bufferUsed() const {
+		return (m_write_pos + m_buffer_size - m_read_pos) % m_buffer_size;
+	}
+
+	FuncWrite m_output;
+	uint8* m_buffer;
+	size_t m_buffer_size;
+	size_t m_read_pos = 0;
+	size_t m_write_pos = 0;
+
+	std::vector<Topic> m_topics;
+	bool m_running = false;
+	Timestamp m_next_schema;
+	uint m_num_bytes = 0; /** total written bytes */
+};
+
+#endif /* _TELEMETRY_HEADER_HPP_ */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "timer_tick.hpp"
+#include <kernel/interrupt.h>
+#include <kernel/errors.h>
+#include <kernel/utils.h>
+
+#include <algorithm>
+
+using namespace std;
+
+TimerTick* volatile TimerTick::m_instance = NULL;
+bool TimerTick::m_handler_registered = false;
+
+TimerTick::TimerTick() {
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_reset_statistics = false;
+	m_first_tick = true;
+}
+
+TimerTick::~TimerTick() {
+	stop();
+}
+
+int TimerTick::start(uint period_us, FuncTick tick) {
+#ifdef ARCH_HAS_INTERRUPT
+	if(period_us == 0) return -E_INVALID_PARAM;
+	if(m_instance) return -E_BUSY;
+
+	if(!m_handler_registered) {
+		int ret = registerTimerIrqEventHandler(&TimerTick::timerIrqHandler);
+		if(ret) return ret;
+		m_handler_registered = true;
+	}
+
+	m_tick = tick;
+	m_period = period_us;
+	m_first_tick = true;
+	m_reset_statistics = true;
+
+	disableInterrupts();
+	m_instance = this;
+	setTimerIRQPeriodMicro(period_us);
+	enableTimerIRQ();
+	enableInterrupts();
+	return 0;
+#else
+	return -E_UNSUPPORTED;
+#endif /* ARCH_HAS_INTERRUPT */
+}
+
+void TimerTick::stop() {
+	if(m_instance != this) return;
+#ifdef ARCH_HAS_INTERRUPT
+	disableTimerIRQ();
+#endif /* ARCH_HAS_INTERRUPT */
+	m_instance = NULL;
+}
+
+void TimerTick::timerIrqHandler() {
+	TimerTick* instance = m_instance;
+	if(instance) instance->handleTick();
+}
+
+void TimerTick::handleTick() {
+	Timestamp now = getTimestamp();
+
+	if(m_reset_statistics) {
+		memset(&m_stats, 0, sizeof(m_stats));
+		m_stats.start = now;
+		m_reset_statistics = false;
+		resetGpioIRQMaxDuration();
+	} else if(!m_first_tick) {
+		int jitter = (int)(now - m_last_tick) - (int)m_period;
+		if(jitter < m_stats.min_jitter) m_stats.min_jitter = jitter;
+		if(jitter > m_stats.max_jitter) m_stats.max_jitter = jitter;
+	}
+	m_first_tick = false;
+	m_last_tick = now;
+
+	m_tick();
+
+	uint duration = getTimestamp() - now;
+	if(duration > m_stats.max_duration) m_stats.max_duration = duration;
+	m_stats.total_duration += duration;
+	if(duration > m_period) ++m_stats.num_overruns;
+	++m_stats.num_ticks;
+}
+
+void TimerTick::statistics(Statistics& stats) const {
+	disableInterrupts();
+	stats = m_stats;
+	enableInterrupts();
+}
+
+void TimerTick::printStatistics(Output& output) const {
+	Statistics stats;
+	statistics(stats);
+	if(!running()) output.printf("Timer tick is not running\n");
+
+	uint elapsed_ms = (getTimestamp() - stats.start) / 1000;
+	if(elapsed_ms == 0) elapsed_ms = 1;
+	uint avg_duration = stats.num_ticks ?
+			(uint)(stats.total_duration / stats.num_ticks) : 0;
+	uint max_abs_jitter = max(-stats.min_jitter, stats.max_jitter);
+
+	output.printf("Statistics over the last %u ms\n", elapsed_ms);
+	output.printf("period         : %u us (%u Hz)\n", m_period,
+			m_period ? 1000000 / m_period : 0);
+	output.printf("ticks          : %u\n", stats.num_ticks);
+	output.printf("jitter         : %i / %i us (min / max), max abs: %u us\n",
+			stats.min_jitter, stats.max_jitter, max_abs_jitter);
+	output.printf("ISR duration   : %u / %u us (avg / max)\n", avg_duration,
+			stats.max_duration);
+	output.printf("overruns       : %u\n", stats.num_overruns);
+	/* gpio edges (RC input pulses, data ready) are timestamped in the gpio IRQ */
+#ifdef ARCH_HAS_GPIO_FIQ
+	output.printf("edge latency   : <= %u us (gpio FIQ, longest handler)\n",
+			getGpioIRQMaxDuration());
+#else
+	output.printf("edge latency   : <= %u us (gpio IRQ, max ISR duration)\n",
+			max(stats.max_duration, getGpioIRQMaxDuration()));
+#endif
+	output.printf("load           : %u %%\n",
+			(uint)(stats.total_duration / 10 / elapsed_ms));
+}
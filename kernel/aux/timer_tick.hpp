@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _TIMER_TICK_HEADER_HPP_
+#define _TIMER_TICK_HEADER_HPP_
+
+#include <kernel/types.h>
+#include <kernel/timer.h>
+#include <kernel/io.hpp>
+
+#include <functional>
+
+/**
+ * periodic tick, driven by the timer interrupt. the tick function is called in
+ * IRQ context, so it preempts the main loop (and cannot be delayed by it,
+ * except when interrupts are disabled).
+ *
+ * there is only one hardware timer, so only one TimerTick can run at a time.
+ *
+ * statistics: jitter is measured as the deviation of the interval between two
+ * consecutive ticks from the period (the hardware timer reloads itself, so
+ * this is the variation of the IRQ latency). an overrun is a tick that took
+ * longer than the period.
+ */
+class TimerTick {
+public:
+	typedef std::function<void ()> FuncTick;
+
+	struct Statistics {
+		uint num_ticks;
+		uint num_overruns;
+		int min_jitter; /** min deviation of the tick interval [us] */
+		int max_jitter; /** max deviation of the tick interval [us] */
+		uint max_duration; /** worst-case duration of a tick [us] */
+		uint64_t total_duration; /** [us] */
+		Timestamp start; /** start time of the statistics */
+	};
+
+	TimerTick();
+	~TimerTick();
+
+	/**
+	 * start the tick. the first tick happens one period from now.
+	 * @param period_us tick period in microseconds
+	 * @param tick function to call (in IRQ context!)
+	 * @return 0 on success, <0 on error (eg. the arch has no interrupts or
+	 *         another TimerTick is running)
+	 */
+	int start(uint period_us, FuncTick tick);
+
+	void stop();
+
+	bool running() const { return m_instance == this; }
+	uint period() const { return m_period; }
+
+	/** get a consistent copy of the statistics */
+	void statistics(Statistics& stats) const;
+
+	/** reset the statistics (the reset is done in the next tick) */
+	void resetStatistics() { m_reset_statistics = true; }
+
+	void printStatistics(Output& output) const;
+
+private:
+	static void timerIrqHandler();
+	inline void handleTick();
+
+	static TimerTick* volatile m_instance;
+	static bool m_handler_registered;
+
+	FuncTick m_tick;
+	uint m_period = 0;
+	Timestamp m_last_tick;
+	bool m_first_tick;
+	volatile bool m_reset_statistics;
+
+	Statistics m_stats;
+};
+
+#endif /* _TIMER_TICK_HEADER_HPP_ */
@@ -9,6 +9,7 @@ src += $(THIS_DIR)main.cpp
 src += $(THIS_DIR)utils.c
 src += $(THIS_DIR)printk.c
 src += $(THIS_DIR)endian.c
+src += $(THIS_DIR)crc.c
 src += $(THIS_DIR)string.c
 src += $(THIS_DIR)math.c
 src += $(THIS_DIR)interrupt.c
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "crc.h"
+
+uint16 crc16Byte(uint16 crc, uint8 byte) {
+	crc ^= (uint16)byte << 8;
+	for(int i=0; i<8; ++i) {
+		if(crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+		else crc <<= 1;
+	}
+	return crc;
+}
+
+uint16 crc16(uint16 crc, const void* data, size_t len) {
+	const uint8* bytes = (const uint8*)data;
+	for(size_t i=0; i<len; ++i)
+		crc = crc16Byte(crc, bytes[i]);
+	return crc;
+}
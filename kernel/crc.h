@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*!
+ * checksum functions
+ */
+
+#ifndef CRC_HEADER_H_
+#define CRC_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "types.h"
+
+#define CRC16_INIT 0xffff
+
+/**
+ * CRC-16/CCITT (polynomial 0x1021, no reflection). start with CRC16_INIT and
+ * pass the returned value to the next call to checksum data in pieces.
+ */
+uint16 crc16(uint16 crc, const void* data, size_t len);
+
+/** update a CRC-16/CCITT with a single byte */
+uint16 crc16Byte(uint16 crc, uint8 byte);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* CRC_HEADER_H_ */
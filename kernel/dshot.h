@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*!
+ * DShot digital ESC protocol: frame encoding. used by the ESC output
+ * (kernel/esc.h), but independent of the hardware.
+ *
+ * a frame has 16 bits, sent MSB first: 11 bit value, telemetry request bit,
+ * 4 bit checksum. values 1-47 are commands, 48-2047 the throttle, 0 stops the
+ * motor. every bit has the same length (DShot150: 6.67us, DShot300: 3.33us,
+ * DShot600: 1.67us) & starts high: a 0 is high for 3/8, a 1 for 6/8 of it.
+ */
+
+#ifndef DSHOT_HEADER_H_
+#define DSHOT_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "types.h"
+
+#define DSHOT_FRAME_BITS      16
+
+#define DSHOT_VALUE_STOP      0
+#define DSHOT_THROTTLE_MIN    48
+#define DSHOT_THROTTLE_MAX    2047
+
+/** bit timing, in units of 1/8 bit */
+#define DSHOT_BIT_UNITS       8
+#define DSHOT_ZERO_HIGH_UNITS 3
+#define DSHOT_ONE_HIGH_UNITS  6
+/** min low time between frames [bits] */
+#define DSHOT_FRAME_GAP_BITS  4
+
+
+/** 4 bit checksum of the 12 upper bits (value & telemetry bit) */
+static inline uint16 dshotCRC(uint16 data) {
+	return (data ^ (data >> 4) ^ (data >> 8)) & 0xf;
+}
+
+/**
+ * create a frame
+ * @param value [0, 2047]
+ * @param telemetry request telemetry
+ */
+static inline uint16 dshotEncode(uint16 value, bool telemetry) {
+	uint16 data = ((value & 0x7ff) << 1) | (telemetry ? 1 : 0);
+	return (data << 4) | dshotCRC(data);
+}
+
+/**
+ * decode a frame
+ * @return true if the checksum is correct
+ */
+static inline bool dshotDecode(uint16 frame, uint16* value, bool* telemetry) {
+	uint16 data = frame >> 4;
+	*value = data >> 1;
+	*telemetry = data & 1;
+	return dshotCRC(data) == (frame & 0xf);
+}
+
+/**
+ * GPIO clear masks of a frame per pin, for outputs that set all pins high at
+ * the start of a bit & clear the pins sending a 0 after DSHOT_ZERO_HIGH_UNITS
+ * (& all of them after DSHOT_ONE_HIGH_UNITS)
+ * @param zero_mask DSHOT_FRAME_BITS masks, in sending order (MSB first): pin p
+ *        is set in zero_mask[bit] if bit (15-bit) of its frame is 0
+ * @param frames frames[i] is sent on pins[i], pins in [0, 31]
+ */
+static inline void dshotZeroMasks(uint32* zero_mask, const uint16* frames,
+		const int* pins, int num_pins) {
+	for(int bit=0; bit<DSHOT_FRAME_BITS; ++bit) {
+		uint16 bit_mask = 1 << (DSHOT_FRAME_BITS-1-bit);
+		zero_mask[bit] = 0;
+		for(int i=0; i<num_pins; ++i) {
+			if(!(frames[i] & bit_mask)) zero_mask[bit] |= (uint32)1 << pins[i];
+		}
+	}
+}
+
+/** the frame a pin sends with zero masks from dshotZeroMasks() (like an ESC) */
+static inline uint16 dshotZeroMasksFrame(const uint32* zero_mask, int pin) {
+	uint16 frame = 0;
+	for(int bit=0; bit<DSHOT_FRAME_BITS; ++bit)
+		frame = (frame << 1) | ((zero_mask[bit] >> pin) & 1 ? 0 : 1);
+	return frame;
+}
+
+/**
+ * frame value of a throttle
+ * @param throttle in [0,1], <= 0 stops the motor
+ */
+static inline uint16 dshotThrottleValue(float throttle) {
+	if(throttle <= 0.f) return DSHOT_VALUE_STOP;
+	float value = DSHOT_THROTTLE_MIN + throttle
+			* (DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN) + 0.5f;
+	if(value >= DSHOT_THROTTLE_MAX) return DSHOT_THROTTLE_MAX;
+	return (uint16)value;
+}
+
+/** inverse of dshotThrottleValue() */
+static inline float dshotThrottle(uint16 value) {
+	if(value < DSHOT_THROTTLE_MIN) return 0.f;
+	return (float)(value - DSHOT_THROTTLE_MIN)
+			/ (DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* DSHOT_HEADER_H_ */
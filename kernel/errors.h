@@ -34,6 +34,8 @@ extern "C" {
 #define E_UNSUPPORTED					15
 #define E_OUT_OF_MEMORY					16
 #define E_WOULD_BLOCK					17
+#define E_BUSY							18 /* resource is already in use */
+#define E_IO							19 /* bus or device communication error */
 
 
 #ifdef __cplusplus
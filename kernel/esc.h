@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*!
+ * ESC (motor) output: pulses or DShot frames on GPIO pins, timed by the
+ * hardware. the outputs of all channels are changed together.
+ */
+
+#ifndef ESC_HEADER_H_
+#define ESC_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <kernel/types.h>
+#include <kernel/errors.h>
+#include <kernel/utils.h>
+#include <esc_arch.h>
+
+
+#define ESC_MAX_CHANNELS 8
+
+/** output modes */
+#define ESC_MODE_CONTINUOUS   0 /** pulses repeat with the period */
+/** like continuous, but an update starts a new period immediately if no
+ * pulse is active, so the pulses are aligned with the caller (the control
+ * loop). without updates the pulses repeat, so the ESCs keep their signal */
+#define ESC_MODE_SYNCHRONIZED 1
+
+/**
+ * setup the output. all pulses are 0 (output low) until the first update.
+ * @param gpio_pins pin of each channel
+ * @param num_channels [1, ESC_MAX_CHANNELS]
+ * @param mode ESC_MODE_*
+ * @param period_ns pulse period (synchronized mode: when there are no
+ *                  updates). in synchronized mode, if it is longer than the
+ *                  update interval, every update starts a new period
+ * @param resolution_ns pulse width step
+ * @return 0 on success, <0 on error
+ */
+int initESCOutput(const int* gpio_pins, int num_channels, int mode,
+		uint32 period_ns, uint32 resolution_ns);
+
+/**
+ * set the pulse widths of all channels. the new pulses start with the next
+ * period (synchronized mode: immediately if no pulse is active)
+ * @param pulse_ns one per channel, limited to the period
+ * @return 0 on success, <0 on error
+ */
+int escOutputUpdate(const uint32* pulse_ns);
+
+/**
+ * setup a DShot output (see kernel/dshot.h): all channels send their frame
+ * at the same time, once per period. stop frames (0) are sent until the
+ * first update.
+ * @param mode, period_ns see initESCOutput(). the period must be longer than
+ *        a frame + DSHOT_FRAME_GAP_BITS
+ * @param bit_rate_kbit 150, 300 or 600 (DShot150, ...)
+ * @return 0 on success, <0 on error
+ */
+int initESCOutputDShot(const int* gpio_pins, int num_channels, int mode,
+		uint32 period_ns, uint32 bit_rate_kbit);
+
+/**
+ * set the frames of all channels (DShot output)
+ * @param frames one per channel, see dshotEncode()
+ * @return 0 on success, <0 on error
+ */
+int escOutputUpdateDShot(const uint16* frames);
+
+/** change the period (same meaning as in initESCOutput) */
+int escOutputSetPeriod(uint32 period_ns);
+uint32 escOutputPeriod();
+
+/** stop the output (all pins low) */
+void escOutputStop();
+
+/** statistics (since the last reset) */
+struct ESCOutputStatistics {
+	uint updates;
+	uint immediate; /** synchronized mode: started a new period */
+	uint busy; /** synchronized mode: a pulse was active, next period */
+	uint deferred; /** the previous update did not start yet: replaced */
+	uint errors; /** DMA errors */
+};
+void escOutputGetStatistics(struct ESCOutputStatistics* statistics);
+void escOutputResetStatistics();
+
+#ifndef ARCH_HAS_ESC_OUTPUT
+
+#define initESCOutput(gpio_pins, num_channels, mode, period_ns, resolution_ns) (-E_UNSUPPORTED)
+#define escOutputUpdate(pulse_ns) (-E_UNSUPPORTED)
+#define initESCOutputDShot(gpio_pins, num_channels, mode, period_ns, bit_rate_kbit) (-E_UNSUPPORTED)
+#define escOutputUpdateDShot(frames) (-E_UNSUPPORTED)
+#define escOutputSetPeriod(period_ns) (-E_UNSUPPORTED)
+#define escOutputPeriod() (0)
+#define escOutputStop() NOP
+#define escOutputGetStatistics(statistics) memset(statistics, 0, sizeof(struct ESCOutputStatistics))
+#define escOutputResetStatistics() NOP
+
+#endif /* ARCH_HAS_ESC_OUTPUT */
+
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* ESC_HEADER_H_ */
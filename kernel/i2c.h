@@ -29,8 +29,27 @@ extern "C" {
 #include <i2c_arch.h>
 
 
+/*
+ * there can be several buses (controllers), each with its own queue & clock
+ * rate (I2C_NUM_BUSES, bus numbers start at 0). the functions w/o bus
+ * argument use the bus set with i2cSetBus() for the address, by default
+ * I2C_DEFAULT_BUS. so drivers that only know the slave address can be bound
+ * to a bus without changing them.
+ */
+
+/** init the default bus (400 kHz) */
 void initI2C();
 
+/** init (or reconfigure) a bus. the bus must be idle.
+ * @return 0 on success, <0 on error
+ */
+int initI2CBus(int bus, uint32 freq_khz);
+
+/** use bus for all transfers to addr w/o explicit bus.
+ * @return 0 on success, <0 on error
+ */
+int i2cSetBus(int addr, int bus);
+
 /** read i2c data from a slave
  * @param addr 7bit (w/o RW bit)
  * @param buf output buffer (length >= len)
@@ -47,12 +66,140 @@ int i2cRead(int addr, char* buf, int len);
  */
 int i2cWrite(int addr, char* buf, int len);
 
+/** combined transfer: write (eg. a register address), then read with a
+ * repeated start instead of a STOP & a new transfer
+ * @param addr 7bit (w/o RW bit)
+ * @param write_len [1, I2C_MAX_WRITE_READ_LEN]
+ * @return number of bytes read (0 if the write failed)
+ */
+int i2cWriteRead(int addr, char* write_buf, int write_len, char* read_buf, int read_len);
+
+/* same as above, on a given bus */
+int i2cBusRead(int bus, int addr, char* buf, int len);
+int i2cBusWrite(int bus, int addr, char* buf, int len);
+int i2cBusWriteRead(int bus, int addr, char* write_buf, int write_len,
+		char* read_buf, int read_len);
+
+
+/*
+ * asynchronous transactions: transactions are queued & processed in the
+ * background by the controller IRQ (in order). i2cRead() & i2cWrite() queue a
+ * transaction as well & wait for it. while waiting they process the queue
+ * themselves, so they also work with disabled interrupts (eg. in the timer IRQ).
+ */
+
+struct I2CTransaction;
+/** completion callback. called in IRQ context (or from the waiting caller) */
+typedef void (*I2CCallback)(struct I2CTransaction* transaction);
+
+struct I2CTransaction {
+	int bus;
+	int addr; /** 7bit (w/o RW bit) */
+	char* buf;
+	int len; /** [1, 65535] */
+	int read; /** 0=write, 1=read */
+	/** for reads: data written before the read, with a repeated start
+	 *  (write_len <= I2C_MAX_WRITE_READ_LEN, 0 for none) */
+	char* write_buf;
+	int write_len;
+	I2CCallback callback; /** can be NULL */
+	void* user_data;
+
+	/* set by the driver */
+	volatile int pending; /** !=0 while queued or active */
+	int result; /** number of bytes transferred or <0 on timeout */
+	int async; /** nobody waits for it */
+	uint32 start_time; /** [us] */
+	uint32 deadline; /** [us] derived from the length & the bus speed */
+};
+
+/** max length for i2cWriteAsync(). longer than the FIFO (16 bytes): the IRQ
+ *  refills it. fits a write of all 16 PCA9685 channels (register + 4*16) */
+#define I2C_ASYNC_MAX_LEN (1+4*16)
+/** max write length of a combined write-read (it must fit into the FIFO) */
+#define I2C_MAX_WRITE_READ_LEN 16
+
+/**
+ * queue a transaction. the transaction (& buffer) must stay valid until
+ * pending is 0.
+ * each transaction has a deadline (about twice the transfer time): if it
+ * is exceeded or on a clock stretch timeout, the transfer is aborted & the
+ * bus is recovered (clock pulses & STOP). this is done by the next
+ * submission or i2cPoll() (about 100us): until then new transactions are
+ * rejected (-E_BUSY).
+ * @return 0 on success, <0 on error (eg. queue full)
+ */
+int i2cSubmit(struct I2CTransaction* transaction);
+
+/**
+ * write without waiting for completion. the data is copied, errors are only
+ * counted in the statistics.
+ * If len > I2C_ASYNC_MAX_LEN, this is the same as i2cWrite().
+ * @return len on success, 0 if the queue is full
+ */
+int i2cWriteAsync(int addr, char* buf, int len);
+int i2cBusWriteAsync(int bus, int addr, char* buf, int len);
+
+/**
+ * process the transaction queues (needed if interrupts are disabled). also
+ * detects deadline timeouts & runs a pending bus recovery without new
+ * submissions: call it periodically, eg. once per control tick
+ */
+void i2cPoll();
+
+/** statistics per bus (since the last reset) */
+struct I2CStatistics {
+	uint transactions; /** completed */
+	uint async_transactions; /** completed, nobody waited for them */
+	uint errors; /** incomplete transfers (NACK, clock stretch timeout) */
+	uint timeouts; /** deadline exceeded */
+	uint queue_full;
+	uint recoveries; /** bus recoveries */
+	uint rejected; /** during a bus recovery */
+	uint32 bus_time_us; /** time from start to completion */
+	uint32 async_bus_time_us; /** bus time of async transactions: CPU time
+	                              that is not spent waiting */
+	uint32 wait_time_us; /** time spent waiting in i2cRead() & i2cWrite() */
+};
+/** @return 0 on success, <0 on error (invalid bus) */
+int i2cGetStatistics(int bus, struct I2CStatistics* statistics);
+
+/** statistics per device (bus & slave address) */
+struct I2CDeviceStatistics {
+	uint transactions;
+	uint errors;
+	uint timeouts;
+	uint32 latency_sum_us; /** from the start to the completion */
+	uint32 latency_max_us;
+};
+/** @return 0 on success, <0 on error */
+int i2cGetDeviceStatistics(int bus, int addr, struct I2CDeviceStatistics* statistics);
+
+/** reset all statistics (of all buses) */
+void i2cResetStatistics();
+
 #ifndef ARCH_HAS_I2C
 
+#define I2C_NUM_BUSES 1
+#define I2C_DEFAULT_BUS 0
+
 #define initI2C() NOP
+#define initI2CBus(bus, freq_khz) (-E_UNSUPPORTED)
+#define i2cSetBus(addr, bus) (-E_UNSUPPORTED)
 
 #define i2cRead(addr, buf, len) (0)
 #define i2cWrite(addr, buf, len) (0)
+#define i2cWriteRead(addr, write_buf, write_len, read_buf, read_len) (0)
+#define i2cBusRead(bus, addr, buf, len) (0)
+#define i2cBusWrite(bus, addr, buf, len) (0)
+#define i2cBusWriteRead(bus, addr, write_buf, write_len, read_buf, read_len) (0)
+#define i2cSubmit(transaction) (-E_UNSUPPORTED)
+#define i2cWriteAsync(addr, buf, len) (0)
+#define i2cBusWriteAsync(bus, addr, buf, len) (0)
+#define i2cPoll() NOP
+#define i2cGetStatistics(bus, statistics) (-E_UNSUPPORTED)
+#define i2cGetDeviceStatistics(bus, addr, statistics) (-E_UNSUPPORTED)
+#define i2cResetStatistics() NOP
 
 #endif /* ARCH_HAS_I2C */
 
@@ -23,6 +23,35 @@
 /** I2C IO functions: return the length of written/read bytes */
 typedef std::function<int (int addr, char* buffer, int len)> FuncI2CWrite;
 typedef std::function<int (int addr, char* buffer, int len)> FuncI2CRead;
+/** combined write & read with a repeated start: return the length of read bytes */
+typedef std::function<int (int addr, char* write_buffer, int write_len,
+		char* read_buffer, int read_len)> FuncI2CWriteRead;
+
+
+/** I/O functions bound to a bus, eg. to put a device on another bus */
+inline FuncI2CWrite i2cBusWriteFunction(int bus) {
+	return [bus](int addr, char* buffer, int len) {
+		return i2cBusWrite(bus, addr, buffer, len);
+	};
+}
+/** does not wait for completion (see i2cWriteAsync()) */
+inline FuncI2CWrite i2cBusWriteAsyncFunction(int bus) {
+	return [bus](int addr, char* buffer, int len) {
+		return i2cBusWriteAsync(bus, addr, buffer, len);
+	};
+}
+inline FuncI2CRead i2cBusReadFunction(int bus) {
+	return [bus](int addr, char* buffer, int len) {
+		return i2cBusRead(bus, addr, buffer, len);
+	};
+}
+inline FuncI2CWriteRead i2cBusWriteReadFunction(int bus) {
+	return [bus](int addr, char* write_buffer, int write_len,
+			char* read_buffer, int read_len) {
+		return i2cBusWriteRead(bus, addr, write_buffer, write_len,
+				read_buffer, read_len);
+	};
+}
 
 
 /** high-level I2C class */
@@ -40,6 +69,14 @@ public:
 		return m_func_write(m_addr, buffer, len);
 	}
 	
+	/** use a combined write-read transfer in writeRead() (otherwise it does
+	 *  a write & a read) */
+	void setWriteReadFunction(FuncI2CWriteRead func_write_read) {
+		m_func_write_read = func_write_read;
+	}
+	/** write (eg. a register address), then read. @return bytes read */
+	inline int writeRead(char* write_buffer, int write_len, char* read_buffer, int read_len);
+	
 	/** i2c_smbus_read_byte_data function: read 1 byte from a given register */
 	inline int readRegister(uchar reg, uchar& out_data);
 
@@ -47,12 +84,19 @@ public:
 private:
 	FuncI2CWrite m_func_write;
 	FuncI2CRead m_func_read;
+	FuncI2CWriteRead m_func_write_read;
 	int m_addr; //7/10 bit address, w/o RW bit
 };
 
+int I2C::writeRead(char* write_buffer, int write_len, char* read_buffer, int read_len) {
+	if(m_func_write_read)
+		return m_func_write_read(m_addr, write_buffer, write_len, read_buffer, read_len);
+	if(write(write_buffer, write_len) != write_len) return 0;
+	return read(read_buffer, read_len);
+}
+
 int I2C::readRegister(uchar reg, uchar& out_data) {
-	if(write((char*)&reg, 1) != 1) return 0;
-	return read((char*)&out_data, 1);
+	return writeRead((char*)&reg, 1, (char*)&out_data, 1);
 }
 
 int I2C::writeRegister(uchar reg, uchar data) {
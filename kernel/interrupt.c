@@ -28,12 +28,17 @@ volatile uint g_irq_gpio_low_counter[GPIO_COUNT];
 volatile Timestamp g_irq_gpio_low_last_timestamp[GPIO_COUNT];
 
 static uint timer_irq_counter = 0;
+static volatile uint gpio_irq_max_duration = 0;
 static uint interrupts_enabled = 1; //0 means they are enabled
 
 #define MAX_GPIO_IRQ_EVENT_HANDLERS 3
 static GpioIrqEventHandler gpio_irq_event_handlers[MAX_GPIO_IRQ_EVENT_HANDLERS];
 static int gpio_irq_event_handler_count = 0;
 
+#define MAX_TIMER_IRQ_EVENT_HANDLERS 2
+static TimerIrqEventHandler timer_irq_event_handlers[MAX_TIMER_IRQ_EVENT_HANDLERS];
+static int timer_irq_event_handler_count = 0;
+
 
 void handleTimerIRQ() {
 	archHandleTimerIRQ();
@@ -41,7 +46,10 @@ void handleTimerIRQ() {
 	//printk_i("Got a timer interrupt\n");
 	++timer_irq_counter;
 	
-	//disableTimerIRQ();
+	//call event handlers
+	for(int i=0; i<timer_irq_event_handler_count; ++i) {
+		(*timer_irq_event_handlers[i])();
+	}
 }
 
 uint getTimerIRQCounter() {
@@ -53,8 +61,18 @@ void resetTimerIRQCounter() {
 }
 
 void handleGpioIRQ() {
+	Timestamp start = getTimestamp();
 	archHandleGpioIRQ();
-	
+	uint duration = getTimestamp() - start;
+	if(duration > gpio_irq_max_duration) gpio_irq_max_duration = duration;
+}
+
+uint getGpioIRQMaxDuration() {
+	return gpio_irq_max_duration;
+}
+
+void resetGpioIRQMaxDuration() {
+	gpio_irq_max_duration = 0;
 }
 void handleGpioIRQPin(int pin, int value) {
 	if(value) {
@@ -93,3 +111,10 @@ int registerGpioIrqEventHandler(GpioIrqEventHandler handler) {
 	gpio_irq_event_handlers[gpio_irq_event_handler_count++] = handler;
 	return 0;
 }
+
+int registerTimerIrqEventHandler(TimerIrqEventHandler handler) {
+	if(timer_irq_event_handler_count >= MAX_TIMER_IRQ_EVENT_HANDLERS)
+		return -E_BUFFER_FULL;
+	timer_irq_event_handlers[timer_irq_event_handler_count++] = handler;
+	return 0;
+}
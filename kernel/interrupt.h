@@ -25,7 +25,7 @@ extern "C" {
 
 /*
  * enable all interrupts. does not enable any specific device IRQ's, but IRQ's
- * in general. can be nested.
+ * in general. can be nested. the FIQ (see ARCH_HAS_GPIO_FIQ) is not affected.
  */
 void enableInterrupts();
 void disableInterrupts();
@@ -36,9 +36,21 @@ extern volatile Timestamp g_irq_gpio_high_last_timestamp[];
 extern volatile uint g_irq_gpio_low_counter[];
 extern volatile Timestamp g_irq_gpio_low_last_timestamp[];
 
+/**
+ * longest gpio IRQ handler [us] since the last reset. the edge timestamps are
+ * taken in it: with ARCH_HAS_GPIO_FIQ (the gpio IRQ preempts the other IRQ
+ * handlers) this bounds their latency, otherwise the longest other IRQ
+ * handler or section with disabled interrupts adds to it
+ */
+uint getGpioIRQMaxDuration();
+void resetGpioIRQMaxDuration();
+
 /** gpio IRQ callback handler */
 typedef void(*GpioIrqEventHandler)(int pin, int value);
 
+/** timer IRQ callback handler */
+typedef void(*TimerIrqEventHandler)();
+
 
 #ifdef ARCH_HAS_INTERRUPT
 
@@ -56,11 +68,20 @@ void handleGpioIRQ();
 
 /**
  * register a callback handler to process gpio IRQ events.
- * handler will be called in IRQ context!
+ * handler will be called in IRQ context! with ARCH_HAS_GPIO_FIQ it is the FIQ:
+ * it can preempt IRQ handlers & is not blocked by disableInterrupts(), so
+ * data shared with it must be read without relying on disabled interrupts
  * @return 0 on success, <0 error otherwise
  */
 int registerGpioIrqEventHandler(GpioIrqEventHandler handler);
 
+/**
+ * register a callback handler that is called on every timer IRQ (after the
+ * IRQ is cleared). handler will be called in IRQ context!
+ * @return 0 on success, <0 error otherwise
+ */
+int registerTimerIrqEventHandler(TimerIrqEventHandler handler);
+
 /**
  * handle an IRQ for a GPIO pin. called from arch specific gpio IRQ handler
  * (inside IRQ context)
@@ -72,6 +93,7 @@ void handleGpioIRQPin(int pin, int value);
 # define __disableInterrupts() NOP
 # define archHandleTimerIRQ() NOP
 # define archHandleGpioIRQ() NOP
+# define enableGpioIRQ() NOP
 # define inInterrupt() 0
 #endif
 
@@ -30,6 +30,8 @@ extern "C" {
 
 /** convert degrees to radians */
 #define DEG2RAD(degrees) ((degrees)*(M_PI/180.))
+/** convert radians to degrees */
+#define RAD2DEG(radians) ((radians)*(180./M_PI))
 
 /*
  * simple, not very accurate sine. x in radians
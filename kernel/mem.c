@@ -190,6 +190,8 @@ void printMemRegions() {
 			type = "(IO dev)  "; break;
 		case mem_region_type_page_table:
 			type = "(page tbl)"; break;
+		case mem_region_type_dma:
+			type = "(DMA)     "; break;
 		case mem_region_type_malloc:
 			type = "(malloc)  ";
 			tot_size += r->size; break;
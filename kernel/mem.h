@@ -34,7 +34,8 @@ typedef enum {
 	mem_region_type_kernel, /* used by the kernel: stack or kernel image */
 	mem_region_type_io_dev, /* IO device regions */
 	mem_region_type_page_table,
-	mem_region_type_malloc /* region controlled by kmalloc */
+	mem_region_type_malloc, /* region controlled by kmalloc */
+	mem_region_type_dma /* uncached: shared with DMA controllers */
 } mem_region_type;
 
 typedef struct {
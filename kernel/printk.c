@@ -208,6 +208,17 @@ int printk(enum LogLevel level, const char *format, ...) {
    return done;
 }
 
+int printkUnmasked(enum LogLevel level, const char *format, ...) {
+   va_list arg;
+   int done;
+
+   va_start (arg, format);
+   done = vfprintk(level, format, arg);
+   va_end (arg);
+
+   return done;
+}
+
 int vfprintk(enum LogLevel level, const char *format, va_list ap) {
 
 	if(level < g_log_level) return 0;
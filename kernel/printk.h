@@ -81,6 +81,15 @@ extern enum LogLevel g_log_level; /** current log level: log all levels equal or
  */
 int printk(enum LogLevel level, const char *format, ...);
 
+/**
+ * same as printk, but interrupts stay enabled while printing (printk disables
+ * them, so that messages from IRQ handlers are not interleaved). for the main
+ * loop, when time-critical code runs in an IRQ (eg. a control loop in the
+ * timer IRQ): a slow output then only delays the main loop.
+ * must not be called from an IRQ handler
+ */
+int printkUnmasked(enum LogLevel level, const char *format, ...);
+
 /** some convenience methods */
 #define printk_d(format, ...) printk(LogLevel_debug, format, ## __VA_ARGS__)
 #define printk_i(format, ...) printk(LogLevel_info, format, ## __VA_ARGS__)
@@ -47,11 +47,8 @@ int uartRead();
 /* are uart data available to read? */
 bool uartAvailable();
 
-/* try to read 8 bits (non-blocking), returns -E_WOULD_BLOCK if no data available, -1 on error */
-static inline int uartTryRead() {
-	if(uartAvailable()) return uartRead();
-	return -E_WOULD_BLOCK;
-}
+/* can a byte be written without blocking? */
+bool uartWriteReady();
 
 #ifndef ARCH_HAS_SERIAL
 
@@ -64,9 +61,24 @@ static inline int uartTryRead() {
 #define uartRead() (-1)
 
 #define uartAvailable() false
+#define uartWriteReady() false
 
 #endif /* ARCH_HAS_SERIAL */
 
+/* defined after the fallbacks above, so they also work without ARCH_HAS_SERIAL */
+
+/* try to read 8 bits (non-blocking), returns -E_WOULD_BLOCK if no data available, -1 on error */
+static inline int uartTryRead() {
+	if(uartAvailable()) return uartRead();
+	return -E_WOULD_BLOCK;
+}
+
+/* try to write 8 bits (non-blocking), returns -E_WOULD_BLOCK if the fifo is full */
+static inline int uartTryWrite(int data) {
+	if(!uartWriteReady()) return -E_WOULD_BLOCK;
+	uartWrite(data);
+	return 0;
+}
 
 
 #ifdef __cplusplus
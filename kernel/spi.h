@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*!
+ * SPI master interface
+ */
+
+#ifndef SPI_HEADER_H_
+#define SPI_HEADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <kernel/types.h>
+#include <kernel/errors.h>
+#include <kernel/utils.h>
+#include <spi_arch.h>
+
+
+/** init the controller & the pins */
+void initSPI();
+
+
+/*
+ * transfers are queued & processed in the background by the controller IRQ
+ * (in order). spiTransfer() queues a transfer as well & waits for it. while
+ * waiting it processes the queue itself (polling), so it also works with
+ * disabled interrupts (eg. in the timer IRQ).
+ */
+
+struct SPITransaction;
+/** completion callback. called in IRQ context (or from the waiting caller) */
+typedef void (*SPICallback)(struct SPITransaction* transaction);
+
+struct SPITransaction {
+	int cs; /** chip select line */
+	int mode; /** SPI mode [0, 3]: CPOL << 1 | CPHA */
+	uint32 clock_hz; /** max clock: the next lower possible clock is used */
+	int len; /** bytes on the bus [1, 65535] */
+	/** sent data: the first tx_len bytes, then 0. eg. a register address */
+	const char* tx;
+	int tx_len;
+	/** received data: the first rx_skip bytes are dropped, then up to
+	 * len - rx_skip bytes are stored. rx can be NULL */
+	char* rx;
+	int rx_skip;
+	SPICallback callback; /** can be NULL */
+	void* user_data;
+
+	/* set by the driver */
+	volatile int pending; /** !=0 while queued or active */
+	int result; /** number of bytes transferred or <0 on error */
+	int async; /** nobody waits for it */
+};
+
+/**
+ * transfer & wait for completion
+ * @return number of bytes transferred or <0 on error
+ */
+int spiTransfer(struct SPITransaction* transaction);
+
+/**
+ * queue a transfer. the transaction (& buffers) must stay valid until
+ * pending is 0.
+ * @return 0 on success, <0 on error (eg. queue full)
+ */
+int spiSubmit(struct SPITransaction* transaction);
+
+/** process the transfer queue (needed if interrupts are disabled) */
+void spiPoll();
+
+/** statistics (since the last reset) */
+struct SPIStatistics {
+	uint transfers; /** completed */
+	uint async_transfers; /** completed, nobody waited for them */
+	uint errors;
+	uint queue_full;
+	uint32 bytes;
+	uint32 bus_time_us; /** time from start to completion */
+	uint32 wait_time_us; /** time spent waiting in spiTransfer() */
+};
+void spiGetStatistics(struct SPIStatistics* statistics);
+void spiResetStatistics();
+
+#ifndef ARCH_HAS_SPI
+
+#define initSPI() NOP
+
+#define spiTransfer(transaction) (-E_UNSUPPORTED)
+#define spiSubmit(transaction) (-E_UNSUPPORTED)
+#define spiPoll() NOP
+#define spiGetStatistics(statistics) memset(statistics, 0, sizeof(struct SPIStatistics))
+#define spiResetStatistics() NOP
+
+#endif /* ARCH_HAS_SPI */
+
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SPI_HEADER_H_ */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _SPI_CPP_HEADER_H_
+#define _SPI_CPP_HEADER_H_
+
+#include <kernel/spi.h>
+
+#include <functional>
+
+
+/** SPI IO function (eg. spiTransfer or a simulated device):
+ *  return the number of transferred bytes or <0 on error */
+typedef std::function<int (struct SPITransaction* transaction)> FuncSPITransfer;
+
+
+/** SPI device on a chip select line, with register access where bit 7 of
+ *  the first byte selects a read (MPU-6000, MPU-9250, ...) */
+class SPIDevice {
+public:
+	/**
+	 * @param clock_hz clock for writes & normal reads
+	 * @param fast_clock_hz clock for readRegisters(..., fast=true)
+	 */
+	SPIDevice(FuncSPITransfer func_transfer, int cs, int mode,
+			uint32 clock_hz, uint32 fast_clock_hz)
+		: m_func_transfer(func_transfer), m_cs(cs), m_mode(mode),
+		  m_clock(clock_hz), m_fast_clock(fast_clock_hz) {}
+
+	/** @return len on success */
+	inline int readRegisters(uint8_t reg, uint8_t* data, int len, bool fast=false);
+	/** @return true on success */
+	inline bool readRegister(uint8_t reg, uint8_t& data);
+	inline bool writeRegister(uint8_t reg, uint8_t data);
+private:
+	FuncSPITransfer m_func_transfer;
+	int m_cs;
+	int m_mode;
+	uint32 m_clock;
+	uint32 m_fast_clock;
+};
+
+int SPIDevice::readRegisters(uint8_t reg, uint8_t* data, int len, bool fast) {
+	char address = (char)(reg | 0x80);
+	SPITransaction transaction;
+	transaction.cs = m_cs;
+	transaction.mode = m_mode;
+	transaction.clock_hz = fast ? m_fast_clock : m_clock;
+	transaction.len = len + 1;
+	transaction.tx = &address;
+	transaction.tx_len = 1;
+	transaction.rx = (char*)data;
+	transaction.rx_skip = 1;
+	if(m_func_transfer(&transaction) != len + 1) return -E_IO;
+	return len;
+}
+
+bool SPIDevice::readRegister(uint8_t reg, uint8_t& data) {
+	return readRegisters(reg, &data, 1) == 1;
+}
+
+bool SPIDevice::writeRegister(uint8_t reg, uint8_t data) {
+	char buffer[2] = { (char)(reg & 0x7f), (char)data };
+	SPITransaction transaction;
+	transaction.cs = m_cs;
+	transaction.mode = m_mode;
+	transaction.clock_hz = m_clock;
+	transaction.len = 2;
+	transaction.tx = buffer;
+	transaction.tx_len = 2;
+	transaction.rx = NULL;
+	transaction.rx_skip = 0;
+	return m_func_transfer(&transaction) == 2;
+}
+
+#endif /* _SPI_CPP_HEADER_H_ */
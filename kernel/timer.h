@@ -34,6 +34,14 @@ extern "C" {
 #define delay(ms) udelay((ms)*1000)
 
 
+#ifndef ARCH_HAS_CYCLE_COUNTER
+/* fall back to the microsecond timer */
+# define initCycleCounter() do {} while(0)
+# define getCycleCount() getTimestamp()
+# define getCycleCounterFrequency() 1000000
+#endif /* ARCH_HAS_CYCLE_COUNTER */
+
+
 /* from the linux kernel... use with unsigned variables! */
 /*
  *	These inlines deal with timer wrapping correctly. You are 
@@ -83,6 +83,15 @@ extern char kernel_cmd_line[COMMAND_LINE_LEN];
 # error "you must define CAN_ALIAS for your compiler"
 #endif /* __GNUC__ */
 
+/** compiler memory barrier: no memory access is moved across it. on a single
+ * core this is enough to order accesses to data shared with an IRQ handler
+ * (normal memory, not device registers) */
+#ifdef __GNUC__
+# define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+# error "you must define COMPILER_BARRIER for your compiler"
+#endif /* __GNUC__ */
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,578 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * software-in-the-loop simulation of the flight controller: the unmodified
+ * FlightController runs against simulated sensors, motors & RC input, which
+ * are backed by a quadrotor model. the clock is virtual, so it runs as fast as
+ * the CPU allows.
+ *
+ * a scripted pilot takes off, holds the altitude (using the true altitude),
+ * flies a few roll & pitch steps and lands. at the end the attitude tracking
+ * error & the simulation speed are printed.
+ *
+ * replay: the sensor samples & RC inputs can be recorded to a sensor log (see
+ * sensor_log.hpp) & replayed into the control path instead of the model. with
+ * the same options, the outputs (-o) of a replay are bit-identical to the ones
+ * of the recording, so they can be compared between code versions.
+ * a replay can also use the statically composed FlightController (-S), to
+ * compare it against the runtime-polymorphic one.
+ */
+
+#include <arch.h>
+#include <kernel/utils.h>
+#include <kernel/math.h>
+#include <kernel/aux/flight_controller/flight_controller_impl.hpp>
+#include <kernel/aux/flight_controller/fusion_benchmark.hpp>
+#include <kernel/aux/flight_controller/mixer.hpp>
+#include <kernel/aux/flight_controller/pid.hpp>
+#include <kernel/aux/filter.hpp>
+#include <kernel/aux/fixed.hpp>
+
+#include "quadrotor.hpp"
+#include "sim_devices.hpp"
+#include "sensor_log.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <memory>
+#include <unistd.h>
+
+using namespace std;
+using namespace Math;
+
+/** integration step of the model [us] */
+static const uint physics_step = 250;
+
+/** scripted pilot: stick positions in [-1,1] over time */
+struct Pilot {
+	float takeoff_time = 5.f; /** [s] (the startup takes ~4.3s) */
+	float landing_time; /** [s] */
+	float altitude = 2.f; /** [m] */
+
+	float roll_setpoint = 0.f; /** [rad] */
+	float pitch_setpoint = 0.f; /** [rad] */
+
+	void update(float t, const Quadrotor& quad, SimInputControl& input) {
+		/* roll & pitch steps of 10 degrees */
+		float step = (float)DEG2RAD(10.f);
+		roll_setpoint = pitch_setpoint = 0.f;
+		if(t >= 10.f && t < 12.f) roll_setpoint = step;
+		else if(t >= 12.f && t < 14.f) roll_setpoint = -step;
+		else if(t >= 14.f && t < 16.f) pitch_setpoint = step;
+		else if(t >= 16.f && t < 18.f) pitch_setpoint = -step;
+		if(t >= landing_time) roll_setpoint = pitch_setpoint = 0.f;
+
+		/* altitude hold: the FC has no altitude controller */
+		const QuadrotorParams& p = quad.params();
+		float hover = 2.f*sqrtf((float)(p.mass * Quadrotor::gravity / (4. * p.max_thrust))) - 1.f;
+		float target = t >= landing_time ? -0.5f : altitude;
+		float throttle = hover + 0.3f * (target - (float)quad.altitude())
+			+ 0.3f * (float)quad.velocity().z;
+		bool flying = t >= takeoff_time && !(t >= landing_time && quad.onGround());
+
+		input.setValue(InputControlValue_Roll, roll_setpoint / (float)DEG2RAD(45.f));
+		input.setValue(InputControlValue_Pitch, -pitch_setpoint / (float)DEG2RAD(45.f));
+		input.setValue(InputControlValue_Yaw, 0.f);
+		input.setValue(InputControlValue_Throttle, flying ?
+				min(1.f, max(-1.f, throttle)) : -1.f);
+		input.setValue(InputControlValue_Usr1, flying ? 1.f : -1.f);
+	}
+};
+
+/** min, max & RMS of a value */
+struct ErrorStatistics {
+	double sum_squared = 0.;
+	double max_abs = 0.;
+	uint count = 0;
+
+	void add(double value) {
+		sum_squared += value*value;
+		if(fabs(value) > max_abs) max_abs = fabs(value);
+		++count;
+	}
+	double rms() const { return count ? sqrt(sum_squared / count) : 0.; }
+};
+
+/** open a file or print an error */
+static FILE* openFile(const char* file_name, const char* mode) {
+	FILE* file = fopen(file_name, mode);
+	if(!file) printf("Error: cannot open %s\n", file_name);
+	return file;
+}
+
+/**
+ * run the same input through the float & the Fixed20 versions of the PID,
+ * the filters & the Mahony fusion and check the largest differences against
+ * fixed bounds. prints one JSON line per check (like the benchmarks)
+ * @return number of exceeded bounds (also printed to stderr)
+ */
+static int checkFixedPoint(Output& output, FusionBenchmark& fusion_benchmark) {
+	int failed = 0;
+	auto check = [&failed, &output](const char* name, float max_diff, float bound) {
+		bool ok = max_diff >= 0.f && max_diff <= bound;
+		//printf truncates the decimals: round to the 7 printed ones
+		output.printf("{\"benchmark\":\"fixed_point\",\"check\":\"%s\","
+			"\"max_diff\":%.7f,\"bound\":%.7f,\"ok\":%i}\n", name,
+			max_diff + 5e-8, bound + 5e-8, (int)ok);
+		if(!ok) {
+			fprintf(stderr, "Fixed-point check failed: %s differs by %.3g (bound %.3g)\n",
+					name, max_diff, bound);
+			++failed;
+		}
+	};
+
+	/* PID (with the gains of the FC), EMA & moving average: a sine with noise.
+	 * the inputs & coefficients are rounded to Fixed20 first, so that only
+	 * the arithmetic is compared (Ki=0.0003 alone is off by 0.14% in Q11.20) */
+	const uint num_updates = 100000;
+	const float dt = 1.f; /** [ms] */
+	auto rounded = [](float value) { return (float)Fixed20(value); };
+	PID<> pid_float(std::array<float, 3>{{rounded(0.15f), rounded(0.0003f), rounded(0.002f)}},
+		100.f, Filter1D<Filter1D_EMA, 1, float>(rounded(0.7f)));
+	PID<Filter1D<Filter1D_EMA, 1, Fixed20>, Fixed20> pid_fixed(
+		std::array<Fixed20, 3>{{Fixed20(0.15f), Fixed20(0.0003f), Fixed20(0.002f)}},
+		Fixed20(100), Filter1D<Filter1D_EMA, 1, Fixed20>(Fixed20(0.7f)));
+	Filter1D<Filter1D_EMA, 1, float> ema_float(rounded(0.1f));
+	Filter1D<Filter1D_EMA, 1, Fixed20> ema_fixed(Fixed20(0.1f));
+	Filter1D<Filter1D_MovingAverage, 8, float> average_float;
+	Filter1D<Filter1D_MovingAverage, 8, Fixed20> average_fixed;
+	float max_diff_pid = 0.f, max_diff_ema = 0.f, max_diff_average = 0.f;
+	uint32 random = 0x2545f491;
+	for(uint k=0; k<num_updates; ++k) {
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		float noise = (float)random * (1.f / 4294967296.f) - 0.5f;
+		float value = rounded(0.5f * sinf(2.f*(float)M_PI * 0.5f * k * dt / 1000.f) + 0.1f * noise);
+		max_diff_pid = max(max_diff_pid, fabsf(pid_float.get_pid(value, dt)
+				- (float)pid_fixed.get_pid(Fixed20(value), Fixed20(dt))));
+		max_diff_ema = max(max_diff_ema, fabsf(ema_float.nextValue(value)
+				- (float)ema_fixed.nextValue(Fixed20(value))));
+		max_diff_average = max(max_diff_average, fabsf(average_float.nextValue(value)
+				- (float)average_fixed.nextValue(Fixed20(value))));
+	}
+	check("pid", max_diff_pid, 1.2e-4f);
+	check("ema", max_diff_ema, 6e-6f);
+	check("moving_average", max_diff_average, 2e-6f);
+
+	/* Mahony with the gains of the FC, on the trajectories of the benchmark */
+	float max_rms_fusion = fusion_benchmark.maxRMSDifference(
+		[]() { return new SensorFusionMahonyAHRS<>(1.4f, 0.02f); },
+		[]() { return new SensorFusionMahonyAHRS<Fixed20>(1.4f, 0.02f); });
+	check("fusion_rms_deg", max_rms_fusion, 1.3f);
+	return failed;
+}
+
+static void usage(const char* name) {
+	printf("Usage: %s [options]\n"
+		" -t <seconds>  simulated time (default 30)\n"
+		" -s <seed>     seed for the sensor noise (default 1)\n"
+		" -r <Hz>       control rate (default 1000)\n"
+		" -T <file>     write binary telemetry to a file (all topics, see\n"
+		"               tools/telemetry_decode.py)\n"
+		" -c <command>  run a console command at the end (eg. -c profile -c sched)\n"
+		" -R <file>     record the sensor samples & inputs to a sensor log\n"
+		" -P <file>     replay a sensor log instead of simulating (the duration\n"
+		"               is given by the log; use the same -r as for recording)\n"
+		" -S            replay with the statically composed flight controller\n"
+		"               (no virtual calls in the control path, see\n"
+		"               flight_controller.hpp)\n"
+		" -o <file>     write the output of each control loop iteration (attitude,\n"
+		"               setpoint, throttle, PID terms, motors) as text\n"
+		" -B            run the sensor fusion & mixer benchmarks instead (JSON lines,\n"
+		"               see fusion_benchmark.hpp & mixer.hpp). -t is the time per\n"
+		"               fusion run (default 20). the fixed-point versions of the\n"
+		"               PID, filters & fusion are checked against float: the exit\n"
+		"               code is 1 if a difference exceeds its bound\n"
+		" -i            accel & gyro from a simulated MPU-6000 at 8 kHz, read\n"
+		"               through the SPI driver & the FIFO sampler\n"
+		" -d            DShot motor output (MotorControllerDShot): the frames are\n"
+		"               decoded by simulated ESCs from the GPIO masks of the DMA\n"
+		"               output. the encoding is checked against known frames first\n"
+		" -q            quiet: only print warnings & errors of the FC\n",
+		name);
+}
+
+int main(int argc, char** argv) {
+	float duration = -1.f;
+	uint seed = 1;
+	uint control_rate_hz = 1000;
+	FILE* telemetry_file = NULL;
+	string end_commands;
+	bool quiet = false;
+	bool benchmark = false;
+	FILE* record_file = NULL;
+	FILE* replay_file = NULL;
+	FILE* output_file = NULL;
+	bool static_composition = false;
+	bool spi_imu = false;
+	bool dshot = false;
+
+	int opt;
+	while((opt = getopt(argc, argv, "t:s:r:T:c:R:P:So:Bidqh")) != -1) {
+		switch(opt) {
+		case 't': duration = atof(optarg); break;
+		case 's': seed = atoi(optarg); break;
+		case 'r': control_rate_hz = atoi(optarg); break;
+		case 'T':
+			if(!(telemetry_file = openFile(optarg, "wb"))) return 1;
+			break;
+		case 'c': end_commands += string(optarg) + "\n"; break;
+		case 'R':
+			if(!(record_file = openFile(optarg, "w"))) return 1;
+			break;
+		case 'P':
+			if(!(replay_file = openFile(optarg, "r"))) return 1;
+			break;
+		case 'S': static_composition = true; break;
+		case 'o':
+			if(!(output_file = openFile(optarg, "w"))) return 1;
+			break;
+		case 'B': benchmark = true; break;
+		case 'i': spi_imu = true; break;
+		case 'd': dshot = true; break;
+		case 'q': quiet = true; break;
+		default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+		}
+	}
+	if(benchmark) {
+		initArch();
+		FusionBenchmark fusion_benchmark(duration > 0.f ? duration : 20.f,
+				control_rate_hz);
+		fusion_benchmark.addDefaultAlgorithms();
+		InputOutput io([]() { return -E_WOULD_BLOCK; },
+				[](int c) { putchar(c); return 0; });
+		fusion_benchmark.run(io);
+		benchmarkMixers(io);
+		return checkFixedPoint(io, fusion_benchmark) == 0 ? 0 : 1;
+	}
+	if(duration < 0.f) duration = 30.f;
+	if((duration < 10.f && !replay_file) || (record_file && replay_file) ||
+			(static_composition && (!replay_file || dshot)) || control_rate_hz == 0 || control_rate_hz > 1000000) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	initArch();
+	if(quiet) g_log_level = LogLevel_warn;
+
+	FlightControllerConfig config;
+	config.control_rate_hz = control_rate_hz;
+	config.control_tick_irq = false;
+
+	/* model & devices */
+	Quadrotor quad;
+	quad.reset(DEG2RAD(30.));
+	SimRandom random(seed);
+
+	SimSensorNoise gyro_noise;
+	gyro_noise.stddev = 0.01f;
+	gyro_noise.bias = Vec3f(0.01f, -0.008f, 0.005f);
+	gyro_noise.resolution = (float)DEG2RAD(1. / 16.4); //MPU-6050 at +-2000 deg/s
+	SimSensorGyro sensor_gyro(quad, random, gyro_noise, 1000);
+	config.sensor_gyro = &sensor_gyro;
+
+	SimSensorNoise accel_noise;
+	accel_noise.stddev = 0.3f; //mostly vibrations
+	accel_noise.bias = Vec3f(0.05f, -0.05f, 0.1f);
+	accel_noise.resolution = (float)(Quadrotor::gravity / 4096.); //+-8g
+	SimSensorAccel sensor_accel(quad, random, accel_noise, 1000);
+	config.sensor_accel = &sensor_accel;
+
+	/* or through the SPI IMU driver */
+	unique_ptr<SimMPU6000> sim_mpu6000;
+	unique_ptr<SPIMPU6000> mpu6000;
+	unique_ptr<MPU6000Sampler> mpu6000_sampler;
+	unique_ptr<SensorMPU6000GyroAccel<false>> mpu6000_gyro;
+	unique_ptr<SensorMPU6000GyroAccel<true>> mpu6000_accel;
+	if(spi_imu) {
+		SimSensorNoise noise = gyro_noise;
+		noise.resolution = 0.f; //given by the registers
+		sim_mpu6000.reset(new SimMPU6000(quad, random, noise, accel_noise));
+		SimMPU6000* device = sim_mpu6000.get();
+		mpu6000.reset(new SPIMPU6000([device](SPITransaction* transaction) {
+			return device->transfer(transaction);
+		}, 0));
+		if(!mpu6000->initialize() || !mpu6000->testConnection()) {
+			printf("Error: no connection to the MPU-6000\n");
+			return 1;
+		}
+		mpu6000_sampler.reset(new MPU6000Sampler(*mpu6000));
+		mpu6000_accel.reset(new SensorMPU6000GyroAccel<true>(*mpu6000_sampler));
+		mpu6000_gyro.reset(new SensorMPU6000GyroAccel<false>(*mpu6000_sampler));
+		uint sample_period = mpu6000->setSampleRate(8000);
+		mpu6000_sampler->setFIFOMode(true, sample_period);
+		config.sensor_gyro = mpu6000_gyro.get();
+		config.sensor_accel = mpu6000_accel.get();
+	}
+
+	SimSensorNoise compass_noise;
+	compass_noise.stddev = 0.005f;
+	compass_noise.resolution = 0.001f;
+	SimSensorCompass sensor_compass(quad, random, compass_noise, 13334); //75Hz
+	config.sensor_compass = &sensor_compass;
+
+	SimSensorBaro sensor_baro(quad, random, 0.3f, 25500);
+	config.sensor_barometer = &sensor_baro;
+
+	array<float, 4> min_thrusts = {{ 0.35f, 0.35f, 0.35f, 0.35f }};
+	array<float, 4> max_thrusts = {{ 0.7f, 0.7f, 0.7f, 0.7f }};
+	SimMotorController motor_controller(quad, min_thrusts, max_thrusts);
+	config.motor_controller = &motor_controller;
+	SimDShotESCs dshot_escs(quad);
+	unique_ptr<MotorControllerDShot> dshot_motor_controller;
+	if(dshot) {
+		if(SimDShotESCs::checkEncoding() != 0) return 1;
+		/* full throttle range, no calibration */
+		dshot_motor_controller.reset(new MotorControllerDShot(
+			{{ 0.f, 0.f, 0.f, 0.f }}, {{ 1.f, 1.f, 1.f, 1.f }},
+			[&dshot_escs](const uint16* frames) { return dshot_escs.output(frames); }));
+		config.motor_controller = dshot_motor_controller.get();
+	}
+
+	SimInputControl sim_input_control;
+
+	/* sensor log: either record the simulated devices or replace them */
+	const Timestamp start_time = getTimestamp();
+	SensorLog replay_log;
+	if(replay_file) {
+		int ret = replay_log.read(replay_file);
+		fclose(replay_file);
+		if(ret < 0) return 1;
+		replay_log.rebase(start_time);
+	}
+	ReplaySensor replay_gyro(replay_log, SensorLogStream_Gyro);
+	ReplaySensor replay_accel(replay_log, SensorLogStream_Accel);
+	ReplaySensor replay_compass(replay_log, SensorLogStream_Compass);
+	ReplaySensor replay_baro(replay_log, SensorLogStream_Baro);
+	ReplayInputControl replay_input_control(replay_log);
+
+	SensorLogWriter* log_writer = NULL;
+	list<RecordingSensor> recording_sensors;
+	auto record = [&](SensorBase<>*& sensor, SensorLogStream stream) {
+		recording_sensors.emplace_back(*sensor, *log_writer, stream);
+		sensor = &recording_sensors.back();
+	};
+	if(record_file) {
+		log_writer = new SensorLogWriter(record_file, start_time);
+		record(config.sensor_gyro, SensorLogStream_Gyro);
+		record(config.sensor_accel, SensorLogStream_Accel);
+		record(config.sensor_compass, SensorLogStream_Compass);
+		record(config.sensor_barometer, SensorLogStream_Baro);
+		sim_input_control.setLog(log_writer);
+	} else if(replay_file) {
+		config.sensor_gyro = &replay_gyro;
+		config.sensor_accel = &replay_accel;
+		config.sensor_compass = &replay_compass;
+		config.sensor_barometer = &replay_baro;
+	}
+
+	/* input: same conversion as on the target (flight_controller/main.cpp) */
+	InputControlBase<>& input_control = replay_file ?
+		(InputControlBase<>&)replay_input_control : sim_input_control;
+	config.input_control = &input_control;
+	input_control.getConverter(InputControlValue_Roll).setAbsolute(0.f, DEG2RAD(45.f));
+	input_control.getConverter(InputControlValue_Pitch).setAbsolute(0.f, DEG2RAD(-45.f));
+	input_control.getConverter(InputControlValue_Yaw).setRelative(0.f, 1.f/1000.f, -M_PI, M_PI, true);
+	input_control.getConverter(InputControlValue_Throttle).setAbsolute(0.f, 1.f);
+	InputSwitch<> input_switch_flying(input_control, 3);
+	config.input_switch_flying = &input_switch_flying;
+
+	/* same algorithms & gains as on the target */
+	SensorFusionMahonyAHRS<> sensor_fusion(1.4f, 0.02f);
+	config.sensor_fusion = &sensor_fusion;
+	config.altitude_cutoff_freq = 0.15f;
+
+	PID<> pid_roll( std::array<float, 3>{{0.15, 0.0003, 0.002}});
+	PID<> pid_pitch(std::array<float, 3>{{0.15, 0.0003, 0.002}});
+	PID<> pid_yaw(  std::array<float, 3>{{0.15, 0.0003, 0.002}});
+	config.pid[FlightControllerPID_Roll] = &pid_roll;
+	config.pid[FlightControllerPID_Pitch] = &pid_pitch;
+	config.pid[FlightControllerPID_Yaw] = &pid_yaw;
+
+	/* console: commands are fed from a string */
+	string console_input;
+	size_t console_pos = 0;
+	auto console_read = [&console_input, &console_pos]() {
+		if(console_pos >= console_input.length()) return -E_WOULD_BLOCK;
+		return (int)(unsigned char)console_input[console_pos++];
+	};
+	auto console_write = [](int c) { putchar(c); return 0; };
+	InputOutput io(console_read, console_write);
+	CommandLine cmd_line(io, "sil> ");
+	config.command_line = &cmd_line;
+	if(spi_imu) {
+		MPU6000Sampler* sampler = mpu6000_sampler.get();
+		cmd_line.addTestCommand([sampler](const vector<string>& arguments,
+				InputOutput& io) {
+			sampler->printStatus(io);
+		}, "imu", "print MPU-6000 sampling statistics");
+	}
+	if(telemetry_file) {
+		config.telemetry_output = [telemetry_file](int c) {
+			fputc(c, telemetry_file);
+			return 0;
+		};
+		console_input += "telemetry rate sensors 100\ntelemetry rate inputs 100\n"
+			"telemetry rate pid 100\ntelemetry start\n";
+	}
+
+	LedBlinker led_blinker(0);
+	config.led_blinker = &led_blinker;
+
+	if(output_file) {
+		fprintf(output_file, "# timestamp attitude[3] setpoint[3] throttle "
+				"pid_p[3] pid_i[3] pid_d[3] motors[4]\n");
+		config.control_output = [output_file](const BlackboxRecord& record) {
+			const Vec3f* vectors[] = { &record.attitude, &record.setpoint, NULL,
+				&record.pid_p, &record.pid_i, &record.pid_d };
+			fprintf(output_file, "%u", (uint)record.timestamp);
+			for(const Vec3f* vector : vectors) {
+				if(!vector) fprintf(output_file, " %.9g", record.throttle);
+				else fprintf(output_file, " %.9g %.9g %.9g", vector->x,
+						vector->y, vector->z);
+			}
+			for(int i=0; i<4; ++i)
+				fprintf(output_file, " %.9g", record.motors[i]);
+			fputc('\n', output_file);
+		};
+	}
+
+	/* simulation loop: runs whenever the control path is idle */
+	Pilot pilot;
+	pilot.landing_time = duration - 5.f;
+	const Timestamp end_time = replay_file ? replay_log.endTime() :
+		start_time + (Timestamp)(duration * 1e6f);
+	Timestamp physics_time = start_time;
+	bool end_commands_queued = false;
+	ErrorStatistics roll_error, pitch_error;
+	float max_altitude = 0.f;
+	uint num_physics_steps = 0;
+
+	config.idle = [&](Timestamp next_release) {
+		Timestamp now = getTimestamp();
+		if(time_after_eq(now, end_time)) {
+			if(!end_commands_queued) {
+				console_input += end_commands;
+				end_commands_queued = true;
+				if(log_writer) log_writer->writeEnd();
+			}
+			//wait until the command line executed all commands
+			return console_pos < console_input.length();
+		}
+		if(time_after(next_release, now)) {
+			advanceVirtualTime(next_release - now);
+			now = next_release;
+		}
+		if(replay_file) return true;
+
+		/* catch up with the clock (udelay() also advances it) */
+		while(time_before(physics_time, now)) {
+			uint dt = min(physics_step, (uint)(now - physics_time));
+			quad.step(dt * 1e-6);
+			physics_time += dt;
+			++num_physics_steps;
+		}
+
+		float t = (now - start_time) * 1e-6f;
+		pilot.update(t, quad, sim_input_control);
+
+		if(!quad.onGround() && t >= pilot.takeoff_time && t < pilot.landing_time) {
+			Vec3d attitude = quad.attitude();
+			roll_error.add(pilot.roll_setpoint - attitude.x);
+			pitch_error.add(pilot.pitch_setpoint - attitude.y);
+			if(quad.altitude() > max_altitude) max_altitude = quad.altitude();
+		}
+		return true;
+	};
+
+	auto wall_start = chrono::steady_clock::now();
+
+	if(static_composition) {
+		FlightController<FlightControllerSensors<ReplaySensor>, SensorFusionMahonyAHRS<>,
+			SimMotorController, ReplayInputControl> flight_controller(config);
+		flight_controller.run();
+	} else {
+		FlightController<> flight_controller(config);
+		flight_controller.run();
+	}
+
+	double wall_time = chrono::duration<double>(chrono::steady_clock::now()
+			- wall_start).count();
+	if(telemetry_file) fclose(telemetry_file);
+	if(output_file) fclose(output_file);
+	delete log_writer;
+	if(record_file) fclose(record_file);
+
+	/* report */
+	double sim_time = (getTimestamp() - start_time) * 1e-6;
+	if(replay_file) {
+		printf("\nReplay results\n");
+		printf("replayed time:        %.3f s\n", sim_time);
+		printf("composition:          %s\n", static_composition ? "static" : "dynamic");
+		printf("wall time:            %.3f s (%.1fx real time)\n", wall_time,
+				sim_time / wall_time);
+		printf("control iterations:   %u (%.0f per wall second)\n",
+				replay_gyro.numMeasurements(), replay_gyro.numMeasurements() / wall_time);
+		printf("samples:             ");
+		for(int i=0; i<SensorLogStream_Count; ++i) {
+			printf(" %s %u", SensorLog::streamName((SensorLogStream)i),
+					(uint)replay_log.samples((SensorLogStream)i).size());
+		}
+		printf("\n");
+		return 0;
+	}
+	Vec3d attitude = quad.attitude();
+	printf("\nSIL results\n");
+	printf("simulated time:       %.3f s\n", sim_time);
+	printf("wall time:            %.3f s (%.1fx real time)\n", wall_time,
+			sim_time / wall_time);
+	if(spi_imu) {
+		printf("SPI IMU:              %u samples, %u transfers, bus time %.3f s "
+				"(%.1f%%), %u clock violations\n", sim_mpu6000->numSamples(),
+				sim_mpu6000->numTransfers(), sim_mpu6000->busTime(),
+				100. * sim_mpu6000->busTime() / sim_time,
+				sim_mpu6000->numClockViolations());
+	} else {
+		printf("control iterations:   %u (%.0f per wall second)\n",
+				sensor_gyro.numMeasurements(), sensor_gyro.numMeasurements() / wall_time);
+	}
+	if(dshot) {
+		printf("DShot frames:         %u, CRC errors: %u, commands: %u\n",
+				dshot_escs.numFrames(), dshot_escs.numCRCErrors(),
+				dshot_escs.numCommands());
+	}
+	const MotorMixer<4>& mixer = dshot ? dshot_motor_controller->mixer()
+			: motor_controller.mixer();
+	printf("mixer limited:        roll & pitch %u, yaw %u, throttle %u (of %u)\n",
+			mixer.numRollPitchLimited(), mixer.numYawLimited(),
+			mixer.numThrottleLimited(), mixer.numMixes());
+	printf("physics steps:        %u\n", num_physics_steps);
+	printf("roll error [deg]:     rms %.3f max %.3f\n",
+			RAD2DEG(roll_error.rms()), RAD2DEG(roll_error.max_abs));
+	printf("pitch error [deg]:    rms %.3f max %.3f\n",
+			RAD2DEG(pitch_error.rms()), RAD2DEG(pitch_error.max_abs));
+	printf("max altitude [m]:     %.3f\n", max_altitude);
+	printf("final position [m]:   %.3f %.3f %.3f\n", quad.position().x,
+			quad.position().y, quad.position().z);
+	printf("final attitude [deg]: %.3f %.3f %.3f\n", RAD2DEG(attitude.x),
+			RAD2DEG(attitude.y), RAD2DEG(attitude.z));
+	printf("max impact speed:     %.3f m/s\n", quad.maxImpactSpeed());
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "quadrotor.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace Math;
+using namespace std;
+
+Quadrotor::Quadrotor(const QuadrotorParams& params)
+	: m_params(params) {
+	reset();
+}
+
+void Quadrotor::reset(double yaw) {
+	m_position = m_velocity = m_acceleration = m_angular_rate = Vec3d(0.);
+	m_q[0] = cos(yaw/2.);
+	m_q[1] = m_q[2] = 0.;
+	m_q[3] = sin(yaw/2.);
+	for(int i=0; i<4; ++i)
+		m_motor_command[i] = m_motor_speed[i] = 0.;
+	m_on_ground = true;
+	m_max_impact_speed = 0.;
+}
+
+void Quadrotor::setMotorCommand(int motor, double speed) {
+	m_motor_command[motor] = min(1., max(0., speed));
+}
+
+Vec3d Quadrotor::toWorld(const Vec3d& v) const {
+	const double w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+	return Vec3d(
+		(1.-2.*(y*y+z*z))*v.x + 2.*(x*y-w*z)*v.y + 2.*(x*z+w*y)*v.z,
+		2.*(x*y+w*z)*v.x + (1.-2.*(x*x+z*z))*v.y + 2.*(y*z-w*x)*v.z,
+		2.*(x*z-w*y)*v.x + 2.*(y*z+w*x)*v.y + (1.-2.*(x*x+y*y))*v.z);
+}
+
+Vec3d Quadrotor::toBody(const Vec3d& v) const {
+	const double w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+	return Vec3d(
+		(1.-2.*(y*y+z*z))*v.x + 2.*(x*y+w*z)*v.y + 2.*(x*z-w*y)*v.z,
+		2.*(x*y-w*z)*v.x + (1.-2.*(x*x+z*z))*v.y + 2.*(y*z+w*x)*v.z,
+		2.*(x*z+w*y)*v.x + 2.*(y*z-w*x)*v.y + (1.-2.*(x*x+y*y))*v.z);
+}
+
+Vec3d Quadrotor::attitude() const {
+	const double w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+	double sin_pitch = max(-1., min(1., 2.*(w*y - z*x)));
+	return Vec3d(atan2(2.*(w*x + y*z), 1.-2.*(x*x + y*y)),
+		asin(sin_pitch),
+		atan2(2.*(w*z + x*y), 1.-2.*(y*y + z*z)));
+}
+
+Vec3d Quadrotor::specificForce() const {
+	return toBody(m_acceleration - Vec3d(0., 0., gravity));
+}
+
+void Quadrotor::step(double dt) {
+	const QuadrotorParams& p = m_params;
+
+	/* motors */
+	double motor_filter = 1. - exp(-dt / p.motor_time_constant);
+	double thrust[4];
+	double total_thrust = 0.;
+	for(int i=0; i<4; ++i) {
+		m_motor_speed[i] += (m_motor_command[i] - m_motor_speed[i]) * motor_filter;
+		thrust[i] = p.max_thrust * m_motor_speed[i] * m_motor_speed[i];
+		total_thrust += thrust[i];
+	}
+
+	/* torques: motors 0 (front right) & 2 (rear left) turn counter-clockwise */
+	const double d = p.arm_length / sqrt(2.);
+	Vec3d torque(
+		d * (-thrust[0] - thrust[1] + thrust[2] + thrust[3]),
+		d * (thrust[0] - thrust[1] - thrust[2] + thrust[3]),
+		p.yaw_moment * (thrust[0] - thrust[1] + thrust[2] - thrust[3]));
+
+	/* rotation: I*dw/dt = torque - w x (I*w) - damping*w */
+	const Vec3d& w = m_angular_rate;
+	Vec3d Iw = p.inertia * w;
+	Vec3d gyroscopic(w.y*Iw.z - w.z*Iw.y, w.z*Iw.x - w.x*Iw.z, w.x*Iw.y - w.y*Iw.x);
+	Vec3d angular_acceleration = (torque - gyroscopic - w * p.angular_damping) / p.inertia;
+
+	/* translation */
+	m_acceleration = toWorld(Vec3d(0., 0., -total_thrust)) / p.mass
+		+ Vec3d(0., 0., gravity) - m_velocity * (p.drag / p.mass);
+
+	/* integrate (semi-implicit Euler) */
+	m_velocity += m_acceleration * dt;
+	m_position += m_velocity * dt;
+	m_angular_rate += angular_acceleration * dt;
+
+	const double q0 = m_q[0], q1 = m_q[1], q2 = m_q[2], q3 = m_q[3];
+	const double hdt = 0.5 * dt;
+	m_q[0] += (-q1*w.x - q2*w.y - q3*w.z) * hdt;
+	m_q[1] += ( q0*w.x + q2*w.z - q3*w.y) * hdt;
+	m_q[2] += ( q0*w.y - q1*w.z + q3*w.x) * hdt;
+	m_q[3] += ( q0*w.z + q1*w.y - q2*w.x) * hdt;
+	double norm = sqrt(m_q[0]*m_q[0] + m_q[1]*m_q[1] + m_q[2]*m_q[2] + m_q[3]*m_q[3]);
+	for(int i=0; i<4; ++i) m_q[i] /= norm;
+
+	/* ground contact: stop & level out (keep the heading) */
+	m_on_ground = m_position.z >= 0.;
+	if(m_on_ground) {
+		if(m_velocity.z > m_max_impact_speed)
+			m_max_impact_speed = m_velocity.z;
+		double yaw = attitude().z;
+		m_position.z = 0.;
+		m_velocity = m_acceleration = m_angular_rate = Vec3d(0.);
+		m_q[0] = cos(yaw/2.);
+		m_q[1] = m_q[2] = 0.;
+		m_q[3] = sin(yaw/2.);
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _SIL_QUADROTOR_HEADER_HPP_
+#define _SIL_QUADROTOR_HEADER_HPP_
+
+#include <kernel/aux/vec3.hpp>
+
+/** physical parameters of a Quadrotor */
+struct QuadrotorParams {
+	double mass = 1.0; /** [kg] */
+	double arm_length = 0.225; /** center to motor [m] */
+	Math::Vec3d inertia = Math::Vec3d(0.0105, 0.0105, 0.02); /** [kg m^2] */
+	double max_thrust = 5.0; /** per motor [N] */
+	double motor_time_constant = 0.02; /** [s] */
+	double yaw_moment = 0.016; /** yaw torque per thrust [m] */
+	double drag = 0.3; /** linear drag [N/(m/s)] */
+	double angular_damping = 0.02; /** [Nm/(rad/s)] */
+};
+
+/**
+ * rigid-body model of a quadrotor in X configuration (same motor association
+ * as MotorControllerQuadX), with first-order motor dynamics & thrust
+ * proportional to the squared motor speed.
+ *
+ * coordinate systems (same as the flight controller):
+ * - world: NED (x north, y east, z down), the ground is at z=0
+ * - body: x front (roll), y right (pitch), z down (yaw)
+ */
+class Quadrotor {
+public:
+	Quadrotor(const QuadrotorParams& params = QuadrotorParams());
+
+	/** place it on the ground, level & with motors stopped */
+	void reset(double yaw = 0.);
+
+	/**
+	 * set the motor command
+	 * @param speed normalized motor speed in [0,1]
+	 */
+	void setMotorCommand(int motor, double speed);
+
+	/** integrate the dynamics by dt seconds (keep it below 1ms) */
+	void step(double dt);
+
+	const Math::Vec3d& position() const { return m_position; }
+	const Math::Vec3d& velocity() const { return m_velocity; }
+	double altitude() const { return -m_position.z; }
+
+	/** angular rate in body frame [rad/s] */
+	const Math::Vec3d& angularRate() const { return m_angular_rate; }
+
+	/** roll, pitch, yaw [rad] (Z-Y-X Euler angles) */
+	Math::Vec3d attitude() const;
+
+	/** specific force (what an accelerometer measures) in body frame [m/s^2] */
+	Math::Vec3d specificForce() const;
+
+	/** rotate a vector from world to body frame */
+	Math::Vec3d toBody(const Math::Vec3d& v) const;
+
+	bool onGround() const { return m_on_ground; }
+	/** max vertical speed when hitting the ground [m/s] */
+	double maxImpactSpeed() const { return m_max_impact_speed; }
+
+	const QuadrotorParams& params() const { return m_params; }
+
+	static constexpr double gravity = 9.80665;
+private:
+	Math::Vec3d toWorld(const Math::Vec3d& v) const;
+
+	QuadrotorParams m_params;
+
+	Math::Vec3d m_position;
+	Math::Vec3d m_velocity;
+	Math::Vec3d m_acceleration; /** world frame, of the last step */
+	double m_q[4]; /** attitude quaternion w,x,y,z (body to world) */
+	Math::Vec3d m_angular_rate;
+
+	double m_motor_command[4];
+	double m_motor_speed[4];
+
+	bool m_on_ground;
+	double m_max_impact_speed;
+};
+
+#endif /* _SIL_QUADROTOR_HEADER_HPP_ */
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "sensor_log.hpp"
+
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+static const char* const stream_names[SensorLogStream_Count] = {
+	"gyro", "accel", "compass", "baro", "input"
+};
+
+static int findStream(const char* name) {
+	for(int i=0; i<SensorLogStream_Count; ++i) {
+		if(strcmp(name, stream_names[i]) == 0) return i;
+	}
+	return -E_NO_SUCH_RESOURCE;
+}
+
+int SensorLog::numValues(SensorLogStream stream) {
+	switch(stream) {
+	case SensorLogStream_Baro: return 1;
+	case SensorLogStream_Input: return InputControlValue_Count;
+	default: return 3;
+	}
+}
+
+const char* SensorLog::streamName(SensorLogStream stream) {
+	return stream_names[stream];
+}
+
+
+SensorLogWriter::SensorLogWriter(FILE* file, Timestamp start) : m_file(file) {
+	fprintf(m_file, "# bPI sensor log\nstart %u\n", (uint)start);
+}
+
+void SensorLogWriter::setMeasurementDelay(SensorLogStream stream, uint delay_us) {
+	fprintf(m_file, "delay %s %u\n", stream_names[stream], delay_us);
+}
+
+void SensorLogWriter::writeEnd() {
+	fprintf(m_file, "end %u\n", (uint)getTimestamp());
+}
+
+void SensorLogWriter::write(SensorLogStream stream, const float* values) {
+	fprintf(m_file, "%s %u", stream_names[stream], (uint)getTimestamp());
+	for(int i=0; i<SensorLog::numValues(stream); ++i)
+		fprintf(m_file, " %.9g", values[i]);
+	fputc('\n', m_file);
+}
+
+
+int SensorLog::read(FILE* file) {
+	char line[512];
+	int line_nr = 0;
+	while(fgets(line, sizeof(line), file)) {
+		++line_nr;
+		char* tokens[2 + InputControlValue_Count + 1];
+		int num_tokens = 0;
+		for(char* token = strtok(line, " \t\r\n"); token && num_tokens <
+				(int)(sizeof(tokens)/sizeof(tokens[0])); token = strtok(NULL, " \t\r\n"))
+			tokens[num_tokens++] = token;
+		if(num_tokens == 0 || tokens[0][0] == '#') continue;
+
+		if(strcmp(tokens[0], "start") == 0 && num_tokens == 2) {
+			m_start = (Timestamp)strtoul(tokens[1], NULL, 10);
+			continue;
+		}
+		if(strcmp(tokens[0], "end") == 0 && num_tokens == 2) {
+			m_end = (Timestamp)strtoul(tokens[1], NULL, 10);
+			m_has_end = true;
+			continue;
+		}
+		if(strcmp(tokens[0], "delay") == 0 && num_tokens == 3) {
+			int stream = findStream(tokens[1]);
+			if(stream >= 0) {
+				m_delay[stream] = (uint)strtoul(tokens[2], NULL, 10);
+				continue;
+			}
+		}
+		int stream = findStream(tokens[0]);
+		if(stream >= 0 && num_tokens == 2 + numValues((SensorLogStream)stream)) {
+			SensorLogSample sample;
+			sample.timestamp = (Timestamp)strtoul(tokens[1], NULL, 10);
+			for(int i=0; i<num_tokens-2; ++i)
+				sample.values[i] = strtof(tokens[2+i], NULL);
+			m_samples[stream].push_back(sample);
+			continue;
+		}
+		printf("Error: sensor log line %i: invalid format\n", line_nr);
+		return -E_FORMAT;
+	}
+	return 0;
+}
+
+void SensorLog::rebase(Timestamp start) {
+	Timestamp offset = start - m_start;
+	for(int i=0; i<SensorLogStream_Count; ++i) {
+		for(auto& sample : m_samples[i])
+			sample.timestamp += offset;
+	}
+	m_end += offset;
+	m_start = start;
+}
+
+Timestamp SensorLog::endTime() const {
+	if(m_has_end) return m_end;
+	Timestamp end = m_start;
+	for(int i=0; i<SensorLogStream_Count; ++i) {
+		if(!m_samples[i].empty() && time_after(m_samples[i].back().timestamp, end))
+			end = m_samples[i].back().timestamp;
+	}
+	return end;
+}
+
+
+RecordingSensor::RecordingSensor(SensorBase<float>& sensor,
+		SensorLogWriter& log, SensorLogStream stream)
+	: m_sensor(sensor), m_log(log), m_stream(stream) {
+	m_log.setMeasurementDelay(m_stream, m_sensor.minMeasurementDelayMicro());
+}
+
+bool RecordingSensor::getMeasurement(float& val) {
+	if(!m_sensor.getMeasurement(val)) return false;
+	m_log.write(m_stream, &val);
+	return true;
+}
+
+bool RecordingSensor::getMeasurement(Math::Vec3f& val) {
+	if(!m_sensor.getMeasurement(val)) return false;
+	float values[3] = { val.x, val.y, val.z };
+	m_log.write(m_stream, values);
+	return true;
+}
+
+
+ReplaySensor::ReplaySensor(const SensorLog& log, SensorLogStream stream)
+	: m_log(log), m_stream(stream) {
+}
+
+const SensorLogSample* ReplaySensor::currentSample() {
+	const vector<SensorLogSample>& samples = m_log.samples(m_stream);
+	Timestamp now = getTimestamp();
+	while(m_next < samples.size() && time_after_eq(now, samples[m_next].timestamp))
+		++m_next;
+	if(m_next == 0) return NULL;
+	++m_num_measurements;
+	return &samples[m_next-1];
+}
+
+bool ReplaySensor::getMeasurement(float& val) {
+	if(SensorLog::numValues(m_stream) != 1) return false;
+	const SensorLogSample* sample = currentSample();
+	if(!sample) return false;
+	val = sample->values[0];
+	return true;
+}
+
+bool ReplaySensor::getMeasurement(Math::Vec3f& val) {
+	if(SensorLog::numValues(m_stream) != 3) return false;
+	const SensorLogSample* sample = currentSample();
+	if(!sample) return false;
+	val = Math::Vec3f(sample->values[0], sample->values[1], sample->values[2]);
+	return true;
+}
+
+
+void ReplayInputControl::update() {
+	const vector<SensorLogSample>& frames = m_log.samples(SensorLogStream_Input);
+	Timestamp now = getTimestamp();
+	for(; m_next < frames.size() && time_after_eq(now, frames[m_next].timestamp); ++m_next) {
+		for(int i=0; i<InputControlValue_Count; ++i)
+			updateValue((InputControlValue)i, frames[m_next].values[i]);
+	}
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _SIL_SENSOR_LOG_HEADER_HPP_
+#define _SIL_SENSOR_LOG_HEADER_HPP_
+
+#include <kernel/timer.h>
+#include <kernel/aux/flight_controller/sensor.hpp>
+#include <kernel/aux/flight_controller/input_control.hpp>
+
+#include <cstdio>
+#include <vector>
+
+/*
+ * sensor logs: timestamped gyro, accel, compass & barometer samples plus the
+ * RC input frames. they are recorded by wrapping the devices & replayed into
+ * the unmodified control path, with the virtual clock of arch/host.
+ *
+ * text format, one item per line ('#' starts a comment):
+ *   start <timestamp_us>                 virtual time when the FC was started
+ *   end <timestamp_us>                   end of the recording (optional)
+ *   delay <stream> <us>                  SensorBase::minMeasurementDelayMicro()
+ *   <stream> <timestamp_us> <values...>  a sample
+ * streams: gyro, accel, compass (3 values), baro (1), input (one per
+ * InputControlValue, before filtering). floats are written with 9 significant
+ * digits, so they are read back bit-identical.
+ */
+
+enum SensorLogStream {
+	SensorLogStream_Gyro = 0,
+	SensorLogStream_Accel,
+	SensorLogStream_Compass,
+	SensorLogStream_Baro,
+	SensorLogStream_Input,
+
+	SensorLogStream_Count
+};
+
+struct SensorLogSample {
+	Timestamp timestamp;
+	float values[InputControlValue_Count];
+};
+
+class SensorLogWriter {
+public:
+	/** @param start virtual time when the flight controller is started */
+	SensorLogWriter(FILE* file, Timestamp start);
+
+	void setMeasurementDelay(SensorLogStream stream, uint delay_us);
+	/** write a sample with the current time */
+	void write(SensorLogStream stream, const float* values);
+	/** mark the end of the recording (the current time) */
+	void writeEnd();
+private:
+	FILE* m_file;
+};
+
+/** a sensor log, completely read into memory */
+class SensorLog {
+public:
+	/**
+	 * read a log from a file
+	 * @return 0 on success, <0 on error (a message is printed)
+	 */
+	int read(FILE* file);
+
+	/** shift all timestamps, so that the log starts at the given time */
+	void rebase(Timestamp start);
+
+	const std::vector<SensorLogSample>& samples(SensorLogStream stream) const
+		{ return m_samples[stream]; }
+	uint measurementDelay(SensorLogStream stream) const { return m_delay[stream]; }
+	Timestamp startTime() const { return m_start; }
+	/** end of the recording or the timestamp of the last sample */
+	Timestamp endTime() const;
+
+	static int numValues(SensorLogStream stream);
+	static const char* streamName(SensorLogStream stream);
+private:
+	std::vector<SensorLogSample> m_samples[SensorLogStream_Count];
+	uint m_delay[SensorLogStream_Count] = { 0 };
+	Timestamp m_start = 0;
+	Timestamp m_end = 0;
+	bool m_has_end = false;
+};
+
+
+/** forwards to another sensor & logs every measurement */
+class RecordingSensor final : public SensorBase<float> {
+public:
+	RecordingSensor(SensorBase<float>& sensor, SensorLogWriter& log,
+			SensorLogStream stream);
+
+	virtual bool getMeasurement(float& val);
+	virtual bool getMeasurement(Math::Vec3f& val);
+	virtual uint minMeasurementDelayMicro() { return m_sensor.minMeasurementDelayMicro(); }
+private:
+	SensorBase<float>& m_sensor;
+	SensorLogWriter& m_log;
+	SensorLogStream m_stream;
+};
+
+/**
+ * sensor that returns the samples of a log: a measurement is the latest
+ * sample that is not in the future (it fails before the first sample). if the
+ * control path reads the sensor at the recorded times, it gets exactly the
+ * recorded samples.
+ */
+class ReplaySensor final : public SensorBase<float> {
+public:
+	ReplaySensor(const SensorLog& log, SensorLogStream stream);
+
+	virtual bool getMeasurement(float& val);
+	virtual bool getMeasurement(Math::Vec3f& val);
+	virtual uint minMeasurementDelayMicro() { return m_log.measurementDelay(m_stream); }
+
+	uint numMeasurements() const { return m_num_measurements; }
+private:
+	const SensorLogSample* currentSample();
+
+	const SensorLog& m_log;
+	SensorLogStream m_stream;
+	size_t m_next = 0; /** index of the next sample */
+	uint m_num_measurements = 0;
+};
+
+/** RC input that applies the input frames of a log when they are due */
+class ReplayInputControl final : public InputControlBase<float> {
+public:
+	ReplayInputControl(const SensorLog& log) : m_log(log) {}
+
+	virtual void update();
+private:
+	const SensorLog& m_log;
+	size_t m_next = 0;
+};
+
+#endif /* _SIL_SENSOR_LOG_HEADER_HPP_ */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include "sim_devices.hpp"
+
+#include <drivers/spi/mpu-6000_accel_gyro.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+
+void SimSensor3D::applyNoise(const Math::Vec3d& value, Math::Vec3f& val) {
+	for(int i=0; i<3; ++i) {
+		float v = (float)value[i] + m_noise.bias[i] +
+			m_noise.stddev * m_distribution(m_random);
+		if(m_noise.resolution > 0.f)
+			v = roundf(v / m_noise.resolution) * m_noise.resolution;
+		val[i] = v;
+	}
+	++m_num_measurements;
+}
+
+
+
+SimMPU6000::SimMPU6000(const Quadrotor& quad, SimRandom& random,
+		const SimSensorNoise& gyro_noise, const SimSensorNoise& accel_noise)
+	: m_gyro(quad, random, gyro_noise, 125), m_accel(quad, random, accel_noise, 125) {
+	reset();
+}
+
+void SimMPU6000::reset() {
+	memset(m_registers, 0, sizeof(m_registers));
+	m_registers[MPU6000_RA_PWR_MGMT_1] = 0x40; //sleep
+	m_registers[MPU6000_RA_WHO_AM_I] = 0x68;
+	m_fifo_head = m_fifo_count = 0;
+	m_next_sample_valid = false;
+}
+
+void SimMPU6000::update() {
+	if(m_registers[MPU6000_RA_PWR_MGMT_1] & 0x40) return; //sleeping
+	uint8_t dlpf = m_registers[MPU6000_RA_CONFIG] & 7;
+	uint period = (dlpf == 0 || dlpf == 7 ? 125 : 1000)
+		* (m_registers[MPU6000_RA_SMPLRT_DIV] + 1);
+	Timestamp now = getTimestamp();
+	if(!m_next_sample_valid) {
+		m_next_sample = now;
+		m_next_sample_valid = true;
+	}
+	while(time_after_eq(now, m_next_sample)) {
+		sample();
+		m_next_sample += period;
+	}
+}
+
+/* the model state is the one of now: the physics is not stepped in between */
+void SimMPU6000::sample() {
+	Math::Vec3f gyro, accel;
+	m_gyro.getMeasurement(gyro);
+	m_accel.getMeasurement(accel);
+	static const float lsb_per_deg_s[4] = { 131.f, 65.5f, 32.8f, 16.4f };
+	float gyro_scale = (float)(180./M_PI) *
+		lsb_per_deg_s[(m_registers[MPU6000_RA_GYRO_CONFIG] >> 3) & 3];
+	float accel_scale = (float)(16384 >> ((m_registers[MPU6000_RA_ACCEL_CONFIG] >> 3) & 3))
+		/ GRAVITY_MSS;
+	/* flight controller frame -> chip frame (see SensorMPU6050GyroAccel) */
+	float values[6] = {
+		accel.y * accel_scale, accel.x * accel_scale, -accel.z * accel_scale,
+		gyro.y * gyro_scale, gyro.x * gyro_scale, -gyro.z * gyro_scale
+	};
+	uint8_t data[12];
+	for(int i=0; i<6; ++i) {
+		int16_t v = (int16_t)std::max(-32768.f, std::min(32767.f, roundf(values[i])));
+		data[2*i] = (uint8_t)(v >> 8);
+		data[2*i+1] = (uint8_t)v;
+	}
+	memcpy(m_registers + MPU6000_RA_ACCEL_XOUT_H, data, 6);
+	m_registers[MPU6000_RA_ACCEL_XOUT_H + 6] = m_registers[MPU6000_RA_ACCEL_XOUT_H + 7] = 0;
+	memcpy(m_registers + MPU6000_RA_ACCEL_XOUT_H + 8, data + 6, 6);
+	m_registers[MPU6000_RA_INT_STATUS] |= 0x01; //data ready
+
+	if((m_registers[MPU6000_RA_USER_CTRL] & MPU6000_USERCTRL_FIFO_EN)
+			&& m_registers[MPU6000_RA_FIFO_EN] == MPU6000_FIFO_EN_ACCEL_GYRO) {
+		for(int i=0; i<12; ++i) {
+			if(m_fifo_count == fifo_size) { //overflow: the oldest byte is lost
+				m_fifo_head = (m_fifo_head + 1) % fifo_size;
+				--m_fifo_count;
+			}
+			m_fifo[(m_fifo_head + m_fifo_count++) % fifo_size] = data[i];
+		}
+	}
+	++m_num_samples;
+}
+
+uint8_t SimMPU6000::readRegister(uint8_t reg) {
+	switch(reg) {
+	case MPU6000_RA_FIFO_COUNTH: return (uint8_t)(m_fifo_count >> 8);
+	case MPU6000_RA_FIFO_COUNTH+1: return (uint8_t)m_fifo_count;
+	case MPU6000_RA_FIFO_R_W: {
+		if(m_fifo_count == 0) return 0;
+		uint8_t value = m_fifo[m_fifo_head];
+		m_fifo_head = (m_fifo_head + 1) % fifo_size;
+		--m_fifo_count;
+		return value;
+	}
+	case MPU6000_RA_INT_STATUS: {
+		uint8_t value = m_registers[reg];
+		m_registers[reg] = 0; //cleared on read
+		return value;
+	}
+	}
+	return m_registers[reg & 0x7f];
+}
+
+void SimMPU6000::writeRegister(uint8_t reg, uint8_t value) {
+	switch(reg) {
+	case MPU6000_RA_PWR_MGMT_1:
+		if(value & MPU6000_PWR1_DEVICE_RESET) {
+			reset();
+			return;
+		}
+		if((m_registers[reg] & 0x40) && !(value & 0x40))
+			m_next_sample_valid = false; //wake up
+		break;
+	case MPU6000_RA_USER_CTRL:
+		if(value & MPU6000_USERCTRL_FIFO_RESET) {
+			m_fifo_head = m_fifo_count = 0;
+			value &= ~MPU6000_USERCTRL_FIFO_RESET;
+		}
+		break;
+	case MPU6000_RA_SIGNAL_PATH_RESET:
+		value = 0; //self-clearing
+		break;
+	case MPU6000_RA_WHO_AM_I:
+	case MPU6000_RA_FIFO_COUNTH:
+	case MPU6000_RA_FIFO_COUNTH+1:
+		return; //read only
+	case MPU6000_RA_FIFO_R_W:
+		return; //the FIFO is only written by the sampling
+	}
+	m_registers[reg & 0x7f] = value;
+}
+
+int SimMPU6000::transfer(SPITransaction* transaction) {
+	if(transaction->len < 1 || transaction->tx_len < 1) return -E_INVALID_PARAM;
+	update();
+	++m_num_transfers;
+	m_bus_time += transaction->len * 8. / transaction->clock_hz;
+
+	uint8_t address = (uint8_t)transaction->tx[0];
+	bool read = address & 0x80;
+	uint8_t reg = address & 0x7f;
+	if(transaction->clock_hz > (read ? 20000000u : 1000000u) || (transaction->mode != 0
+			&& transaction->mode != 3))
+		++m_num_clock_violations;
+	if(transaction->rx && transaction->rx_skip == 0) transaction->rx[0] = 0;
+	for(int i=1; i<transaction->len; ++i) {
+		uint8_t value = 0;
+		if(read) {
+			value = readRegister(reg);
+		} else {
+			writeRegister(reg, i < transaction->tx_len ? (uint8_t)transaction->tx[i] : 0);
+		}
+		int pos = i - transaction->rx_skip;
+		if(transaction->rx && pos >= 0) transaction->rx[pos] = (char)value;
+		if(reg != MPU6000_RA_FIFO_R_W) reg = (reg + 1) & 0x7f; //burst: next register
+	}
+	return transaction->len;
+}
+
+int SimDShotESCs::checkEncoding() {
+	int failed = 0;
+	auto check = [&failed](bool ok, const char* what) {
+		if(ok) return;
+		fprintf(stderr, "DShot check failed: %s\n", what);
+		++failed;
+	};
+	/* known frames (value, telemetry bit, checksum) */
+	check(dshotEncode(1046, false) == 0x82C6, "dshotEncode(1046, false) == 0x82C6");
+	check(dshotEncode(1046, true) == 0x82D7, "dshotEncode(1046, true) == 0x82D7");
+	check(dshotEncode(DSHOT_VALUE_STOP, false) == 0x0000, "dshotEncode(0, false) == 0x0000");
+	check(dshotEncode(DSHOT_THROTTLE_MAX, false) == 0xFFEE, "dshotEncode(2047, false) == 0xFFEE");
+	uint16 value;
+	bool telemetry;
+	check(dshotDecode(0x82D7, &value, &telemetry) && value == 1046 && telemetry,
+			"dshotDecode(0x82D7)");
+	check(!dshotDecode(0x82C7, &value, &telemetry), "checksum error of 0x82C7");
+
+	/* wire encoding: a pin is cleared early (0) or late (1), MSB first */
+	const int pins[4] = { 22, 23, 24, 25 };
+	const uint16 frames[4] = { 0x82C6, 0x0000, 0xFFFF, 0x82D7 };
+	uint32 zero_mask[DSHOT_FRAME_BITS];
+	dshotZeroMasks(zero_mask, frames, pins, 4);
+	check(zero_mask[0] == (1u<<23), "zero mask of the MSB");
+	check(zero_mask[1] == ((1u<<22) | (1u<<23) | (1u<<25)), "zero mask of bit 14");
+	check(zero_mask[DSHOT_FRAME_BITS-1] == ((1u<<22) | (1u<<23)), "zero mask of the LSB");
+	for(int i=0; i<4; ++i)
+		check(dshotZeroMasksFrame(zero_mask, pins[i]) == frames[i], "frame decoded from the zero masks");
+	return failed;
+}
+
+SimInputControl::SimInputControl(uint frame_period_us)
+	: m_frame_period(frame_period_us) {
+	for(int i=0; i<InputControlValue_Count; ++i)
+		m_channels[i] = 0.f;
+	m_next_frame = getTimestamp();
+}
+
+void SimInputControl::update() {
+	Timestamp now = getTimestamp();
+	if(!time_after_eq(now, m_next_frame)) return;
+	for(int i=0; i<InputControlValue_Count; ++i)
+		updateValue((InputControlValue)i, m_channels[i]);
+	if(m_log) m_log->write(SensorLogStream_Input, m_channels);
+	m_next_frame += m_frame_period;
+	if(time_after(now, m_next_frame)) m_next_frame = now + m_frame_period;
+}
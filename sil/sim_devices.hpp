@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2014 Beat Küng <beat-kueng@gmx.net>
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3 of the License.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _SIL_SIM_DEVICES_HEADER_HPP_
+#define _SIL_SIM_DEVICES_HEADER_HPP_
+
+#include <kernel/aux/flight_controller/sensor.hpp>
+#include <kernel/aux/flight_controller/motor_controller.hpp>
+#include <kernel/aux/flight_controller/input_control.hpp>
+#include <kernel/spi.hpp>
+
+#include "quadrotor.hpp"
+#include "sensor_log.hpp"
+
+#include <random>
+
+/*
+ * simulated devices for the flight controller: they read from & write to a
+ * Quadrotor model instead of the hardware.
+ */
+
+typedef std::mt19937 SimRandom;
+
+/** noise & errors of a simulated 3 axis sensor */
+struct SimSensorNoise {
+	float stddev = 0.f; /** white noise */
+	Math::Vec3f bias = Math::Vec3f(0.f); /** constant offset */
+	float resolution = 0.f; /** quantization step (0=none) */
+};
+
+/** base class for the simulated 3 axis sensors */
+class SimSensor3D : public SensorBase<float> {
+public:
+	SimSensor3D(const Quadrotor& quad, SimRandom& random,
+			const SimSensorNoise& noise, uint measurement_delay_us)
+		: m_quad(quad), m_random(random), m_noise(noise),
+		  m_measurement_delay(measurement_delay_us) {}
+
+	virtual uint minMeasurementDelayMicro() { return m_measurement_delay; }
+
+	uint numMeasurements() const { return m_num_measurements; }
+protected:
+	/** add noise, bias & quantization to a true value */
+	void applyNoise(const Math::Vec3d& value, Math::Vec3f& val);
+
+	const Quadrotor& m_quad;
+	SimRandom& m_random;
+	SimSensorNoise m_noise;
+	std::normal_distribution<float> m_distribution;
+	uint m_measurement_delay;
+	uint m_num_measurements = 0;
+};
+
+/** gyroscope [rad/s] */
+class SimSensorGyro final : public SimSensor3D {
+public:
+	using SimSensor3D::SimSensor3D;
+	virtual bool getMeasurement(Math::Vec3f& val) {
+		applyNoise(m_quad.angularRate(), val);
+		return true;
+	}
+};
+
+/** accelerometer [m/s^2] */
+class SimSensorAccel final : public SimSensor3D {
+public:
+	using SimSensor3D::SimSensor3D;
+	virtual bool getMeasurement(Math::Vec3f& val) {
+		applyNoise(m_quad.specificForce(), val);
+		return true;
+	}
+};
+
+/** compass: earth magnetic field in body frame */
+class SimSensorCompass final : public SimSensor3D {
+public:
+	/**
+	 * @param field earth magnetic field in world frame (NED)
+	 */
+	SimSensorCompass(const Quadrotor& quad, SimRandom& random,
+			const SimSensorNoise& noise, uint measurement_delay_us,
+			const Math::Vec3d& field = Math::Vec3d(0.21, 0.0, 0.43))
+		: SimSensor3D(quad, random, noise, measurement_delay_us), m_field(field) {}
+
+	virtual bool getMeasurement(Math::Vec3f& val) {
+		applyNoise(m_quad.toBody(m_field), val);
+		return true;
+	}
+private:
+	Math::Vec3d m_field;
+};
+
+/**
+ * MPU-6000 on SPI: a register file with the data & FIFO registers, sampled
+ * from the model at the configured rate (8 kHz w/o lowpass filter, else
+ * 1 kHz, divided by SMPLRT_DIV). it is accessed through the SPI transfer
+ * interface, so the SPIMPU6000 driver & MPUSampler run unmodified.
+ * bus time & clock violations (> 1 MHz for writes, > 20 MHz for reads) are
+ * counted.
+ */
+class SimMPU6000 {
+public:
+	SimMPU6000(const Quadrotor& quad, SimRandom& random,
+			const SimSensorNoise& gyro_noise, const SimSensorNoise& accel_noise);
+
+	/** SPI transfer (FuncSPITransfer) */
+	int transfer(SPITransaction* transaction);
+
+	uint numSamples() const { return m_num_samples; }
+	uint numTransfers() const { return m_num_transfers; }
+	uint numClockViolations() const { return m_num_clock_violations; }
+	double busTime() const { return m_bus_time; } /** [s] */
+private:
+	static constexpr int fifo_size = 1024;
+
+	void reset();
+	/** take the samples up to now */
+	void update();
+	void sample();
+	uint8_t readRegister(uint8_t reg);
+	void writeRegister(uint8_t reg, uint8_t value);
+
+	SimSensorGyro m_gyro;
+	SimSensorAccel m_accel;
+	uint8_t m_registers[128];
+	uint8_t m_fifo[fifo_size]; /** ring buffer */
+	int m_fifo_head = 0, m_fifo_count = 0;
+	Timestamp m_next_sample = 0;
+	bool m_next_sample_valid = false;
+
+	uint m_num_samples = 0;
+	uint m_num_transfers = 0;
+	uint m_num_clock_violations = 0;
+	double m_bus_time = 0.;
+};
+
+/** barometer: altitude [m] */
+class SimSensorBaro final : public SensorBase<float> {
+public:
+	SimSensorBaro(const Quadrotor& quad, SimRandom& random, float stddev,
+			uint measurement_delay_us)
+		: m_quad(quad), m_random(random), m_distribution(0.f, stddev),
+		  m_measurement_delay(measurement_delay_us) {}
+
+	virtual bool getMeasurement(float& val) {
+		val = (float)m_quad.altitude() + m_distribution(m_random);
+		return true;
+	}
+	virtual uint minMeasurementDelayMicro() { return m_measurement_delay; }
+private:
+	const Quadrotor& m_quad;
+	SimRandom& m_random;
+	std::normal_distribution<float> m_distribution;
+	uint m_measurement_delay;
+};
+
+
+/**
+ * motor controller: the output speed in [minThrust(), maxThrust()] is
+ * linearly mapped to the normalized motor speed of the model
+ */
+class SimMotorController final : public MotorControllerQuadX {
+public:
+	SimMotorController(Quadrotor& quad, const std::array<float, 4>& min_thrust,
+			const std::array<float, 4>& max_thrust)
+		: MotorControllerQuadX(min_thrust, max_thrust), m_quad(quad) {}
+
+	virtual void setMotorSpeed(int motor, float speed) {
+		m_output[motor] = speed;
+		m_quad.setMotorCommand(motor, (speed - m_min_thrust[motor]) /
+				(m_max_thrust[motor] - m_min_thrust[motor]));
+	}
+	virtual float getMotorSpeed(int motor) { return m_output[motor]; }
+
+	virtual bool setPWMFreq(int freq) { m_pwm_freq = freq; return true; }
+	virtual int getPWMFreq() { return m_pwm_freq; }
+private:
+	Quadrotor& m_quad;
+	int m_pwm_freq = 50;
+};
+
+
+/**
+ * DShot ESCs (the output function of MotorControllerDShot): the frames are
+ * sent over the wire like by the DMA output (the GPIO masks of
+ * dshotZeroMasks()) & decoded like by an ESC, frames with a wrong checksum are
+ * dropped. the throttle is the normalized motor speed of the model
+ */
+class SimDShotESCs {
+public:
+	SimDShotESCs(Quadrotor& quad) : m_quad(quad) {}
+
+	int output(const uint16* frames) {
+		const int pins[4] = { 22, 23, 24, 25 }; //as on the board
+		uint32 zero_mask[DSHOT_FRAME_BITS];
+		dshotZeroMasks(zero_mask, frames, pins, 4);
+		for(int motor=0; motor<4; ++motor) {
+			uint16 value;
+			bool telemetry;
+			++m_num_frames;
+			if(!dshotDecode(dshotZeroMasksFrame(zero_mask, pins[motor]),
+					&value, &telemetry)) {
+				++m_num_crc_errors;
+				continue;
+			}
+			if(value != DSHOT_VALUE_STOP && value < DSHOT_THROTTLE_MIN) {
+				++m_num_commands; //not used by the flight controller
+				continue;
+			}
+			m_quad.setMotorCommand(motor, dshotThrottle(value));
+		}
+		return SUCCESS;
+	}
+
+	/**
+	 * check the frame encoding against known frames & the wire encoding (MSB
+	 * first) of dshotZeroMasks(), as used by the DMA output
+	 * @return number of failed checks (printed to stderr)
+	 */
+	static int checkEncoding();
+
+	uint numFrames() const { return m_num_frames; }
+	uint numCRCErrors() const { return m_num_crc_errors; }
+	uint numCommands() const { return m_num_commands; }
+private:
+	Quadrotor& m_quad;
+	uint m_num_frames = 0;
+	uint m_num_crc_errors = 0;
+	uint m_num_commands = 0;
+};
+
+
+/**
+ * RC input: the channel values are set by the simulation (the pilot) and
+ * arrive in frames at a fixed rate, like from a PPM receiver.
+ */
+class SimInputControl final : public InputControlBase<float> {
+public:
+	SimInputControl(uint frame_period_us = 20000);
+
+	/** set a channel value in [-1,1]. it is sent with the next frame */
+	void setValue(InputControlValue value, float data) { m_channels[value] = data; }
+
+	/** write all sent frames to a sensor log (NULL to disable) */
+	void setLog(SensorLogWriter* log) { m_log = log; }
+
+	virtual void update();
+private:
+	float m_channels[InputControlValue_Count];
+	SensorLogWriter* m_log = NULL;
+	uint m_frame_period;
+	Timestamp m_next_frame;
+};
+
+#endif /* _SIL_SIM_DEVICES_HEADER_HPP_ */
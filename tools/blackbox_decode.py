@@ -0,0 +1,125 @@
+#! /usr/bin/env python3
+# Decode a blackbox dump of the flight controller into CSV.
+#
+# Capture the dump with something like:
+#   stty -F /dev/ttyUSB0 raw 115200
+#   cat /dev/ttyUSB0 > dump.bin &  (then run 'blackbox dump' in the console)
+# The console text around the binary frames is skipped.
+# The frame format is described in kernel/aux/flight_controller/blackbox.hpp
+
+import struct
+import sys
+
+
+def crc16(data, crc=0xffff):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xffff
+            else:
+                crc = (crc << 1) & 0xffff
+    return crc
+
+
+def read_frames(data):
+    """ yield (type, payload) of all valid frames """
+    pos = 0
+    while True:
+        pos = data.find(b'\xa5\x5a', pos)
+        if pos < 0 or pos + 7 > len(data):
+            return
+        frame_type, length = struct.unpack_from('<BH', data, pos + 2)
+        end = pos + 5 + length
+        if end + 2 > len(data):
+            return
+        crc, = struct.unpack_from('<H', data, end)
+        if crc16(data[pos+2:end]) != crc:
+            sys.stderr.write('Warning: CRC error at offset %i\n' % pos)
+            pos += 2
+            continue
+        yield frame_type, data[pos+5:end]
+        pos = end + 2
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    # zigzag
+    return (value >> 1) ^ -(value & 1), pos
+
+
+# stored integer of a NaN value (Blackbox::nan_value)
+NAN_VALUE = -(1 << 31)
+
+
+def to_int32(value):
+    value &= 0xffffffff
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('Usage: %s <dump.bin> [<output.csv>]' % sys.argv[0])
+        sys.exit(-1)
+    with open(sys.argv[1], 'rb') as f:
+        data = f.read()
+    output = open(sys.argv[2], 'w') if len(sys.argv) > 2 else sys.stdout
+
+    names, scales = None, None
+    num_blocks = 0
+    num_records = 0
+    last_sequence = None
+    for frame_type, payload in read_frames(data):
+        if frame_type == 1:
+            version, num_fields = struct.unpack_from('<BB', payload)
+            if version != 1:
+                sys.stderr.write('Error: unsupported version %i\n' % version)
+                sys.exit(1)
+            names, scales = [], []
+            pos = 2
+            for i in range(num_fields):
+                scales.append(struct.unpack_from('<I', payload, pos)[0])
+                end = payload.index(b'\0', pos + 4)
+                names.append(payload[pos+4:end].decode())
+                pos = end + 1
+            output.write(','.join(names) + '\n')
+
+        elif frame_type == 2:
+            if names is None:
+                sys.stderr.write('Warning: block before header, skipping\n')
+                continue
+            sequence, count = struct.unpack_from('<IH', payload)
+            if last_sequence is not None and sequence != last_sequence + 1:
+                sys.stderr.write('Warning: missing blocks before sequence %i\n'
+                        % sequence)
+            last_sequence = sequence
+            num_blocks += 1
+            values = [0] * len(names) # first record is a key frame
+            pos = 6
+            for r in range(count):
+                for i in range(len(names)):
+                    delta, pos = read_varint(payload, pos)
+                    values[i] = to_int32(values[i] + delta)
+                line = ['%i' % (values[0] & 0xffffffff)]
+                line += ['nan' if v == NAN_VALUE else '%g' % (v / s)
+                        for v, s in zip(values[1:], scales[1:])]
+                output.write(','.join(line) + '\n')
+            num_records += count
+
+        elif frame_type == 3:
+            total, dropped = struct.unpack_from('<II', payload)
+            sys.stderr.write('Decoded %i records in %i blocks (%i recorded in '
+                    'total, %i dropped)\n' % (num_records, num_blocks, total,
+                        dropped))
+
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,6 @@
 #! /bin/bash
 # This script is used to visualize continuous data output by the class
-# CommandWatchValues via serial line
+# CommandWatchValues (text) or Telemetry (binary, option -t) via serial line
 # feedgnuplot (https://github.com/dkogan/feedgnuplot) is used for visualization
 
 cd "$(dirname $(readlink -f $0))"
@@ -13,6 +13,7 @@ feedgnuplot=feedgnuplot
 value_name=""
 win_len=800
 update_freq=1
+telemetry=0
 
 dev="/dev/ttyUSB0"
 [ ! -e $dev ] && dev="/dev/ttyUSB1"
@@ -30,6 +31,7 @@ usage() {
 	echo "       [-f,--feedgnuplot <bin>]"
 	echo "                               select feedgnuplot binary (default=$feedgnuplot)"
 	echo "       [-c,--cmd <cmd>]        send command before executing (eg to show values)"
+	echo "       [-t,--telemetry]        read binary telemetry (decoded with telemetry_decode.py)"
 	echo ""
 	echo "Examples:"
 	echo " High frequency update:"
@@ -38,6 +40,8 @@ usage() {
 	echo "  echo q > /dev/ttyUSB*; $script_name -c \"sensors noclear 1\" -l 4000 -v altitude-filtered -u 20"
 	echo " Low frequency update:"
 	echo "  $script_name -c \"attitude noclear 100\" -l 800"
+	echo " Binary telemetry (high rates without disturbing the flight controller):"
+	echo "  $script_name -t -c \"telemetry start\" -v gyro -l 4000 -u 20"
 	exit -1
 }
 
@@ -75,6 +79,9 @@ do
 			presend_cmd="$1"
 			shift
 			;;
+		-t|--telemetry)
+			telemetry=1
+			;;
 	esac
 done
 
@@ -94,7 +101,13 @@ if [ ! -z "$value_name" ]; then
 	filter_cmd="if(\$1==\"$value_name\") "
 fi
 
-cat $dev | awk -F ',* ' \
+input_cmd="cat $dev"
+if [ $telemetry -eq 1 ]; then
+	stty -F $dev raw 115200
+	input_cmd="./telemetry_decode.py $dev"
+fi
+
+$input_cmd | awk -F ',* ' \
 	"BEGIN{n=0}{ $filter_cmd"' {for(i=2;i<=NF;++i) printf "%f ",$i; printf ORS; ++n; if(n % '$update_freq'==0) { print "replot" fflush(); } }}' | \
 	$feedgnuplot --lines $win_len_cmd --stream trigger --title "$value_name" 2>/dev/null
 
@@ -0,0 +1,126 @@
+#! /usr/bin/env python3
+# Decode the binary telemetry stream of kernel/aux/telemetry.hpp.
+#
+# Reads from a serial device (or a file) and prints one line per value and
+# packet in the same format as CommandWatchValues:
+#   <value name>, <component 0>, <component 1>, ...
+# so the output can be fed to tools/plot_values.sh (see option -t).
+# The serial device must be configured before, eg.:
+#   stty -F /dev/ttyUSB0 raw 115200
+
+import struct
+import sys
+
+
+def crc16(data, crc=0xffff):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xffff
+            else:
+                crc = (crc << 1) & 0xffff
+    return crc
+
+
+def cobs_decode(data):
+    """ return the decoded bytes or None on error """
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            return None
+        out += data[pos+1:pos+code]
+        pos += code
+        if code < 0xff and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def read_string(data, pos):
+    end = data.index(b'\0', pos)
+    return data[pos:end].decode(errors='replace'), end + 1
+
+
+class Decoder:
+    def __init__(self, output, value_filter=None):
+        self.output = output
+        self.value_filter = value_filter
+        self.topics = {} # topic id -> list of (value name, num components)
+        self.num_errors = 0
+
+    def handle_frame(self, frame):
+        packet = cobs_decode(frame)
+        if packet is None or len(packet) < 3:
+            self.num_errors += 1
+            return
+        payload = packet[:-2]
+        crc, = struct.unpack('<H', packet[-2:])
+        if crc16(payload) != crc:
+            self.num_errors += 1 # eg. console text
+            return
+        if payload[0] == 0:
+            self.handle_schema(payload)
+        elif payload[0] == 1:
+            self.handle_data(payload)
+
+    def handle_schema(self, payload):
+        topic, rate = struct.unpack_from('<BH', payload, 1)
+        name, pos = read_string(payload, 4)
+        num_values = payload[pos]
+        pos += 1
+        values = []
+        for i in range(num_values):
+            if pos >= len(payload):
+                break
+            value_name, pos = read_string(payload, pos)
+            values.append((value_name, payload[pos]))
+            pos += 1
+        if self.topics.get(topic) != values:
+            sys.stderr.write('topic %i: %s (%i Hz): %s\n' % (topic, name, rate,
+                ', '.join(v[0] for v in values)))
+        self.topics[topic] = values
+
+    def handle_data(self, payload):
+        topic, timestamp = struct.unpack_from('<BI', payload, 1)
+        if topic not in self.topics:
+            return # wait for the schema
+        floats = struct.unpack_from('<%if' % ((len(payload) - 6) // 4), payload, 6)
+        idx = 0
+        for name, num_components in self.topics[topic]:
+            components = floats[idx:idx+num_components]
+            idx += num_components
+            if self.value_filter and name != self.value_filter:
+                continue
+            self.output.write(name + ''.join(', %f' % c for c in components) + '\n')
+        self.output.flush()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('Usage: %s <device|file> [<value name>]' % sys.argv[0])
+        sys.exit(-1)
+    value_filter = sys.argv[2] if len(sys.argv) > 2 else None
+    decoder = Decoder(sys.stdout, value_filter)
+    buf = bytearray()
+    with open(sys.argv[1], 'rb', buffering=0) as f:
+        while True:
+            data = f.read(256)
+            if not data:
+                break
+            buf += data
+            while True:
+                end = buf.find(b'\0')
+                if end < 0:
+                    break
+                if end > 0:
+                    decoder.handle_frame(bytes(buf[:end]))
+                del buf[:end+1]
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass